@@ -152,7 +152,25 @@ void adcSetMillivoltCalibration(uint16 vddMillivolts);
  * This function only applies to AD conversions where VDD was used as
  * a reference.  If you used the internal 1.25 V reference instead, you
  * can convert your result to millivolts by multiplying it by
- * 1250 and then dividing it by 2047. */
+ * 1250 and then dividing it by 2047.
+ *
+ * The calibration is prepared by adcSetMillivoltCalibration(), so this
+ * function does not need a 32-bit division.  The results are exactly the
+ * same as computing <code>((int32)adcResult * vddMillivolts + 1023) / 2047</code>. */
 int16 adcConvertToMillivolts(int16 adcResult);
 
+/*! Converts an array of ADC results to millivolts, in place.
+ *
+ * \param buffer An array of ADC results between -2048 and 2047 that were
+ *  measured using VDD as a reference.  Each one is replaced by the value
+ *  adcConvertToMillivolts() would return for it.
+ * \param count The number of results in the array.
+ *
+ * This does the same calculation for each result as adcConvertToMillivolts(),
+ * so it is not faster per result: it only saves the function call and the
+ * loading of the calibration for each one.  The calculation can not be
+ * reduced to a single 16-bit by 16-bit multiplication without giving up the
+ * exact results described in adcConvertToMillivolts(). */
+void adcConvertBufferToMillivolts(int16 XDATA * buffer, uint16 count);
+
 #endif
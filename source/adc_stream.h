@@ -0,0 +1,252 @@
+/*! \file adc_stream.h
+ * The <code>adc_stream.lib</code> library lets you sample several analog
+ * inputs continuously at a steady rate without involving the CPU in each
+ * conversion.
+ *
+ * adcRead() in adc.h starts a single conversion and busy-waits until it is
+ * finished, so it is not a good way to sample at a fixed rate: the timing
+ * depends on what else your main loop is doing, and the CPU is tied up for
+ * the whole conversion.  This library instead uses the ADC's sequence
+ * conversions (ADCCON2): each time a trigger event happens, the ADC converts
+ * every channel you selected, one after the other.  DMA channel 2
+ * (#DMA_CHANNEL_ADC) copies each result to a circular buffer in XDATA as soon
+ * as it is ready, and the DMA ISR hands completed blocks of samples to your
+ * main loop.
+ *
+ * \section streamchannels Channels
+ *
+ * Only the single-ended Port 0 inputs AIN0-AIN5 (P0_0 - P0_5) can be
+ * streamed; you specify them with a bitmask (e.g. 0b000101 for AIN0 and
+ * AIN2).  The hardware always converts the channels of a sequence in
+ * ascending order and skips the ones that are not selected, so the samples in
+ * each frame are stored in ascending order of channel number.  The selected
+ * pins are switched to analog mode (ADCCFG) until adcStreamStop() is called.
+ *
+ * \section streamrate Sample rate
+ *
+ * A frame is one conversion of every selected channel.  If you specify a
+ * frame rate, Timer 1 is run in modulo mode and its channel 0 compare event
+ * starts each frame, so the frames are evenly spaced regardless of CPU load.
+ * Timer 1 channel 0 is the only timer that can start ADC sequences, so this
+ * library can not be used with a non-zero frame rate at the same time as
+ * <code>servo.lib</code> or <code>input_capture.lib</code>.
+ *
+ * If you specify a frame rate of 0, the ADC runs at full speed: a new frame
+ * starts as soon as the previous one finishes, and Timer 1 is not used.  This
+ * gives the highest throughput the converter supports: one sample every 20
+ * microseconds with #ADC_BITS_7, up to one every 132 microseconds with
+ * #ADC_BITS_12 (the default).  The frame period you request must be longer
+ * than the time it takes to convert all the selected channels, or frames
+ * will be skipped.
+ *
+ * \section streamblocks Blocks
+ *
+ * The buffer is divided into #ADC_STREAM_BLOCK_COUNT blocks, and each block
+ * holds a whole number of frames.  You read a completed block in place with
+ * adcStreamGetBlock() and give it back with adcStreamReleaseBlock(); no
+ * copying is needed.  If every block is still waiting to be read when the DMA
+ * needs a new one, the next block's worth of samples is discarded and
+ * #adcStreamOverrunCount is incremented, so the blocks you do read are always
+ * complete and in order.
+ *
+ * The DMA ISR runs once per block, and it must run before the following
+ * block is finished.  With short blocks at full speed, keep the other
+ * interrupts in your application short or make the blocks longer.
+ *
+ * \section streamformat Sample format
+ *
+ * Each sample is the raw 16-bit contents of the ADC result register.  To get
+ * a value in the same units as adcRead() (0-2047 at 12 bits), shift it right
+ * by 4 and treat negative values as 0; #ADC_STREAM_SAMPLE does that for you.
+ *
+ * You should not call adcRead() or the other functions in adc.h while a
+ * stream is running, because their results would be copied into the stream.
+ *
+ * \section streamfilters Filters
+ *
+ * Instead of reading raw blocks, you can have the DMA ISR filter each block
+ * as soon as it is complete and read the results with
+ * adcStreamReadFiltered().  Call adcStreamSetFilter() before
+ * adcStreamStart() to choose a filter:
+ *
+ * - #ADC_STREAM_FILTER_DECIMATE adds up 4, 16, or 64 consecutive samples of
+ *   each channel and delivers one sample for each group.  This is the classic
+ *   oversample-and-decimate technique: every factor of 4 gives one more bit of
+ *   resolution (13, 14, or 15 bits), provided the input has a little noise.
+ * - #ADC_STREAM_FILTER_MOVING_AVERAGE delivers one sample per frame: the sum
+ *   of the last 4 or 16 samples of each channel, scaled to 13 or 14 bits.
+ * - #ADC_STREAM_FILTER_CIC is a second-order cascaded integrator-comb
+ *   decimator with a ratio of 4, 16, or 64.  It has the same output rate and
+ *   resolution as #ADC_STREAM_FILTER_DECIMATE but much better rejection of
+ *   frequencies that would otherwise alias into the output.
+ *
+ * The filtered samples are in units of 1/2 (4x), 1/4 (16x), or 1/8 (64x) of
+ * the values returned by adcRead(), so a full scale input gives 4094, 8188,
+ * or 16376.  They are signed, because noise can make a channel that is
+ * close to 0 V average slightly below zero.
+ *
+ * While a filter is selected the raw blocks are not delivered to the main
+ * loop: adcStreamBlocksAvailable() always returns 0.  Filtering takes the ISR
+ * roughly 10 microseconds per sample, so at full speed with #ADC_BITS_7 the
+ * CPU will spend about half of its time in the ISR.
+ *
+ * Since this library defines an ISR, adc_stream.h must be included in the
+ * source file that contains your main() function.
+ */
+
+#ifndef _ADC_STREAM_H
+#define _ADC_STREAM_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <adc.h>
+
+/*! The number of blocks the sample buffer is divided into.  This is a power
+ * of two. */
+#define ADC_STREAM_BLOCK_COUNT 4
+
+/*! The maximum number of samples in one block. */
+#define ADC_STREAM_MAX_BLOCK_SAMPLES 64
+
+/*! Converts a raw sample from the stream into a number between 0 and 2047,
+ * like the return value of adcRead(). */
+#define ADC_STREAM_SAMPLE(raw) (((int16)(raw) < 0) ? 0 : ((uint16)(raw) >> 4))
+
+/*! The number of filtered samples that can be stored in the filtered sample
+ * buffer.  This is a power of two; one slot is always left empty. */
+#define ADC_STREAM_FILTERED_BUFFER_SIZE 128
+
+/*! Specifies that samples are not filtered; you read them in blocks with
+ * adcStreamGetBlock().  This is the default. */
+#define ADC_STREAM_FILTER_NONE              0
+
+/*! Specifies an accumulate-and-shift decimation filter.
+ * See the \ref streamfilters section above. */
+#define ADC_STREAM_FILTER_DECIMATE          1
+
+/*! Specifies a moving average filter with no decimation.
+ * See the \ref streamfilters section above. */
+#define ADC_STREAM_FILTER_MOVING_AVERAGE    2
+
+/*! Specifies a second-order CIC decimation filter.
+ * See the \ref streamfilters section above. */
+#define ADC_STREAM_FILTER_CIC               3
+
+/*! Specifies a filter ratio (or moving average length) of 4, giving one
+ * extra bit of resolution. */
+#define ADC_STREAM_RATIO_4      1
+
+/*! Specifies a filter ratio (or moving average length) of 16, giving two
+ * extra bits of resolution. */
+#define ADC_STREAM_RATIO_16     2
+
+/*! Specifies a filter ratio of 64, giving three extra bits of resolution.
+ * The moving average filter uses 16 instead. */
+#define ADC_STREAM_RATIO_64     3
+
+/*! The number of blocks of samples that were discarded because all of the
+ * blocks in the buffer were waiting to be read.  This variable is incremented
+ * by the ISR and never cleared by the library; you can clear it at any
+ * time. */
+extern volatile uint8 DATA adcStreamOverrunCount;
+
+/*! The number of filtered frames that were discarded because the filtered
+ * sample buffer was full.  You can clear this at any time. */
+extern volatile uint8 DATA adcStreamFilterOverrunCount;
+
+/*! Selects the filter that will be used by the next call to
+ * adcStreamStart().
+ *
+ * \param filter #ADC_STREAM_FILTER_NONE, #ADC_STREAM_FILTER_DECIMATE,
+ *   #ADC_STREAM_FILTER_MOVING_AVERAGE, or #ADC_STREAM_FILTER_CIC.
+ *
+ * \param ratio #ADC_STREAM_RATIO_4, #ADC_STREAM_RATIO_16, or
+ *   #ADC_STREAM_RATIO_64.
+ *
+ * Example code:
+ *
+\code
+// Sample P0_3 at 32 kHz with 7-bit conversions (the ADC can do at most
+// about 50 kHz at 7 bits) and deliver 500 samples per second.  The 64x CIC
+// filter adds 3 bits, so the results have about 10 bits of real resolution,
+// even though they are scaled like 15-bit values (0-16376).  Filtering takes
+// roughly a third of the CPU time at this rate.
+adcStreamSetFilter(ADC_STREAM_FILTER_CIC, ADC_STREAM_RATIO_64);
+adcStreamStart(1<<3, ADC_BITS_7, 32000, 64);
+\endcode
+ */
+void adcStreamSetFilter(uint8 filter, uint8 ratio);
+
+/*! Starts streaming samples from the ADC.  If a stream is already running,
+ * it is stopped first and any unread blocks are discarded.
+ *
+ * \param channelMask A bitmask of the AIN channels to sample: bit 0 is AIN0
+ *   (P0_0) and bit 5 is AIN5 (P0_5).  Must not be zero.
+ *
+ * \param options Either 0 for the defaults (12-bit resolution and VDD as a
+ *   reference), or the bitwise OR of #ADC_REFERENCE_INTERNAL and one of
+ *   #ADC_BITS_7, #ADC_BITS_9, #ADC_BITS_10, or #ADC_BITS_12.
+ *
+ * \param framesPerSecond The number of frames (conversions of every selected
+ *   channel) per second, 3 to 65535, or 0 to run the ADC at full speed.
+ *   See the \ref streamrate section above.
+ *
+ * \param framesPerBlock The number of frames in each block.  It is reduced if
+ *   necessary so that a block has at most #ADC_STREAM_MAX_BLOCK_SAMPLES
+ *   samples.
+ *
+ * This function uses 32-bit division.  It enables interrupts in general
+ * (EA = 1).
+ *
+ * Example code:
+ *
+\code
+// Sample P0_0 and P0_1 one thousand times per second with 10-bit resolution.
+adcStreamStart(0b11, ADC_BITS_10, 1000, 16);
+\endcode
+ */
+void adcStreamStart(uint8 channelMask, uint8 options, uint16 framesPerSecond, uint8 framesPerBlock);
+
+/*! Stops the conversions, stops Timer 1 if it was used, and returns the
+ * pins to digital mode.  Blocks that were already completed can still be
+ * read. */
+void adcStreamStop(void);
+
+/*! \return 1 if a stream is running, 0 otherwise. */
+BIT adcStreamStarted(void);
+
+/*! \return The number of samples in each block (the number of selected
+ * channels times the number of frames per block). */
+uint8 adcStreamBlockSamples(void);
+
+/*! \return The number of completed blocks waiting to be read. */
+uint8 adcStreamBlocksAvailable(void);
+
+/*! \return A pointer to the oldest completed block, or 0 if there are none.
+ *
+ * The block holds adcStreamBlockSamples() samples and stays valid until you
+ * call adcStreamReleaseBlock().  Calling this function again before then
+ * returns the same block. */
+uint16 XDATA * adcStreamGetBlock(void);
+
+/*! Gives the block returned by adcStreamGetBlock() back to the library so it
+ * can be filled again.  Does nothing if no blocks are available. */
+void adcStreamReleaseBlock(void);
+
+/*! \return The number of filtered samples waiting in the filtered sample
+ * buffer.  This is always a multiple of the number of selected channels. */
+uint8 adcStreamFilteredAvailable(void);
+
+/*! Removes whole frames of filtered samples from the filtered sample buffer
+ * and copies them to the specified array.
+ *
+ * \param samples The array to store the samples in.  Each frame holds one
+ *   sample for each selected channel, in ascending order of channel number.
+ * \param maxCount The number of samples that will fit in the array.
+ * \return The number of samples that were copied.  This is a multiple of
+ *   the number of selected channels. */
+uint8 adcStreamReadFiltered(int16 XDATA * samples, uint8 maxCount);
+
+ISR(DMA, 0);
+
+#endif
@@ -20,6 +20,14 @@ void dmaInit(void);
  * transmitting and receiving radio packets. */
 #define DMA_CHANNEL_RADIO  1
 
+/*! This is the number of the DMA channel used by adc_stream.h to copy
+ * ADC sequence results to memory. */
+#define DMA_CHANNEL_ADC    2
+
+/*! This is the number of the DMA channel used by usbReadFifoDma() and
+ * usbWriteFifoDma() in usb.h. */
+#define DMA_CHANNEL_USB    3
+
 /*! This struct consists of 4 DMA config registers
  * for DMA channels 1-4. */
 typedef struct DMA14_CONFIG
@@ -29,11 +37,13 @@ typedef struct DMA14_CONFIG
      * radio packets. */
     volatile DMA_CONFIG radio;
 
-    /*! Config struct for DMA channel 2 (unassigned) */
-    volatile DMA_CONFIG _2;
+    /*! This is the DMA configuration struct for DMA channel 2,
+     * which is used by adc_stream.h for streaming ADC samples. */
+    volatile DMA_CONFIG adc;
 
-    /*! Config struct for DMA channel 3 (unassigned) */
-    volatile DMA_CONFIG _3;
+    /*! This is the DMA configuration struct for DMA channel 3,
+     * which is used by usbReadFifoDma() and usbWriteFifoDma(). */
+    volatile DMA_CONFIG usb;
 
     /*! Config struct for DMA channel 4 (unassigned) */
     volatile DMA_CONFIG _4;
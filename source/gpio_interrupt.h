@@ -0,0 +1,144 @@
+/*! \file gpio_interrupt.h
+ * The <code>gpio_interrupt.lib</code> library lets you react to edges on the
+ * CC2511's Port 0 and Port 1 pins without polling them from your main loop.
+ * It uses the Port 0 and Port 1 interrupts (configured with PICTL, P1IEN and
+ * friends) to record each edge in a circular buffer, together with the pin
+ * level and a timestamp.  Your main loop can then handle the events at its
+ * leisure, either by calling gpioInterruptService() to dispatch them to the
+ * handlers registered with gpioInterruptEnable(), or by draining them in
+ * batches with gpioInterruptReadEvents().
+ *
+ * Because the events are queued in an interrupt, an edge will not be missed
+ * just because the main loop was busy for a few milliseconds servicing USB
+ * or the radio.
+ *
+ * The pin numbers used by this library are the same as the ones used by
+ * gpio.h (e.g. 14 for P1_4).  Only the Port 0 pins (0-5) and the Port 1
+ * pins (10-17) are supported.  The Port 2 interrupt is shared with the USB
+ * module, and all of the Wixel's Port 2 pins are managed by board.h, so
+ * Port 2 is not supported.
+ *
+ * Since this library defines ISRs, gpio_interrupt.h must be included in the
+ * source file that contains your main() function.
+ *
+ * \section edges Edges
+ *
+ * The CC2511 can only detect one kind of edge per port: either all of the
+ * interrupt pins on a port detect rising edges or they all detect falling
+ * edges (PICTL.P0ICON and PICTL.P1ICON).  If every enabled pin on a port asks
+ * for the same kind of edge, the hardware is simply configured for that
+ * edge.  Otherwise (if a pin uses #GPIO_EDGE_BOTH, or if two pins on the
+ * same port ask for different edges), the ISR flips the edge selection of
+ * the port after every event so that it follows the level of the pin that
+ * last changed, and unwanted edges are discarded in software.  This works
+ * well for a single pin, but if several pins on the same port change at
+ * nearly the same time in that mode some edges can be missed, so we
+ * recommend putting pins that need both edges on separate ports.
+ *
+ * \section debounce Debouncing
+ *
+ * Each pin can have a debounce time between 0 and 255 milliseconds.  After
+ * an event has been recorded for a pin, any further edges on that pin are
+ * ignored until the debounce time has elapsed.  The level reported in an
+ * event is the level that was read in the ISR, so it might not be the final
+ * level of a bouncing input; if you need that, read the pin with isPinHigh()
+ * after the debounce time has elapsed.
+ *
+ * \section usbresume USB suspend
+ *
+ * The USB resume signal is mapped to P0_7 (bit 7 of P0IFG).  The Port 0 ISR
+ * in this library clears usbSuspendMode when that flag is set, as described
+ * in usb.h, so usbSleep() will still be able to wake up while this library is
+ * in use.  This means that the library uses usbSuspendMode from usb.lib.
+ */
+
+#ifndef _GPIO_INTERRUPT_H
+#define _GPIO_INTERRUPT_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+
+/*! Specifies that events should be recorded on rising edges (low to high). */
+#define GPIO_EDGE_RISING    1
+
+/*! Specifies that events should be recorded on falling edges (high to low). */
+#define GPIO_EDGE_FALLING   2
+
+/*! Specifies that events should be recorded on both edges.
+ * See the \ref edges section above. */
+#define GPIO_EDGE_BOTH      3
+
+/*! The number of events that can be stored in the event buffer.
+ * This is a power of two; one slot is always left empty, so at most
+ * GPIO_INTERRUPT_EVENT_BUFFER_SIZE - 1 events can be waiting at a time. */
+#define GPIO_INTERRUPT_EVENT_BUFFER_SIZE 16
+
+/*! This struct represents a single edge recorded by the ISR. */
+typedef struct GPIO_EVENT
+{
+    /*! The value of getMs() at the time the edge was detected. */
+    uint32 timeMs;
+
+    /*! The pin number (e.g. 14 for P1_4). */
+    uint8 pinNumber;
+
+    /*! The level that was read from the pin in the ISR: #LOW (0) or #HIGH (1).
+     * A value of 1 normally means a rising edge happened. */
+    uint8 level;
+} GPIO_EVENT;
+
+/*! A pointer to a function that handles GPIO events.
+ * These handlers are called from gpioInterruptService(), so they run in
+ * the main loop, not in an interrupt. */
+typedef void (*GpioEventHandler)(GPIO_EVENT XDATA * event);
+
+/*! The number of events that were discarded because the event buffer was full.
+ * This variable is incremented by the ISR and never cleared by the library;
+ * you can clear it at any time. */
+extern volatile uint8 DATA gpioInterruptOverflowCount;
+
+/*! Starts recording edges on the specified pin.
+ *
+ * \param pinNumber The pin number, either 0-5 or 10-17.  Any other pin
+ *   number is ignored.
+ * \param edge Should be #GPIO_EDGE_RISING, #GPIO_EDGE_FALLING, or #GPIO_EDGE_BOTH.
+ * \param debounceMs The number of milliseconds after an event during which
+ *   further edges on this pin will be ignored (0-255).
+ * \param handler A function that will be called by gpioInterruptService()
+ *   for each event on this pin, or 0 if you are going to use
+ *   gpioInterruptReadEvents() instead.
+ *
+ * This function does not change the direction or pull-up/pull-down
+ * configuration of the pin; you should call setDigitalInput() first.
+ *
+ * This function enables interrupts in general (EA = 1). */
+void gpioInterruptEnable(uint8 pinNumber, uint8 edge, uint8 debounceMs, GpioEventHandler handler);
+
+/*! Stops recording edges on the specified pin.  Events for this pin that are
+ * already in the event buffer will still be reported. */
+void gpioInterruptDisable(uint8 pinNumber);
+
+/*! \return The number of events that are waiting in the event buffer. */
+uint8 gpioInterruptEventsAvailable(void);
+
+/*! Removes events from the event buffer and copies them to the specified array.
+ *
+ * \param events The array to store the events in.
+ * \param maxCount The number of events that will fit in the array.
+ * \return The number of events that were copied (0 to maxCount).
+ *
+ * Events are returned in the order they were recorded.  The registered
+ * handlers are NOT called for events removed this way. */
+uint8 gpioInterruptReadEvents(GPIO_EVENT XDATA * events, uint8 maxCount);
+
+/*! Removes all the events from the event buffer and passes each one to the
+ * handler that was registered for its pin (if any).
+ *
+ * You should call this regularly from your main loop if you registered any
+ * handlers with gpioInterruptEnable(). */
+void gpioInterruptService(void);
+
+ISR(P0INT, 0);
+ISR(P1INT, 0);
+
+#endif
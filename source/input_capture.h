@@ -0,0 +1,145 @@
+/*! \file input_capture.h
+ * The <code>input_capture.lib</code> library lets you measure the timing of
+ * digital signals, such as RC receiver pulses, ultrasonic echoes, or encoder
+ * periods, without busy-waiting in your main loop.
+ *
+ * This library uses the three capture channels of Timer 1.  The timer runs
+ * at 24 MHz, so every edge is timestamped by the hardware with a resolution
+ * of 1/24 microseconds (about 42 ns), regardless of what the CPU is doing at
+ * the time.  The Timer 1 ISR extends the 16-bit hardware timestamps to 32
+ * bits, so intervals of up to about 178 seconds can be measured.
+ *
+ * Each edge is stored in a circular buffer which you can read with
+ * inputCaptureReadEvents().  The ISR also keeps track of the most recent
+ * pulse width and period on each channel, which you can read at any time
+ * with inputCapturePulseWidth() and inputCapturePeriod().
+ *
+ * Timer 1 can only use one of these two sets of pins at a time:
+ *
+ * <table><caption>Timer 1 capture pins</caption>
+ * <tr><th>Capture number</th><th>Alt. 1 pin</th><th>Alt. 2 pin</th></tr>
+ * <tr><td>0</td><td>P0_2</td><td>P1_2</td></tr>
+ * <tr><td>1</td><td>P0_3</td><td>P1_1</td></tr>
+ * <tr><td>2</td><td>P0_4</td><td>P1_0</td></tr>
+ * </table>
+ *
+ * Timers 3 and 4 can not be used because they only have compare channels
+ * (no capture) and 8-bit counters, and Timer 4 is used by time.h.
+ *
+ * This library uses Timer 1, so it can not be used at the same time as
+ * <code>servo.lib</code>.
+ *
+ * Since this library defines an ISR, input_capture.h must be included in the
+ * source file that contains your main() function.
+ */
+
+#ifndef _INPUT_CAPTURE_H
+#define _INPUT_CAPTURE_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+
+/*! The number of timer ticks in one microsecond. */
+#define INPUT_CAPTURE_TICKS_PER_MICROSECOND 24
+
+/*! The number of timer ticks in one second. */
+#define INPUT_CAPTURE_TICKS_PER_SECOND 24000000
+
+/*! The number of edges that can be stored in the event buffer.  This is a
+ * power of two; one slot is always left empty. */
+#define INPUT_CAPTURE_EVENT_BUFFER_SIZE 32
+
+/*! This struct represents a single edge captured by Timer 1. */
+typedef struct CAPTURE_EVENT
+{
+    /*! The time of the edge, in units of 1/24 microseconds. */
+    uint32 time;
+
+    /*! The capture number (0, 1, or 2). */
+    uint8 captureNum;
+
+    /*! The level of the pin read in the ISR: 1 for a rising edge, 0 for a
+     * falling edge.  This can be wrong if the pin changed twice before the
+     * ISR ran. */
+    uint8 level;
+} CAPTURE_EVENT;
+
+/*! The number of edges that were discarded because the event buffer was
+ * full.  You can clear this at any time. */
+extern volatile uint8 DATA inputCaptureOverflowCount;
+
+/*! Configures the specified pins as capture inputs, configures Timer 1,
+ *  and starts capturing both edges on those pins.
+ *
+ *  \param pins A pointer to an array of pin numbers that specify which pins
+ *    will be used to capture.  The pin numbers used here are the same as the
+ *    pin numbers used in the gpio.h library (e.g. 12 for P1_2).
+ *    The capture number of each pin is fixed by the hardware, as shown in
+ *    the table above (e.g. P1_0 is always capture number 2); the order of
+ *    the pins in this array does not matter.
+ *    The pins must all be from the same column of the table above, and no
+ *    two pins can have the same capture number.
+ *    If this argument is 0, the pins from the last call are used again.
+ *
+ *  \param numPins The size of the pins array (1-3).
+ *
+ *  \return 1 if capturing was started, or 0 if the pins were not valid, in
+ *    which case nothing is changed.
+ *
+ *  This function does not configure the pull-up or pull-down resistors of
+ *  the pins; you can call setDigitalInput() first to do that.
+ *
+ *  Example code:
+ *
+\code
+uint8 CODE pins[] = {12, 11};
+inputCaptureStart((uint8 XDATA *)pins, sizeof(pins));
+\endcode
+ */
+BIT inputCaptureStart(uint8 XDATA * pins, uint8 numPins);
+
+/*! Stops Timer 1 and returns the capture pins to being general-purpose
+ * inputs. */
+void inputCaptureStop(void);
+
+/*! \return The current time, in units of 1/24 microseconds, using the same
+ * time base as the timestamps in #CAPTURE_EVENT. */
+uint32 inputCaptureGetTime(void);
+
+/*! \return The number of events waiting in the event buffer. */
+uint8 inputCaptureEventsAvailable(void);
+
+/*! Removes events from the event buffer and copies them to the specified
+ * array.
+ *
+ * \param events The array to store the events in.
+ * \param maxCount The number of events that will fit in the array.
+ * \return The number of events that were copied (0 to maxCount). */
+uint8 inputCaptureReadEvents(CAPTURE_EVENT XDATA * events, uint8 maxCount);
+
+/*! \return The width of the last complete high pulse on the specified
+ *  capture channel, in units of 1/24 microseconds, or 0 if no complete
+ *  pulse has been measured yet. */
+uint32 inputCapturePulseWidth(uint8 captureNum);
+
+/*! \return The time between the last two rising edges on the specified
+ *  capture channel, in units of 1/24 microseconds, or 0 if two rising
+ *  edges have not been seen yet. */
+uint32 inputCapturePeriod(uint8 captureNum);
+
+/*! \return The frequency of the signal on the specified capture channel in
+ *  Hz, computed from inputCapturePeriod(), or 0 if the period is not known.
+ *
+ * This function uses 32-bit division, so it should not be called from an
+ * ISR. */
+uint32 inputCaptureFrequency(uint8 captureNum);
+
+/*! \return The number of rising edges seen so far on the specified capture
+ * channel, modulo 256.  You can compare this with an earlier value to find
+ * out whether inputCapturePulseWidth() or inputCapturePeriod() have new
+ * measurements. */
+uint8 inputCaptureEdgeCount(uint8 captureNum);
+
+ISR(T1, 0);
+
+#endif
@@ -37,6 +37,19 @@
 /*! See the documentation for radioMacEventHandler(). */
 #define RADIO_MAC_EVENT_STROBE              33
 
+/*! The radio is off (radioMacInit() has not been called).
+ * See radioMacResidencyMs(). */
+#define RADIO_MAC_RESIDENCY_OFF             0
+/*! The radio is idle (for example after radioMacSleep()).
+ * See radioMacResidencyMs(). */
+#define RADIO_MAC_RESIDENCY_IDLE            1
+/*! The radio is receiving or listening for a packet.
+ * See radioMacResidencyMs(). */
+#define RADIO_MAC_RESIDENCY_RX              2
+/*! The radio is transmitting a packet.
+ * See radioMacResidencyMs(). */
+#define RADIO_MAC_RESIDENCY_TX              3
+
 /*! Initializes the radio.
  * This involves calling radioRegistersInit().
  * This should be called before any other radioMac functions are called. */
@@ -136,6 +149,28 @@ extern volatile BIT radioRxOverflowOccurred;
  * This should not happen. */
 extern volatile BIT radioTxUnderflowOccurred;
 
+/*! \return The time the radio has spent in the specified state since
+ * radioMacInit() or radioMacClearResidency(), in milliseconds.
+ *
+ * \param state One of the RADIO_MAC_RESIDENCY_* values.
+ *
+ * The time is measured between the points where this library tells the
+ * radio to change state, so the RX time includes the time the radio spends
+ * calibrating before it starts listening, and the TX time ends when the
+ * packet has been sent.
+ *
+ * The times are measured with getUs(), so they are only right if no state
+ * lasts longer than 71 minutes without either a radio event or a call to
+ * this function.  Calling this function every few minutes (for example,
+ * when you print the statistics) avoids that problem.
+ *
+ * See sleepEstimateChargeUc() in sleep.h for a way to turn these times into
+ * an estimate of the charge used. */
+uint32 radioMacResidencyMs(uint8 state);
+
+/*! Sets all of the residency times to zero. */
+void radioMacClearResidency(void);
+
 /*! The radio's Interrupt Service Routine (ISR). */
 ISR(RF, 0);
 
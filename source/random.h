@@ -6,6 +6,14 @@
  *
  * WARNING: The numbers generated are highly predictable if you know what the
  * previous number was.
+ *
+ * The hardware generator must only be used by the main loop.  Code that runs
+ * in an ISR (such as the radio libraries choosing a random transmit delay)
+ * should call randomNumberFromIsr(), which never waits: it takes bytes from a
+ * small pool that the main loop fills from the hardware generator with
+ * randomPoolService(), and falls back to a fast software generator when the
+ * pool is empty.  For things like backoff jitter in the main loop, where
+ * speed matters more than quality, you can use randomFast().
  */
 
 #ifndef _RANDOM_H
@@ -24,6 +32,42 @@
  */
 void randomSeedFromAdc(void);
 
+/*! Gathers noise from the radio and the ADC and mixes it into the state of
+ * the hardware and software random number generators.
+ *
+ * Unlike randomSeedFromSerialNumber(), this gives a different sequence on
+ * every boot, so two Wixels that are powered up together do not keep
+ * choosing the same transmit delays.  Unlike randomSeedFromAdc(), which only
+ * uses two 7-bit readings, it collects about 256 bits of noise:
+ * - 64 readings of the RSSI (the received signal strength of background radio
+ *   noise).  If the radio is already in RX (for example because radio_mac
+ *   is running), the RSSI is just read.  If the radio is idle and
+ *   <b>ownRadio</b> is 1, it is put in RX for about 5 ms and then put back
+ *   in IDLE.  Otherwise the RSSI is not used.
+ * - 64 readings of the temperature sensor and VDD/3 with 12-bit resolution.
+ *
+ * Only the 2 noisiest bits of each reading are used, so the readings are
+ * folded into 2 bits each and packed 4 to a byte before they are mixed in.
+ *
+ * \param ownRadio 1 if no radio library is running, so this function may
+ *   change the state of the radio, or 0 if the radio must be left alone.
+ *   Pass 0 if your app uses radio_mac, radio_queue, or any library built on
+ *   them: those libraries change the radio state from their ISRs, and
+ *   strobing the radio at the same time would confuse them.
+ *
+ * The state of the random number generators is kept and the noise is added
+ * to it, so calling this function again can only make things better.
+ *
+ * Side effects: This function changes ADCL, ADCH, ADCCON3, and ADCIF, like
+ * randomSeedFromAdc(), and it can take a few milliseconds.
+ */
+void randomSeedFromNoise(BIT ownRadio);
+
+/*! Mixes one byte of entropy into the state of the hardware random number
+ * generator (by running it through the CRC module) and into the software
+ * generator used by randomFast().  Must only be called from the main loop. */
+void randomAddEntropy(uint8 byte);
+
 /*! Uses the randomly-assigned 4-byte serial number of the Wixel to initialize the
  * state of the random number generator.
  * This function throws away all of the previous state of the random number generator.
@@ -32,12 +76,51 @@ void randomSeedFromAdc(void);
 void randomSeedFromSerialNumber(void);
 
 
+/*! The number of bytes that can be stored in the pool used by
+ * randomNumberFromIsr().  This is a power of two; one slot is always left
+ * empty. */
+#define RANDOM_POOL_SIZE 16
+
 /*! \return a random number between 0 and 255.
  * Before calling this function, you should call randomSeedFromAdc or
  * randomSeedFromSerialNumber to initialize the random number generator.
+ *
+ * This function waits for the hardware generator (a few clock cycles) and is
+ * not reentrant, so it must only be called from the main loop.
  */
 uint8 randomNumber(void);
 
+/*! Fills the pool used by randomNumberFromIsr() with numbers from the
+ * hardware generator.  This function does not wait: it stops as soon as the
+ * pool is full or the hardware generator is busy.
+ *
+ * This is called by randomSeed() and by the radio libraries whenever a packet
+ * is queued, but you can call it regularly from your main loop to make sure
+ * the pool stays full.  It must not be called from an ISR.
+ */
+void randomPoolService(void);
+
+/*! \return a random number between 0 and 255, without waiting.
+ *
+ * This function is meant to be called from ISRs.  It returns a byte from the
+ * pool (see randomPoolService()) mixed with a 16-bit software generator, or
+ * just the next number from the software generator if the pool is empty.
+ * It never touches the hardware generator, so it can not interfere with
+ * randomNumber() calls in the main loop.
+ *
+ * It must only be called from ISRs of one priority level; the radio libraries
+ * call it from the RF ISR.
+ */
+uint8 randomNumberFromIsr(void);
+
+/*! \return a number between 0 and 255 from a fast 16-bit software generator.
+ *
+ * The generator is seeded by randomSeed(), repeats every 65535 numbers, and
+ * only takes a few dozen instructions.  This function must only be called from
+ * the main loop (ISRs have their own generator in randomNumberFromIsr()).
+ */
+uint8 randomFast(void);
+
 
 /* Initializes the random number generator using the specified 16-bit seed.
  * \param seed_msb Any number between 0 and 255.
@@ -0,0 +1,137 @@
+/*! \file scheduler.h
+ * The <code>scheduler.lib</code> library is a small run-to-completion
+ * scheduler that can replace the usual Wixel main loop:
+ *
+\code
+while(1)
+{
+    boardService();
+    usbComService();
+    radioComTxService();
+    ...
+}
+\endcode
+ *
+ * A loop like that runs every service function as fast as it can, so the
+ * CPU is always busy and always at full power, and an urgent job has to wait
+ * for all the others.  With this library you register each piece of work as
+ * a task with a priority, and the scheduler runs only the tasks that have
+ * something to do, highest priority first, and idles the CPU (PM0, by
+ * setting PCON.IDLE) when nothing is ready.  Every interrupt wakes the CPU
+ * up again.
+ *
+ * There are two kinds of tasks:
+ * - An event task runs when events have been posted to it with
+ *   schedulerPost().  ISRs (such as RF, UART, USB, or timer_wheel.h timer
+ *   callbacks) and other tasks can post events.  Each task has 8 event flags,
+ *   and the task receives all the flags that were posted since it last ran.
+ * - A polled task (#SCHEDULER_POLLED) runs once every time the CPU wakes up
+ *   from idle.  Use this for existing service functions like
+ *   usbComService() that check for work themselves: they can only have new
+ *   work after an interrupt has happened, and the Timer 4 interrupt from
+ *   time.h wakes the CPU every millisecond anyway, so they still run often
+ *   enough to handle timeouts.
+ *
+ * Tasks can not preempt each other: a task runs until it returns.  After each
+ * task, the scheduler looks for the highest priority ready task again, so a
+ * high priority task never waits for more than one lower priority task.
+ *
+ * The scheduler measures how long each task runs (using getUs() from time.h)
+ * and how long the CPU spends idle, so you can see where the time goes.
+ *
+ * Example code:
+ *
+\code
+#define TASK_RADIO  0
+#define TASK_USB    1
+#define TASK_LEDS   2
+
+// The service functions take no arguments, so wrap them in task functions.
+// These are polled tasks, so they ignore the events.
+void radioTask(uint8 events)
+{
+    radioComTxService();
+}
+
+void usbTask(uint8 events)
+{
+    usbComService();
+}
+
+void main()
+{
+    systemInit();
+    usbInit();
+    radioComInit();
+    schedulerAddTask(TASK_RADIO, radioTask, SCHEDULER_POLLED);
+    schedulerAddTask(TASK_USB, usbTask, SCHEDULER_POLLED);
+    schedulerAddTask(TASK_LEDS, updateLeds, 0);
+    schedulerRun();
+}
+\endcode
+ *
+ * Do not cast a <code>void f(void)</code> function to #SchedulerTask: calling
+ * a function through a pointer of a different type is undefined behavior in
+ * C, so use a small wrapper like the ones above instead.
+ */
+
+#ifndef _SCHEDULER_H
+#define _SCHEDULER_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+
+/*! The number of task priorities.  Priority 0 is the highest. */
+#define SCHEDULER_MAX_TASKS 8
+
+/*! Specifies that the task should run every time the CPU wakes up, in
+ * addition to whenever events are posted to it. */
+#define SCHEDULER_POLLED    1
+
+/*! A pointer to a task function.
+ * \param events The event flags that were posted to the task since it last
+ *   ran, or 0 if the task is polled and no events were posted. */
+typedef void (*SchedulerTask)(uint8 events);
+
+/*! Registers a task.
+ *
+ * \param priority The priority of the task, from 0 (highest) to
+ *   #SCHEDULER_MAX_TASKS - 1.  Each priority can have only one task; this
+ *   number is also used to identify the task in the other functions.
+ * \param task The function to call, or 0 to remove the task.
+ * \param flags 0 or #SCHEDULER_POLLED. */
+void schedulerAddTask(uint8 priority, SchedulerTask task, uint8 flags);
+
+/*! Posts events to a task, so that it runs soon.
+ *
+ * \param priority The priority of the task.
+ * \param events The event flags to set (1-255).  What they mean is up to you.
+ *
+ * This function is reentrant, so it can be called from ISRs and from the
+ * main loop. */
+void schedulerPost(uint8 priority, uint8 events) __reentrant;
+
+/*! Runs every ready task, in priority order, until no task is ready, and
+ * then idles the CPU until the next interrupt.  Call this repeatedly if you
+ * want to do something else in your main loop too. */
+void schedulerRunOnce(void);
+
+/*! Calls schedulerRunOnce() forever.  This function does not return. */
+void schedulerRun(void);
+
+/*! \return The total time the specified task has spent running, in
+ * microseconds (modulo 2^32). */
+uint32 schedulerTaskRunTime(uint8 priority);
+
+/*! \return The number of times the specified task has run (modulo 2^32). */
+uint32 schedulerTaskRunCount(uint8 priority);
+
+/*! \return The total time the CPU has spent idle in schedulerRunOnce(), in
+ * microseconds (modulo 2^32).  This includes the time spent in ISRs while
+ * the CPU was idle. */
+uint32 schedulerIdleTime(void);
+
+/*! Sets all of the run times, run counts, and the idle time to zero. */
+void schedulerClearStatistics(void);
+
+#endif
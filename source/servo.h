@@ -0,0 +1,618 @@
+/*! \file servo.h
+ * The <code>servo.lib</code> library provides the ability to control up to 16
+ * RC servos by generating digital pulses directly from your Wixel without the
+ * need for a separate servo controller.
+ *
+ * This library uses Timer 1, so it will conflict with any other
+ * library that uses Timer 1.
+ *
+ * With the exception of servosStop(), the functions in this library are
+ * non-blocking.  Pulses are generated in the background by Timer 1 and its
+ * interrupt service routine (ISR).
+ *
+ * This library uses hardware PWM from Timer 1 to generate the servo pulses
+ * on the following pins:
+ *
+ * - P0_2
+ * - P0_3
+ * - P0_4
+ * - P1_0
+ * - P1_1
+ * - P1_2
+ *
+ * Servos on any other Port 0 or Port 1 pin are driven by software channels;
+ * see the \ref software section below.
+ *
+ * By default, the period of the servo signals generated by this library is
+ * approximately 19.11 ms (0x70000 clock cycles).  You can change it with
+ * servosSetPeriod().
+ * The allowed pulse widths range from one 24th of a microsecond to 2500
+ * microseconds, and the resolution available is one 24th of a microsecond.
+ *
+ * For example code that uses this library, please see the <code>example_servo_sequence</code>
+ * app in the Wixel SDK's <code>apps</code> directory.
+ *
+ * \section software Software channels
+ *
+ * If you pass servosStart() a pin that can not be driven by Timer 1 directly,
+ * the library will generate the pulses for that pin in software.  The
+ * software channels are split into four groups which take turns using the
+ * parts of the servo period that the hardware channels do not use, so the
+ * pulses of different groups never overlap.  Within a group, all the pulses
+ * start together and are ended in order of increasing width by an ISR.
+ *
+ * The software pulses are timed by Timer 1, just like the hardware pulses,
+ * so they have the same resolution.  Their jitter is less than 1 microsecond
+ * as long as no other interrupt with priority 3 runs for more than about
+ * 40 microseconds.  Pulses that would end within 2 microseconds of each other
+ * are ended at the same time.
+ *
+ * Software channels are only available if you define
+ * <code>SERVO_SOFTWARE_CHANNELS</code> before including servo.h in the file
+ * that contains your main() function and in every file that calls
+ * servosStart():
+ *
+\code
+#define SERVO_SOFTWARE_CHANNELS
+#include <servo.h>
+\endcode
+ *
+ * This installs the Timer 3 ISR that ends the software pulses.  Without it,
+ * the Timer 3 ISR is not linked into your app, and servosStart() returns 0
+ * without doing anything if any pin needs a software channel.
+ *
+ * When software channels are used (at least one pin passed to servosStart()
+ * is not a Timer 1 pin):
+ * - Timer 3 is used as well, so this library will conflict with any other
+ *   library that uses Timer 3.
+ * - The priority of the Timer 1 and Timer 3 interrupts is set to 3 (the
+ *   highest).  The CC2511 sets priorities for groups of interrupts, so this
+ *   also raises the ADC and P2INT interrupts (the group of Timer 1) and the
+ *   UART1 RX and TX interrupts (the group of Timer 3) to 3.  P2INT is the
+ *   USB interrupt, so an interrupt-driven USB stack can delay the software
+ *   pulses, and those interrupts can no longer be interrupted by priority 2
+ *   interrupts such as Timer 4 (used by getMs()).  uart1Init() sets the UART1
+ *   priority back to its own value, so it should be called before
+ *   servosStart() if you use both.
+ * - The ISRs spin for up to 45 microseconds at the start and the end of each
+ *   pulse, which takes less than 5% of the CPU time with 16 servos.
+ * - The software pins are driven by writing to P0 and P1 from an ISR, so your
+ *   code must not write to those registers with non-atomic read-modify-write
+ *   sequences.  Writing to individual pins (e.g. <code>P1_5 = 1;</code>) or
+ *   using setDigitalOutput() is fine.
+ *
+ * When only Timer 1 pins are used, Timer 3 is not touched and the Timer 1
+ * interrupt priority is set to 2, which also applies to the ADC and P2INT
+ * interrupts.
+ *
+ * \section wiring Wiring servos
+ *
+ * To control servos from your Wixel, you will need to wire them properly.
+ *
+ * Most standard radio control servos have three wires, each a different color.
+ * Usually, they are either black, red, and white, or they are brown, red, and orange/yellow:
+ *  - brown or black = ground (GND, battery negative terminal)
+ *  - red = servo power (Vservo, battery positive terminal)
+ *  - orange, yellow, white, or blue = servo control signal line
+ *
+ * The ground and power wires of the servo will need to be connected to a power
+ * supply that provides a voltage the servo can tolerate and which provides
+ * enough current for the servo.
+ *
+ * The ground wire of the servo also needs to be connected to one of the Wixel's
+ * GND pins.
+ * If you are powering the Wixel from the same power supply as the servos,
+ * then you have already made this connection.
+ *
+ * The signal wire of the servo needs to connect to an I/O pin of the
+ * Wixel that will be outputting servo pulses.
+ * These pins are specified by the parameters to servosStart().
+ *
+ * \section more More information about servos
+ *
+ * For more information about servos and how to control them, we
+ * recommend reading this series of blog posts by Pololu president Jan Malasek:
+ *
+ * -# <a href="http://www.pololu.com/blog/11/introduction-to-an-introduction-to-servos">Introduction to an introduction to servos</a>
+ * -# <a href="http://www.pololu.com/blog/12/introduction-to-servos">Introduction to servos</a>
+ * -# <a href="http://www.pololu.com/blog/13/gettin-all-up-in-your-servos">Gettin' all up in your servos</a>
+ * -# <a href="http://www.pololu.com/blog/15/servo-servo-motor-servomotor-definitely-not-server">Servo, servo motor, servomotor (definitely not server)</a>
+ * -# <a href="http://www.pololu.com/blog/16/electrical-characteristics-of-servos-and-introduction-to-the-servo-control-interface">
+ *    Electrical characteristics of servos and introduction to the servo control interface</a>
+ * -# <a href="http://www.pololu.com/blog/17/servo-control-interface-in-detail">Servo control interface in detail</a>
+ * -# <a href="http://www.pololu.com/blog/18/simple-hardware-approach-to-controlling-a-servo">Simple hardware approach to controlling a servo</a>
+ * -# <a href="http://www.pololu.com/blog/19/simple-microcontroller-approach-to-controlling-a-servo">Simple microcontroller approach to controlling a servo</a>
+ * -# <a href="http://www.pololu.com/blog/20/advanced-hobby-servo-control-pulse-generation-using-hardware-pwm">Advanced hobby servo control pulse generation using hardware PWM</a>
+ * -# <a href="http://www.pololu.com/blog/21/advanced-hobby-servo-control-using-only-a-timer-and-interrupts">Advanced hobby servo control using only a timer and interrupts</a>
+ * -# <a href="http://www.pololu.com/blog/22/rc-servo-speed-control">RC servo speed control</a>
+ * -# <a href="http://www.pololu.com/blog/24/continuous-rotation-servos-and-multi-turn-servos">Continuous-rotation servos and multi-turn servos</a>
+ */
+
+
+#ifndef _SERVO_H
+#define _SERVO_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+
+/*! The maximum allowed target of a servo, in microseconds. */
+#define SERVO_MAX_TARGET_MICROSECONDS  2500
+
+/*! This defines the units used by the high resolution functions in this library
+ * to represent positions and targets. */
+#define SERVO_TICKS_PER_MICROSECOND    24
+
+/*! The maximum number of servos that can be controlled at the same time. */
+#define SERVO_MAX_COUNT                16
+
+/*! A target in a keyframe that means "leave this servo alone".
+ * See #SERVO_SEQUENCE. */
+#define SERVO_KEYFRAME_UNCHANGED       0xFFFF
+
+/*! Describes a sequence of keyframes that can be played in the background
+ * by servoSequencePlay().  Sequences and their keyframes are normally stored
+ * in flash (CODE memory).
+ *
+ * The <b>keyframes</b> array contains <b>keyframeCount</b> keyframes, one
+ * after the other.  Each keyframe consists of 1 + <b>servoCount</b> numbers:
+ * -# The time to spend on this keyframe, in milliseconds, before going on to
+ *    the next one.
+ * -# Then, for each servo from 0 to <b>servoCount</b> - 1, the target of the
+ *    servo in microseconds (like servoSetTarget()), or
+ *    #SERVO_KEYFRAME_UNCHANGED.
+ *
+ * The ISR interpolates between keyframes: at the start of each keyframe, it
+ * sets the speed of each servo so that the servo moves at a constant speed
+ * from where it is to its new target and arrives in the last servo period of
+ * the keyframe.  The speed is rounded up to a whole number of 1/24
+ * microseconds per servo period, so a small move (fewer 1/24 microsecond
+ * steps than the square of the number of servo periods in the keyframe)
+ * might arrive a little early.  The speed is computed from the servo period
+ * at that time, so it stays right if you call servosSetPeriod(); a period
+ * change in the middle of a keyframe only takes effect on the speeds at the
+ * next keyframe.  If a keyframe is shorter than two servo periods, the
+ * servos jump straight to their targets.  The acceleration limits set by
+ * servoSetAcceleration() still apply, so servos with an acceleration limit
+ * might arrive later.
+ *
+ * Example code:
+ *
+ * \code
+uint16 CODE waveKeyframes[] = {
+//  time, target0, target1
+      0,    1000,    2000,  // Jump to the start pose.
+    500,    2000,    1000,  // Swap in 500 ms.
+    500,    1000,    2000,  // And back.
+};
+SERVO_SEQUENCE CODE wave = { waveKeyframes, 3, 2, 1 };
+
+servoSequencePlay(&wave);
+ * \endcode
+ */
+typedef struct SERVO_SEQUENCE
+{
+    /*! A pointer to the keyframe data. */
+    uint16 CODE * keyframes;
+
+    /*! The number of keyframes. */
+    uint8 keyframeCount;
+
+    /*! The number of servos in each keyframe.  These are servos
+     * 0 to servoCount - 1, and servoCount should not be more than the
+     * <b>numPins</b> parameter used in the last call to servosStart(). */
+    uint8 servoCount;
+
+    /*! 1 to start again at the first keyframe after the last one is done,
+     * or 0 to play the sequence once. */
+    uint8 loop;
+} SERVO_SEQUENCE;
+
+
+/*! This function starts the library;
+ * it sets up the servo pins and the timer to be ready to send servo
+ * pulses.
+ * This function should be called before any other functions in the library.
+ *
+ * \param pins  A pointer to an array of pin numbers that specifies which pins
+ *   will be used to generate servo pulses.
+ *   The pin numbers used in this array are the same as the pin numbers used
+ *   in the GPIO library (see gpio.h).  There should be no repetitions in this
+ *   array, and each entry must be a Port 0 or Port 1 pin (0-5 or 10-17).
+ *   Pins 2, 3, 4, 10, 11, and 12 are driven by the Timer 1 hardware; any
+ *   other pins are driven by software channels, which require
+ *   <code>SERVO_SOFTWARE_CHANNELS</code> (see \ref software).
+ *
+ * \param numPins The size of the pin number array (at most #SERVO_MAX_COUNT).
+ *
+ * \return 1 if the library was started, or 0 if one of the pins is not
+ *   supported.  In that case nothing is changed: if the library was running,
+ *   it keeps running with the old pins.
+ *
+ * The pins specified in the <b>pins</b> array will be configured as digital
+ * outputs, their targets will be initialized to 0 (no pulses), and their speed
+ * limits will be initialized to 0 (no speed limit).
+ *
+ * If the <b>pins</b> parameter is 0 (a null pointer), then this function skips
+ * the initialization of the pins and the internal data structures of the
+ * library.
+ * This means that the servo pin assignments, positions, targets, and speeds
+ * from before will be preserved.
+ *
+ * The parameters to this function define the correspondence of servo
+ * numbers to pins.
+ * The <b>servoNum</b> parameter in the other library functions can be thought
+ * of as an index in the <b>pins</b> array.
+ * For example, a <b>servoNumber</b> of 0 corresponds to <code>pins[0]</code>, the first pin
+ * in the array.
+ *
+ * Example code:
+ *
+ * \code
+uint8 CODE pins[] = {10, 12};  // Use P1_0 and P1_2 for servos.
+servosStart((uint8 XDATA *)pins, sizeof(pins));
+servoSetTarget(0, 1500);       // Affects pin P1_0
+servoSetTarget(1, 1500);       // Affects pin P1_2
+ * \endcode
+ */
+BIT servosStart(uint8 XDATA * pins, uint8 numPins);
+/*! Stops the library; stops sending servo pulses and turns off Timer 1.
+ * After this function runs, the pins that were used for servo pulses will
+ * all be configured as general-purpose digital outputs driving low.
+ *
+ * You can later restart the servo pulses by calling servosStart().
+ *
+ * This is a blocking function that can take up to 2.8 milliseconds to finish
+ * because it ensures that the pulses are shut off cleanly without any
+ * glitches. */
+void servosStop(void);
+
+/*! Sets the period of the servo signals.
+ *
+ * \param periodMicroseconds The period in microseconds, or 0 for the default
+ *   period of 19.11 ms.  For example, 20000 gives a period of exactly 20 ms.
+ *
+ * \return 1 if the period was changed, or 0 if it is too short for the pins
+ *   passed to servosStart() (the period is not changed in that case).
+ *
+ * Every servo pulse is generated in its own 2.73 ms Timer 1 period, and the
+ * Timer 1 registers for the pulses have to be loaded one full Timer 1 period
+ * before the pulses start, so the servo period is made of one 2.73 ms Timer 1
+ * period for each of the following that is in use, plus at least 1 ms for
+ * updating the positions:
+ * - the Port 0 hardware pins (P0_2, P0_3, P0_4): 2 Timer 1 periods
+ * - the Port 1 hardware pins (P1_0, P1_1, P1_2): 2 Timer 1 periods
+ * - each of the first 4 software channels: 1 Timer 1 period
+ *
+ * Periods shorter than 3.73 ms are never supported, and that period is only
+ * possible with a single software channel and no hardware pins.  Some other
+ * examples of the shortest periods:
+ * - Hardware pins on only one port: 6.46 ms
+ * - Hardware pins on both ports: 11.92 ms
+ * - Hardware pins on both ports and 4 or more software channels: 17.38 ms
+ *
+ * If servosStart() is called with pins that need a longer period than the one
+ * set with this function, the shortest possible period for those pins is used
+ * instead until a valid period is set again.  Use servosGetPeriod() to find
+ * out which period is actually being generated.  The resolution of the pulse
+ * widths is always 1/24 microseconds.
+ *
+ * The speed and acceleration limits are measured per servo period, so they
+ * scale with the period (see servoSetSpeed()).
+ *
+ * You can call this before or after servosStart().  If the servos are
+ * running, one servo period might have an irregular length. */
+BIT servosSetPeriod(uint16 periodMicroseconds);
+
+/*! \return The period of the servo signals that is actually being generated,
+ * in microseconds.  See servosSetPeriod(). */
+uint16 servosGetPeriod(void);
+
+/*! \returns 1 if the library is currently active and using Timer 1,
+ * or 0 if the library is stopped.
+ *
+ * Calling servosStart() changes this value to 1.
+ * Calling servosStop() changes this value to 0.
+ *
+ * Timer 1 can be used for other purposes while the servo library is stopped.
+ */
+BIT servosStarted(void);
+
+/*! \returns 1 if there are servos that are still moving towards their
+ * target position (limited by the speed limit), otherwise returns 0.
+ *
+ * This function is equivalent to, but much faster than:
+ * \code
+servoGetTarget(0) == servoGetPosition(0) &&
+servoGetTarget(1) == servoGetPosition(1) &&
+servoGetTarget(2) == servoGetPosition(2) &&
+servoGetTarget(3) == servoGetPosition(3) &&
+servoGetTarget(4) == servoGetPosition(4) &&
+servoGetTarget(5) == servoGetPosition(5)
+ * \endcode
+ */
+BIT servosMoving(void);
+/*! Sets the specified servo's target position in units of microseconds.
+ *
+ * \param servoNum  A servo number between 0 and 15.
+ *   This number should be less than the associated <b>numPins</b> parameter
+ *   used in the last call to servosStart().
+ *
+ * \param targetMicroseconds  The target position of the servo in units of
+ *   microseconds.
+ *   A typical servo responds to pulse widths between 1000 and 2000 microseconds,
+ *   so appropriate values for this parameter would be between 1000 and 2000.
+ *   The full range of allowed values for this parameter is 0-2500.
+ *   A value of 0 means to stop sending pulses, and takes effect
+ *   immediately regardless of the speed limit for the servo.
+ *
+ * This is a non-blocking function that only takes a few microseconds to execute.
+ * Servos require much more time that that to actually reach the commanded
+ * position (on the order of hundreds of milliseconds).
+ *
+ * Here is some example code:
+ *
+ * \code
+servoSetTarget(0, 1000);  // Start sending servo 0 to the 1000us position.
+servoSetTarget(1, 1500);  // Start sending servo 1 to the 1500us position.
+servoSetTarget(2, 2000);  // Start sending servo 2 to the 2000us position.
+ * \endcode
+ *
+ * If the speed limit of the servo is 0 (no speed limit), or the current target
+ * is 0, or the <b>targetMicroseconds</b> parameter is 0, then this function will
+ * have an immediate effect on the variable that represents the position of the
+ * servo (which is returned by servoGetPosition()).
+ * This allows you to perform sequences of commands like:
+ *
+ * \code
+servoSetSpeed(0, 0);
+servoSetTarget(0, 1000);  // Immediately sets position variable to 1000.
+servoSetSpeed(0, 200);
+servoSetTarget(2000);     // Starts the position variable slowly changing from 1000 to 2000.
+ * \endcode
+ *
+ * or
+ *
+ * \code
+servoSetSpeed(0, 200);
+servoSetTarget(0, 0);     // Immediately sets position variable to 0 (pulses off).
+servoSetTarget(0, 1000);  // Immediately sets position variable to 1000.
+servoSetTarget(0, 2000);  // Starts the position variable slowly changing from 1000 to 2000.
+ * \endcode
+ *
+ * These two sequences of commands each have the same effect, which is to immediately
+ * set the position variable for servo number 0 to 1000 microseconds and then slowly
+ * change it from 1000 to 2000 microseconds.
+ * Please note that the servo's actual physical position does not change immediately;
+ * it will lag behind the position variable.
+ * To make sure the servo actually reaches position 1000 before it starts moving towards 2000,
+ * you might want to add a delay after <code>servoSetTarget(0, 1000);</code>, but keep in mind
+ * that most other Wixel libraries require regular attention from the main loop.
+ *
+ * If you need more than 1-microsecond resolution, see servoSetTargetHighRes().
+ */
+void servoSetTarget(uint8 servoNum, uint16 targetMicroseconds);
+
+/*! \param servoNum  A servo number between 0 and 15.
+ *  This number should be less than the associated <b>numPins</b> parameter
+ *  used in the last call to servosStart().
+ *
+ * \return The target position of the specified servo, in units of microseconds.
+ */
+uint16 servoGetTarget(uint8 servoNum);
+
+/*! Sets the speed limit of the specified servo.
+ *
+ * \param servoNum  A servo number between 0 and 15.
+ *  This number should be less than the associated <b>numPins</b> parameter
+ *  used in the last call to servosStart().
+ *
+ * \param speed The speed limit of the servo, or 0 for no speed limit.
+ *   The valid values for this parameter are 0-65535.
+ *
+ * The speed limit is in units of 24ths of a microsecond per servo period,
+ * or 2.18 microseconds per second with the default servo period.
+ *
+ * At a speed limit of 1, the servo output would take 459 seconds to
+ * move from 1 ms to 2 ms.  More examples are shown in the table below:
+ *
+ * <table>
+ * <caption>Speed limit examples</caption>
+ * <tr><th>Speed limit</th><th>Time to change output from 1 to 2 ms (s)</th></tr>
+ * <tr><td>1</td><td>458.75</td></tr>
+ * <tr><td>7</td><td>65.54</td></tr>
+ * <tr><td>45</td><td>10.19</td></tr>
+ * <tr><td>91</td><td>5.04</td></tr>
+ * <tr><td>229</td><td>2.00</td></tr>
+ * <tr><td>458</td><td>1.00</td></tr>
+ * <tr><td>917</td><td>0.50</td></tr>
+ * <tr><td>S</td><td>458752 / (1000*S)</td></tr>
+ * </table>
+ */
+void servoSetSpeed(uint8 servoNum, uint16 speed);
+
+/*! \return The speed of the specified servo.
+ *
+ * See servoSetSpeed() for more information.
+ */
+uint16 servoGetSpeed(uint8 servoNum);
+
+/*! Sets the acceleration limit of the specified servo.
+ *
+ * \param servoNum  A servo number between 0 and 15.
+ *  This number should be less than the associated <b>numPins</b> parameter
+ *  used in the last call to servosStart().
+ *
+ * \param acceleration The acceleration limit of the servo, or 0 for no
+ *   acceleration limit.  The valid values for this parameter are 0-65535.
+ *
+ * The acceleration limit is in units of 24ths of a microsecond per servo
+ * period per servo period, or about 114 microseconds per second per second.
+ *
+ * When an acceleration limit is set, the servo follows a trapezoidal speed
+ * profile: its speed ramps up by the acceleration limit every servo period
+ * until it reaches the speed limit (see servoSetSpeed()), and it ramps back
+ * down so that it stops at the target.  The speed is always a multiple of the
+ * acceleration limit, so it levels off at the largest multiple that does not
+ * exceed the speed limit: for example, with an acceleration limit of 77 and a
+ * speed limit of 100, the servo moves at 77.  If the speed limit is 0, only the
+ * acceleration is limited.  If the target changes suddenly in the middle of a
+ * move, the servo slows down gradually, so it might pass the new target and
+ * come back to it.  Targets of 0 still take effect immediately.
+ *
+ * For example, with an acceleration limit of 4 and a speed limit of 229, a
+ * move from 1 ms to 2 ms takes about 3.1 seconds: 1.1 seconds to speed up,
+ * 0.9 seconds at full speed, and 1.1 seconds to slow down.
+ *
+ * The profiles are computed in the ISR with additions and subtractions only,
+ * so they take a bounded amount of time per servo.
+ */
+void servoSetAcceleration(uint8 servoNum, uint16 acceleration);
+
+/*! \return The acceleration limit of the specified servo.
+ *
+ * See servoSetAcceleration() for more information.
+ */
+uint16 servoGetAcceleration(uint8 servoNum);
+
+/*! \param servoNum  A servo number between 0 and 15.
+ *  This number should be less than the associated <b>numPins</b> parameter
+ *  used in the last call to servosStart().
+ * \return The current width in microseconds of pulses being sent to the
+ *   specified servo.
+ *   This will be equal to the last target set by servoSetTarget() unless
+ *   there is a speed limit enabled for the servo.
+ *
+ * Please note that this function does <em>not</em> return the actual
+ * physical position of the specified servo.
+ * This function returns the width of the pulses that are currently being
+ * sent to the servo, which is entirely determined by previous calls to
+ * servoSetTarget() and servoSetSpeed().
+ * The standard RC servo interface provides no way to query a servo for
+ * its current position.
+ */
+uint16 servoGetPosition(uint8 servoNum);
+
+/*! This is the high resolution version of servoSetTarget().
+ * The units of <b>target</b> are 24ths of a microsecond, so a value of 24000
+ * corresponds to 1000 microseconds. */
+void servoSetTargetHighRes(uint8 servoNum, uint16 target);
+
+/*! This is the high resolution version of servoGetTarget().
+ * The units of the returned target position are 24ths of a microsecond, so a
+ * value of 24000 corresponds to 1000 microseconds. */
+uint16 servoGetTargetHighRes(uint8 servoNum);
+
+/*! This is the high resolution version of servoGetPosition().
+ * The units of the returned position are 24ths of a microsecond, so a value of
+ * 24000 corresponds to 1000 microseconds. */
+uint16 servoGetPositionHighRes(uint8 servoNum);
+
+/*! Stages a new target for the specified servo, in units of microseconds.
+ * The target does not take effect until servosCommitTargets() is called.
+ *
+ * This lets you change the targets of several servos at the same time:
+ * all of the targets staged before a call to servosCommitTargets() are
+ * applied together by the ISR at the start of a servo period, so all of the
+ * servos start moving during the same period.  Staging a target does not
+ * disable any interrupts.
+ *
+ * \code
+servoStageTarget(0, 1200);
+servoStageTarget(1, 1800);
+servoStageTarget(2, 1500);
+servosCommitTargets(1);   // Move servos 0-2 so that they arrive together.
+ * \endcode
+ *
+ * The meaning of <b>targetMicroseconds</b> is the same as in servoSetTarget(). */
+void servoStageTarget(uint8 servoNum, uint16 targetMicroseconds);
+
+/*! This is the high resolution version of servoStageTarget().
+ * The units of <b>target</b> are 24ths of a microsecond. */
+void servoStageTargetHighRes(uint8 servoNum, uint16 target);
+
+/*! Commits the targets staged with servoStageTarget() since the last call to
+ * this function.  They will be applied at the start of the next servo period.
+ *
+ * \param synchronized If this is 0, each servo moves with its own speed limit
+ *   (see servoSetSpeed()).  If this is 1, the speeds of the moves are scaled
+ *   down so that all of the servos in the batch arrive at their targets in the
+ *   same servo period as the slowest one.  No servo moves faster than its
+ *   speed limit.  Servos with no speed limit, and moves from or to a target of
+ *   0, happen immediately, just like in servoSetTarget().
+ *
+ * The scaled speeds only apply to the moves in this batch; the next call to
+ * servoSetTarget() or servosCommitTargets() for a servo goes back to its
+ * speed limit.  servoGetSpeed() always returns the speed limit.
+ *
+ * If the previous batch has not been applied yet, this function waits for
+ * it, which can take up to one servo period.  You can call
+ * servosCommitPending() to avoid that.
+ *
+ * This function uses division, so it takes longer than servoSetTarget(). */
+void servosCommitTargets(BIT synchronized);
+
+/*! Starts playing a keyframe sequence from its first keyframe.  Any
+ * sequence that was already playing or queued is stopped.
+ *
+ * \param sequence The sequence to play (see #SERVO_SEQUENCE), or 0 to stop.
+ *
+ * The sequence is played by the Timer 1 ISR at the start of every servo
+ * period, so each keyframe starts within one servo period (about 20 ms) of
+ * its exact time and the main loop does not need to do anything.  The errors
+ * do not add up: the time that a keyframe runs over is taken off the next
+ * one, so a looping sequence keeps in step with the clock.  At most one
+ * keyframe is started per servo period.
+ *
+ * Calling servoSetTarget() or servosCommitTargets() for a servo in the
+ * sequence while it is playing overrides that servo until the next keyframe. */
+void servoSequencePlay(SERVO_SEQUENCE CODE * sequence);
+
+/*! Queues a sequence to play after the current one.  If a sequence is
+ * playing, the queued sequence starts when it reaches the end of its last
+ * keyframe, even if it was looping.  If no sequence is playing, the sequence
+ * starts now.  Only one sequence can be queued; queueing another one replaces
+ * it. */
+void servoSequenceQueue(SERVO_SEQUENCE CODE * sequence);
+
+/*! Stops the sequence player and discards any queued sequence.
+ * The servos stay at their current targets. */
+void servoSequenceStop(void);
+
+/*! Pauses the sequence that is playing.  Its keyframe timer stops counting
+ * until servoSequenceResume() is called, and its servos stop: a servo with an
+ * acceleration limit slows down at that limit and stops at its braking point,
+ * and any other servo stops where it is. */
+void servoSequencePause(void);
+
+/*! Resumes a sequence paused by servoSequencePause(). */
+void servoSequenceResume(void);
+
+/*! \return 1 if a sequence is playing or paused, or 0 otherwise. */
+BIT servoSequencePlaying(void);
+
+/*! \return The index of the keyframe of the current sequence that the
+ * player is on. */
+uint8 servoSequenceKeyframe(void);
+
+/*! \return 1 if the targets committed by servosCommitTargets() have not been
+ * applied by the ISR yet, or 0 otherwise. */
+BIT servosCommitPending(void);
+
+/*! Timer 1 interrupt. */
+ISR(T1, 0);
+
+#ifdef SERVO_SOFTWARE_CHANNELS
+/*! Timer 3 interrupt, used to end the pulses of software channels.  This is
+ * only declared (and therefore only linked into your app) if you define
+ * <code>SERVO_SOFTWARE_CHANNELS</code>; see \ref software. */
+ISR(T3, 0);
+
+/*! The version of servosStart() that can use software channels.  This links
+ * the Timer 3 ISR into your app, and servosStart() is defined to call it if
+ * you define <code>SERVO_SOFTWARE_CHANNELS</code>, so you do not need to call
+ * it directly. */
+BIT servosStartWithSoftwareChannels(uint8 XDATA * pins, uint8 numPins);
+#define servosStart servosStartWithSoftwareChannels
+#endif
+
+#endif
@@ -2,6 +2,23 @@
  * This file provides basic functions for putting the processor to sleep and
  * switching oscillators. See the datasheet or design note DN106 for more
  * information about the different power modes and their impact.
+ *
+ * Timer 4, which time.h uses to count milliseconds, stops in PM1, PM2 and
+ * PM3.  To keep getMs() going up at the right rate, sleepMode1(),
+ * sleepMode2() and sleepUntil() measure how long the processor slept with
+ * the Sleep Timer and add that time to getMs().  This makes it possible to
+ * write "tickless" applications that sleep until their next deadline
+ * (see sleepUntil() and timerWheelSleep()) without losing track of time.
+ *
+ * The time added is as accurate as the 32 kHz RC oscillator that drives the
+ * Sleep Timer, which is calibrated against the crystal to within about 1%,
+ * and it is rounded down to the resolution of the Sleep Timer (less than
+ * 1 ms for sleeps shorter than 64 seconds).  Fractions of a millisecond are
+ * carried over to the next sleep, so they do not add up.  A few tens of
+ * microseconds spent starting the Sleep Timer are not counted.
+ *
+ * The Sleep Timer does not run in PM3, so the time spent in sleepMode3() is
+ * lost: getMs() will not go backwards, but it will be behind.
  */
 
 #ifndef _WIXEL_SLEEP_H
@@ -19,18 +36,218 @@ void sleepInit(void);
 void switchToRCOSC(void);
 
 /*! Enters sleep mode 1 for x seconds 
- *  This will not disable any other interrupts */
+ *  This will not disable any other interrupts, so an interrupt can end the
+ *  sleep early.  The time spent asleep is added to getMs(). */
 void sleepMode1(uint16 seconds);
 
 /*! Enters sleep mode 2 for x seconds
  *  This will disable all interrupts except the sleep timer
- *  and restore them after sleeping 
+ *  and restore them after sleeping.  It uses DMA channel 0 for a moment
+ *  (see DN106); the DMA channels that were armed are armed again afterwards.
+ *  The time spent asleep is added to getMs().
  */
 void sleepMode2(uint16 seconds);
 
 /*! Enters sleep mode 3 until an external interrupt occurs
- *  Note that the sleep timer cannot be used to wake up from PM3 
+ *  Note that the sleep timer cannot be used to wake up from PM3,
+ *  and the time spent in PM3 is not added to getMs().
  */
 void sleepMode3();
 
+/*! Set this to 1 to make the sleep functions return as soon as the
+ *  processor wakes up, still running on the 12 MHz HS RC oscillator, instead
+ *  of first waiting for the 48 MHz crystal oscillator to start (which takes
+ *  about 650 microseconds, during which the processor just waits).  The
+ *  default is 0.
+ *
+ *  This is useful for applications that wake up, do a little work like
+ *  reading the ADC or updating a counter, and go back to sleep.  While
+ *  running on the HS RC oscillator:
+ *  - The CPU and the timer ticks run at 12 MHz, so code runs half as fast
+ *    and delayMicroseconds() delays twice as long.  getMs() and getUs()
+ *    still count correctly, to within the accuracy of the oscillator
+ *    (about 1%).
+ *  - The radio, USB, and anything else that needs an accurate clock (like
+ *    the UART baud rates) can not be used.  Call sleepCrystalStart() first.
+ */
+extern uint8 sleepFastWake;
+
+/*! Starts the 48 MHz crystal oscillator, waits until it is stable, and makes
+ *  it the system clock (by calling boardClockInit()).  Does nothing if the
+ *  crystal oscillator is already the system clock.  Call this after waking up
+ *  with #sleepFastWake set, before using the radio or USB. */
+void sleepCrystalStart(void);
+
+/*! Typical current drawn by the Wixel in each state, used by
+ *  sleepWakeChargeNc() and sleepEstimateChargeUc().  These are rough values
+ *  for the CC2511; measure your own board for better estimates.  The radio
+ *  currents are in addition to the current drawn by the processor. */
+#define SLEEP_CURRENT_RC_UA             4000
+#define SLEEP_CURRENT_CRYSTAL_START_UA  5000
+#define SLEEP_CURRENT_CRYSTAL_UA        9000
+#define SLEEP_CURRENT_PM0_UA            4000
+#define SLEEP_CURRENT_PM1_UA            200
+#define SLEEP_CURRENT_PM2_NA            500
+#define SLEEP_CURRENT_RADIO_RX_UA       12000
+#define SLEEP_CURRENT_RADIO_TX_UA       18000
+
+/*! \return The number of times the processor has woken up from PM1, PM2 or
+ *  PM3 and then gone back to sleep again.  A call to sleepUntil() that
+ *  sleeps in several parts (for example PM2 and then PM1) counts as one
+ *  wake-up, because the crystal oscillator is only started once, at the
+ *  end of the wait.
+ *
+ *  The functions below report how the time between waking up and going back
+ *  to sleep was spent, added up over all of those wake-ups.  Divide by this
+ *  number to get the average for one wake-up. */
+uint32 sleepWakeCount(void);
+
+/*! \return The total time spent running on the HS RC oscillator after waking
+ *  up, in microseconds. */
+uint32 sleepWakeRcUs(void);
+
+/*! \return The total time spent waiting for the crystal oscillator to start
+ *  after waking up, in microseconds. */
+uint32 sleepWakeCrystalStartUs(void);
+
+/*! \return The total time spent running on the crystal oscillator after
+ *  waking up, in microseconds. */
+uint32 sleepWakeCrystalUs(void);
+
+/*! \return An estimate of the average charge used while the processor was
+ *  awake for each wake-up, in nanocoulombs (multiply by the supply voltage
+ *  to get nanojoules).  It is computed from the times above and the
+ *  SLEEP_CURRENT_*_UA values, and does not include the radio. */
+uint32 sleepWakeChargeNc(void);
+
+/*! Sets sleepWakeCount() and all of the wake-up times to zero. */
+void sleepClearWakeStatistics(void);
+
+/*! Puts the CPU in idle mode (PM0) until the next interrupt and adds the
+ *  time to the PM0 residency (see sleepResidencyMs()).  The Timer 4
+ *  interrupt wakes it up at least once per millisecond.
+ *  delayMsIdle(), sleepUntil() and the scheduler in scheduler.h all idle the
+ *  CPU with this function.
+ *
+ *  This function enables interrupts (EA = 1) right before it goes idle, in
+ *  the instruction just before the one that sets PCON.IDLE.  To avoid missing
+ *  an interrupt that arrives after you check whether there is work to do,
+ *  disable interrupts before the check and call this function only if there
+ *  is nothing to do.
+ *
+ *  \return The time spent idle, in microseconds (measured with getUs()). */
+uint32 sleepIdle(void);
+
+/*! The processor is running (including the time spent in ISRs and
+ *  delays that do not idle the CPU). */
+#define SLEEP_STATE_ACTIVE  0
+/*! The CPU is idle in PM0 (see sleepIdle()). */
+#define SLEEP_STATE_PM0     1
+/*! The processor is in PM1. */
+#define SLEEP_STATE_PM1     2
+/*! The processor is in PM2. */
+#define SLEEP_STATE_PM2     3
+/*! The processor is in PM3. */
+#define SLEEP_STATE_PM3     4
+/*! The number of SLEEP_STATE_* values. */
+#define SLEEP_STATE_COUNT   5
+
+/*! \return The time spent in the specified power state (one of the
+ *  SLEEP_STATE_* values) since the last call to sleepClearResidency() (or
+ *  since timeInit()), in milliseconds.
+ *
+ *  The active time is the time measured by getMs() minus the time in all
+ *  of the other states.  Since the Sleep Timer does not run in PM3, the
+ *  time in PM3 is not measured at all: it is always 0, and it is not
+ *  included in the active time either.  Use sleepResidencyCount() to see
+ *  how often PM3 was used.
+ *
+ *  Example code that prints the duty cycle:
+ *
+\code
+printf("active %lu ms, PM0 %lu ms, PM1 %lu ms, PM2 %lu ms\r\n",
+    sleepResidencyMs(SLEEP_STATE_ACTIVE), sleepResidencyMs(SLEEP_STATE_PM0),
+    sleepResidencyMs(SLEEP_STATE_PM1), sleepResidencyMs(SLEEP_STATE_PM2));
+\endcode
+ */
+uint32 sleepResidencyMs(uint8 state);
+
+/*! \return The number of times the specified power state (other than
+ *  #SLEEP_STATE_ACTIVE) was entered since the last call to
+ *  sleepClearResidency(). */
+uint32 sleepResidencyCount(uint8 state);
+
+/*! Sets all of the residency times and counts to zero. */
+void sleepClearResidency(void);
+
+/*! \return An estimate of the charge drawn from the battery since the last
+ *  call to sleepClearResidency(), in microcoulombs, computed from the
+ *  residency times and the SLEEP_CURRENT_* values.  Divide by the time to
+ *  get the average current.
+ *
+ *  \param radioRxMs The time the radio spent receiving, in milliseconds.
+ *  \param radioTxMs The time the radio spent transmitting, in milliseconds.
+ *
+ *  If you are using radio_mac.h (directly or through one of the
+ *  higher-level radio libraries), you can get the radio times from
+ *  radioMacResidencyMs():
+ *
+\code
+uint32 charge = sleepEstimateChargeUc(radioMacResidencyMs(RADIO_MAC_RESIDENCY_RX),
+    radioMacResidencyMs(RADIO_MAC_RESIDENCY_TX));
+\endcode
+ *
+ *  The active time is all counted at #SLEEP_CURRENT_CRYSTAL_UA, even if some
+ *  of it was spent running on the HS RC oscillator (see #sleepFastWake). */
+uint32 sleepEstimateChargeUc(uint32 radioRxMs, uint32 radioTxMs);
+
+/*! Passed to sleepUntil() to sleep until an external interrupt. */
+#define SLEEP_NO_DEADLINE 0xFFFFFFFF
+
+/*! The deepest power mode (0-3) that sleepUntil() is allowed to use.
+ *  The default is 2.
+ *
+ *  PM1 keeps all of the interrupts enabled, so a port interrupt can wake the
+ *  processor up early (sleepUntil() will then go back to sleep).  PM2 only
+ *  lets the Sleep Timer wake it up.  PM3 is only used with
+ *  #SLEEP_NO_DEADLINE because the Sleep Timer does not run in PM3.
+ *
+ *  Even when this allows PM1 or higher, sleepUntil() stays in PM0 while
+ *  any of these is true, because PM1-PM3 stop the crystal oscillator:
+ *  - USB power is present;
+ *  - the radio is not idle (MARCSTATE is not IDLE or SLEEP), for example
+ *    because radio_mac.h is keeping it in RX;
+ *  - a DMA channel is armed;
+ *  - a UART has its receiver enabled, or is sending or receiving a byte.
+ *
+ *  Set this to 0 if you are using other peripherals that need the crystal
+ *  oscillator or Timer 4 while you wait, such as the servo library or PWM
+ *  outputs. */
+extern uint8 sleepMaxPowerMode;
+
+/*! Waits until getMs() reaches the specified time, spending as much of the
+ *  wait as possible in a low power mode.
+ *
+ *  \param deadlineMs The time to wake up, in the same units as getMs(), or
+ *    #SLEEP_NO_DEADLINE.
+ *
+ *  For each part of the wait, this function picks the deepest power mode
+ *  allowed by #sleepMaxPowerMode that fits in the time remaining: PM2 for
+ *  waits of 20 ms or more, PM1 for waits of 4 ms or more, and PM0 (with the
+ *  Timer 4 interrupt waking the processor every millisecond) for the rest.
+ *  The Sleep Timer resolution (WOR_RES) and EVENT0 are chosen automatically,
+ *  so waits from a few milliseconds to several hours are supported.  Since
+ *  Timer 4 stops in PM1 and PM2, the time spent asleep is measured with the
+ *  Sleep Timer and added to the time returned by getMs().
+ *
+ *  PM1 and PM2 are never used while USB power is present, the radio is
+ *  busy, a DMA channel is armed, or a UART is in use (see
+ *  #sleepMaxPowerMode).
+ *
+ *  With #SLEEP_NO_DEADLINE, this function sleeps once in the deepest allowed
+ *  power mode and returns after waking up.
+ *
+ *  sleepInit() must be called before using this function. */
+void sleepUntil(uint32 deadlineMs);
+
 #endif
\ No newline at end of file
@@ -29,10 +29,55 @@
  * This function is called by systemInit(). */
 void timeInit();
 
+/*! Sets the period of Timer 4 to match the current timer tick speed
+ * (CLKCON.TICKSPD), so that it keeps overflowing every millisecond.  Only
+ * 24 MHz and 12 MHz timer ticks are supported.  boardClockInit() and the
+ * fast wake-up code in sleep.h call this whenever they change the clock, so
+ * you only need to call it if you change CLKCON yourself.
+ *
+ * This function is called by timeInit(). */
+void timeUpdateTickSpeed();
+
 /*! Returns the number of milliseconds that have elapsed since timeInit()
- * was called. */
+ * was called.
+ *
+ * This function does not disable any interrupts; if the Timer 4 interrupt
+ * happens while it is reading the time, it simply reads the time again.
+ *
+ * Timer 4 stops in the sleep modes PM1, PM2 and PM3.  The functions in
+ * sleep.h add the time spent in PM1 and PM2 when the processor wakes up, so
+ * this time keeps going up across those sleeps; see sleep.h for how
+ * accurate that is. */
 uint32 getMs();
 
+/*! Returns the number of microseconds that have elapsed since timeInit()
+ * was called, computed from getMs() and the current count of Timer 4.
+ *
+ * The resolution is about 5.3 microseconds (10.7 microseconds while the
+ * timer ticks are 12 MHz).  Since each millisecond counted
+ * by getMs() is really 188 Timer 4 ticks (1.0027 ms), the microseconds within
+ * each millisecond are scaled to fit, so the result always increases but is
+ * slightly uneven.  The value overflows every 71 minutes, so use unsigned
+ * subtraction to compute intervals.
+ *
+ * This function is reentrant, does not use any multiplication, and does not
+ * disable any interrupts, so it can be called from an ISR, for example to
+ * measure how long the ISR takes. */
+uint32 getUs() __reentrant;
+
+/*! If this is not 0, the Timer 4 ISR calls the function it points to once
+ * per millisecond, after incrementing the time.  It is used by
+ * timer_wheel.h.  The function runs in the ISR, so it must be short.
+ *
+ * Because the Timer 4 ISR contains a function call, SDCC makes it save and
+ * restore all of the registers it might need, even when this pointer is 0.
+ * That costs about 3 microseconds per millisecond (0.3% of the CPU time),
+ * and adds the same amount to the latency of interrupts that can not
+ * interrupt the Timer 4 ISR.  Calling the timer wheel directly instead of
+ * through this pointer would not help, because SDCC saves the registers for
+ * any call made from an ISR. */
+extern void (*timeMsHook)(void);
+
 /*! This interrupt fires once per millisecond (approximately) and
  * increments timeMs. */
 ISR(T4, 0);
@@ -51,4 +96,19 @@ void delayMicroseconds(uint8 microseconds);
  *  will be slightly longer than specified. */
 void delayMs(uint16 milliseconds);
 
+/*! \param milliseconds  The number of milliseconds delay; any value between 0 and 65535.
+ *
+ *  This function delays for the specified number of milliseconds like
+ *  delayMs(), but it puts the CPU in idle mode (PM0) for most of the delay,
+ *  so it uses much less power.  The CPU is woken up by the Timer 4 interrupt
+ *  every millisecond and by any other interrupt, so ISRs still run on time.
+ *  The delay is measured with getUs() from the moment this function is
+ *  called, so interrupts do not make it longer (unless an ISR is still
+ *  running when the delay ends).  The last millisecond of the delay is a busy
+ *  wait, which makes the delay accurate to about 10 microseconds.
+ *
+ *  This requires timeInit(); if the Timer 4 interrupt is not enabled, this
+ *  function just calls delayMs(). */
+void delayMsIdle(uint16 milliseconds);
+
 #endif
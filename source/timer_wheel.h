@@ -0,0 +1,139 @@
+/*! \file timer_wheel.h
+ * The <code>timer_wheel.lib</code> library lets you schedule functions to be
+ * called after a delay, or periodically, with millisecond resolution.
+ *
+ * Instead of checking something like
+ * <code>if ((uint8)(getMs() - lastTime) > 20)</code> in your main loop for
+ * every periodic job, you can start a timer once and have its callback
+ * called at the right time.
+ *
+ * The timers are kept in a hierarchical timer wheel which is advanced by the
+ * Timer 4 ISR from time.h every millisecond.  Starting and cancelling a timer
+ * take the same short time no matter how many timers are running, and the
+ * ISR only has to look at the timers that are due (plus, once every 64 ms, a
+ * group of timers that are getting close to their time).
+ *
+ * Each timer's callback is called in one of two contexts:
+ * - By default, the ISR marks the timer as due and the callback is called
+ *   the next time your main loop calls timerWheelService().
+ * - With #TIMER_WHEEL_ISR, the callback is called directly from the Timer 4
+ *   ISR.  This gives precise timing, but the callback must be short and must
+ *   follow the usual rules for ISR code.
+ *
+ * The timers come from a static pool of #TIMER_WHEEL_POOL_SIZE timers in
+ * XDATA.  To change its size, define TIMER_WHEEL_POOL_SIZE (up to 254) when
+ * compiling the library.
+ *
+ * You must call timeInit() (or systemInit()) and timerWheelInit() before
+ * using this library.
+ *
+ * If your main loop has nothing else to do, it can call timerWheelSleep() to
+ * spend the time until the next timer in a low power mode (see sleep.h).
+ */
+
+#ifndef _TIMER_WHEEL_H
+#define _TIMER_WHEEL_H
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+
+#ifndef TIMER_WHEEL_POOL_SIZE
+/*! The number of timers in the pool. */
+#define TIMER_WHEEL_POOL_SIZE 16
+#endif
+
+/*! Returned by timerWheelStart() if there are no free timers. */
+#define TIMER_WHEEL_INVALID 0xFF
+
+/*! Specifies that the timer's callback should be called from the Timer 4
+ * ISR instead of from timerWheelService(). */
+#define TIMER_WHEEL_ISR     1
+
+/*! A pointer to a function that is called when a timer expires.
+ * \param timer The number of the timer, as returned by timerWheelStart(). */
+typedef void (*TimerWheelCallback)(uint8 timer);
+
+/*! Sets up the library and starts advancing the timer wheel from the Timer 4
+ * ISR.  Any timers that were running are discarded. */
+void timerWheelInit(void);
+
+/*! Starts a new timer.
+ *
+ * \param delayMs The number of milliseconds until the first call to the
+ *   callback.  A delay of 0 is treated as 1.
+ * \param periodMs For a periodic timer, the number of milliseconds between
+ *   calls to the callback after the first one.  For a one-shot timer, 0.
+ * \param callback The function to call when the timer expires.
+ * \param flags 0 or #TIMER_WHEEL_ISR.
+ *
+ * \return The number of the timer, which you can pass to timerWheelCancel(),
+ *   or #TIMER_WHEEL_INVALID if all of the timers in the pool are in use.
+ *
+ * A one-shot timer goes back into the pool after its callback returns, so
+ * its number should not be used after that.
+ *
+ * This function is reentrant, so it can be called from the main loop and
+ * from callbacks (in either context).
+ *
+ * Example code:
+ *
+\code
+void blink(uint8 timer)
+{
+    LED_YELLOW_TOGGLE();
+}
+
+timerWheelStart(500, 500, blink, 0);   // Toggle the LED every 500 ms.
+\endcode
+ */
+uint8 timerWheelStart(uint32 delayMs, uint32 periodMs, TimerWheelCallback callback, uint8 flags) __reentrant;
+
+/*! Stops the specified timer and returns it to the pool.  If the timer's
+ * callback was waiting to be called by timerWheelService(), it will not be
+ * called.  Does nothing if the timer is not running.
+ *
+ * This function is reentrant, so a periodic timer can cancel itself from its
+ * own callback. */
+void timerWheelCancel(uint8 timer) __reentrant;
+
+/*! \return 1 if the specified timer is running (or waiting for its callback
+ * to be called), 0 otherwise. */
+BIT timerWheelActive(uint8 timer);
+
+/*! Calls the callbacks of all the main loop timers that have expired.
+ * You should call this regularly from your main loop.
+ *
+ * If a periodic timer expires several times before this function gets to it,
+ * its callback is only called once. */
+void timerWheelService(void);
+
+/*! Finds the time when the next timer will expire.
+ *
+ * \param deadlineMs Receives the time, in the same units as getMs(), if
+ *   there is a running timer.
+ *
+ * \return 1 if there is a running timer, 0 otherwise. */
+BIT timerWheelNextDeadline(uint32 XDATA * deadlineMs);
+
+/*! Sleeps until just before the next timer expires, using sleepUntil() from
+ * sleep.h, which picks the deepest power mode that fits.  If no timers are
+ * running, this calls sleepUntil() with #SLEEP_NO_DEADLINE.  Returns
+ * immediately if a main loop callback is waiting for timerWheelService().
+ *
+ * After waking up, the Timer 4 ISR notices that getMs() has jumped forward
+ * and catches the wheel up, so any timers that are due will expire on the
+ * next tick.
+ *
+ * Example code:
+ *
+\code
+while(1)
+{
+    timerWheelService();
+    timerWheelSleep();
+}
+\endcode
+ */
+void timerWheelSleep(void);
+
+#endif
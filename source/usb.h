@@ -22,6 +22,7 @@
 #define _USB_H
 
 #include <cc2511_types.h>
+#include <cc2511_map.h>
 
 /*! This is the Vendor ID assigned to Pololu Corporation by the USB
  * Implementers Forum (USB-IF).
@@ -226,7 +227,7 @@ typedef struct USB_DESCRIPTOR_ENDPOINT
  * This macro evaluates to a line of C code that defines a static #uint16 array
  * in #CODE space with the specified name.
  *
- * See the usb_cdc_acm.c for an example use. */
+ * See the usb_cdc_acm_device.c for an example use. */
 #define DEFINE_STRING_DESCRIPTOR(name,char_count,...) static uint16 CODE name[] = { (2*(char_count+1)) | (USB_DESCRIPTOR_TYPE_STRING<<8), __VA_ARGS__ };
 
 /* PROTOTYPES DEFINED BY LIBUSB ***********************************************/
@@ -255,9 +256,85 @@ void usbInit(void);
  * This function calls the usbCallback* functions when needed.
  *
  * This function should be called regularly (more often than every 50&nbsp;ms).
+ *
+ * After usbEnableInterrupt(), this function only checks whether USB power
+ * has been connected or disconnected and turns the USB module on or off;
+ * everything else is done in the USB ISR.
  */
 void usbPoll(void);
 
+/*! Switches the USB library to interrupt-driven mode.
+ *
+ * Normally, the USB library only responds to the host when your main loop
+ * calls usbPoll() (which usbComService() and usbHidService() do), so a long
+ * operation in the main loop (like a delayMs() call or a slow I2C
+ * transaction) delays enumeration and control transfers, and a delay of more
+ * than about 50&nbsp;ms can make the host give up on the device.
+ *
+ * After this function is called, the USB ISR handles USB Reset, Suspend, and
+ * Resume, and all of the Endpoint 0 (control transfer) traffic, so the
+ * device enumerates and answers control requests even while the main loop is
+ * busy.
+ *
+ * The usbCallback* functions are then called from the ISR, in interrupt
+ * context.  If you write your own, they must not call any non-reentrant
+ * function that the main loop might be in the middle of, such as getMs(),
+ * usbReadFifo(), or code that uses SDCC's 16-bit or 32-bit multiplication
+ * and division helpers, and they should be short.  The ones in the
+ * usb_cdc_acm, usb_hid, and usb_cdc_hid libraries only answer the request and
+ * record what happened; the usb_cdc_acm library calls the application's line
+ * state and line coding callbacks (and starts the bootloader) later, from
+ * usbComService().
+ *
+ * The ISR also records which non-zero endpoints have had activity in
+ * #usbInEndpointEvents and #usbOutEndpointEvents, and every USB event wakes
+ * the CPU up from PM0, so the main loop can idle (for example with the
+ * scheduler in scheduler.h) and still respond to USB quickly.  Moving data
+ * on the non-zero endpoints is still done by the main loop.
+ *
+ * You must still call usbPoll() (or usbComService() or usbHidService())
+ * regularly, because connecting and disconnecting USB power are detected
+ * there, but it no longer matters if those calls are late.  The device will
+ * not connect to the USB bus until the first such call (this function makes
+ * one).
+ *
+ * The USB ISR is only linked into your app if you define
+ * <code>USB_INTERRUPT_MODE</code> before including usb.h in the source file
+ * that contains your main() function:
+ *
+\code
+#define USB_INTERRUPT_MODE
+#include <usb.h>
+\endcode
+ *
+ * Do not call this function without it: the USB interrupt would be enabled
+ * with no ISR to clear it.
+ *
+ * The USB interrupt shares its vector with the Port 2 interrupt, so you can
+ * not use Port 2 pin interrupts in interrupt-driven mode. */
+void usbEnableInterrupt(void);
+
+/*! In interrupt-driven mode (see usbEnableInterrupt()), the USB ISR sets
+ * bit n of this byte whenever IN endpoint n (1-5) has finished sending a
+ * packet, so it is ready for more data.  The USB library never clears these
+ * bits; you can clear the ones you have dealt with, for example:
+ * <code>usbInEndpointEvents &= ~(1<<4);</code>
+ * (This compiles to a single instruction, so it can not interfere with the
+ * ISR.) */
+extern volatile uint8 DATA usbInEndpointEvents;
+
+/*! In interrupt-driven mode (see usbEnableInterrupt()), the USB ISR sets
+ * bit n of this byte whenever OUT endpoint n (1-5) has received a packet.
+ * See #usbInEndpointEvents. */
+extern volatile uint8 DATA usbOutEndpointEvents;
+
+#ifdef USB_INTERRUPT_MODE
+/*! The USB interrupt.  It is only enabled after usbEnableInterrupt() is
+ * called, and only declared (and therefore only linked into your app) if you
+ * define <code>USB_INTERRUPT_MODE</code>; see usbEnableInterrupt(). */
+ISR(USB, 0);
+#endif
+
 /*! Tells the USB library to start a Control Read
  * (Device-to-Host) transfer.
  *
@@ -319,16 +396,35 @@ void usbInitEndpointOut(uint8 endpointNumber, uint8 maxPacketSize);
  * This is equivalent to writing data to the FIFO register (e.g. USBF4)
  * one byte at a time.
  * Please refer to the CC2511 datasheet to understand when you can and
- * can not write data to a USB FIFO. */
+ * can not write data to a USB FIFO.
+ *
+ * The copying is done by an unrolled assembly loop which disables
+ * interrupts for up to about a microsecond at a time. */
 void usbWriteFifo(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer);
 
 /*! Reads data from a USB FIFO and writes to the specified memory buffer.
  * This is equivalent to reading data from the FIFO register (e.g. USBF4)
  * one byte at a time.
  * Please refer to the CC2511 datasheet to understand when you can and
- * can not read data from a USB FIFO. */
+ * can not read data from a USB FIFO.
+ *
+ * The copying is done by an unrolled assembly loop which disables
+ * interrupts for up to about a microsecond at a time. */
 void usbReadFifo(uint8 endpointNumber, uint8 count, uint8 XDATA * buffer);
 
+/*! Does the same thing as usbWriteFifo(), but uses DMA channel
+ * #DMA_CHANNEL_USB to copy the data.  Setting up the DMA channel takes some
+ * time, so this is only faster for large transfers, such as full 64-byte
+ * packets.  The CPU waits for the transfer to finish.
+ *
+ * You must call dmaInit() (or systemInit()) before using this function, and
+ * it must not be called from an ISR. */
+void usbWriteFifoDma(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer);
+
+/*! Does the same thing as usbReadFifo(), but uses DMA channel
+ * #DMA_CHANNEL_USB to copy the data.  See usbWriteFifoDma(). */
+void usbReadFifoDma(uint8 endpointNumber, uint8 count, uint8 XDATA * buffer);
+
 /*! Returns 1 if we are connected to a USB bus that is suspended.
  * Returns 0 otherwise.
  *
@@ -419,13 +515,13 @@ extern volatile BIT usbActivityFlag;
 /*! The device's Device Descriptor.
  *
  * This must be defined by higher-level code.
- * See usb_cdc_acm.c for an example. */
+ * See usb_cdc_acm_device.c for an example. */
 extern USB_DESCRIPTOR_DEVICE CODE usbDeviceDescriptor;
 
 /*! The number of string descriptors on this device.
  *
  * This must be defined by higher-level code.
- * See usb_cdc_acm.c for an example. */
+ * See usb_cdc_acm_device.c for an example. */
 extern uint8 CODE usbStringDescriptorCount;
 
 /*! An array of pointers to the string descriptors.
@@ -433,7 +529,7 @@ extern uint8 CODE usbStringDescriptorCount;
  * The second entry corresponds to string descriptor 1, etc.
  *
  * This must be defined by higher-level code.
- * See usb_cdc_acm.c for an example. */
+ * See usb_cdc_acm_device.c for an example. */
 extern uint16 CODE * CODE usbStringDescriptors[];
 
 /*! This is called by usbPoll() whenever a new request (SETUP packet) is received
@@ -446,7 +542,7 @@ extern uint16 CODE * CODE usbStringDescriptors[];
  * In this case, the USB library will respond to the host with a STALL packet.
  *
  * This function must be defined by higher-level code.
- * See usb_cdc_acm.c for an example. */
+ * See usb_cdc_acm_device.c for an example. */
 void usbCallbackSetupHandler(void);
 
 /*! This is called by usbPoll() whenever a Get Descriptor request is received by
@@ -466,7 +562,7 @@ void usbCallbackClassDescriptorHandler(void);
  * to initialize all the non-zero endpoints that it uses.
  *
  * This function must be defined by higher-level code.
- * See usb_cdc_acm.c for an example. */
+ * See usb_cdc_acm_device.c for an example. */
 void usbCallbackInitEndpoints(void);
 
 /*! This is called by usbPoll() when all the data for a Control Write
@@ -0,0 +1,72 @@
+/*! \file usb_cdc_constants.h
+ * This file contains the constants used by the <code>usb_cdc_acm.lib</code>
+ * library to describe its virtual COM port to the USB host: the interface and
+ * endpoint numbers it uses, and codes from the USB CDC 1.20 and PSTN 1.20
+ * specifications, available for download from USB Implementers Forum at this
+ * url:
+ * http://www.usb.org/developers/devclass_docs
+ *
+ * Libraries that build their own USB descriptors around the CDC ACM
+ * functions, such as <code>usb_cdc_hid.lib</code> (see usb_cdc_hid.h), use
+ * these to make sure their descriptors match what usb_cdc_acm.c does.
+ */
+
+#ifndef _USB_CDC_CONSTANTS_H
+#define _USB_CDC_CONSTANTS_H
+
+#include <cc2511_map.h>
+
+/* CDC ACM Library Configuration **********************************************/
+// Note: USB 2.0 says that the maximum packet size for full-speed bulk endpoints
+// can only be 8, 16, 32, or 64 bytes.
+// We picked endpoint 4 for the data because it has a 256-byte FIFO memory area,
+// which is exactly enough for us to have two 64-byte IN buffers and two 64-byte
+// OUT buffers.
+
+#define CDC_OUT_PACKET_SIZE          64
+#define CDC_IN_PACKET_SIZE           64
+#define CDC_CONTROL_INTERFACE_NUMBER 0
+#define CDC_DATA_INTERFACE_NUMBER    1
+
+#define CDC_NOTIFICATION_ENDPOINT    1
+#define CDC_NOTIFICATION_FIFO        USBF1   // This must match CDC_NOTIFICATION_ENDPOINT!
+
+#define CDC_DATA_ENDPOINT            4
+#define CDC_DATA_FIFO                USBF4   // This must match CDC_DATA_ENDPOINT!
+
+/* CDC and ACM Constants ******************************************************/
+
+// USB Class Codes
+#define CDC_CLASS 2                  // (CDC 1.20 Section 4.1: Communications Device Class Code).
+#define CDC_DATA_INTERFACE_CLASS 0xA // (CDC 1.20 Section 4.5: Data Class Interface Codes).
+
+// USB Subclass Codes
+#define CDC_SUBCLASS_ACM  2           // (CDC 1.20 Section 4.3: Communications Class Subclass Codes).  Refer to USBPSTN1.2.
+
+// USB Protocol Codes
+#define CDC_PROTOCOL_V250 1          // (CDC 1.20 Section 4.4: Communications Class Protocol Codes).
+
+// USB Descriptor types from CDC 1.20 Section 5.2.3, Table 12
+#define CDC_DESCRIPTOR_TYPE_CS_INTERFACE 0x24
+#define CDC_DESCRIPTOR_TYPE_CS_ENDPOINT  0x25
+
+// USB Descriptor sub-types from CDC 1.20 Table 13: bDescriptor SubType in Communications Class Functional Descriptors
+#define CDC_DESCRIPTOR_SUBTYPE_HEADER                       0
+#define CDC_DESCRIPTOR_SUBTYPE_CALL_MANAGEMENT              1
+#define CDC_DESCRIPTOR_SUBTYPE_ABSTRACT_CONTROL_MANAGEMENT  2
+#define CDC_DESCRIPTOR_SUBTYPE_UNION                        6
+
+// Request Codes from CDC 1.20 Section 6.2: Management Element Requests.
+#define ACM_GET_ENCAPSULATED_RESPONSE 0
+#define ACM_SEND_ENCAPSULATED_COMMAND 1
+
+// Request Codes from PSTN 1.20 Table 13.
+#define ACM_REQUEST_SET_LINE_CODING 0x20
+#define ACM_REQUEST_GET_LINE_CODING 0x21
+#define ACM_REQUEST_SET_CONTROL_LINE_STATE 0x22
+
+// Notification Codes from PSTN 1.20 Table 30.
+#define ACM_NOTIFICATION_RESPONSE_AVAILABLE 0x01
+#define ACM_NOTIFICATION_SERIAL_STATE 0x20
+
+#endif
@@ -0,0 +1,68 @@
+/*! \file usb_cdc_hid.h
+ * The <code>usb_cdc_hid.lib</code> library implements a composite USB device
+ * with two functions: a virtual COM port (CDC ACM, see usb_com.h) and an HID
+ * joystick (see usb_hid.h).  Use it when you need a serial data channel and a
+ * low-latency joystick at the same time.
+ *
+ * The USB interfaces and endpoints are allocated like this:
+ *
+ * <table>
+ * <tr><th>Interface</th><th>Function</th><th>Endpoint</th><th>FIFO size</th></tr>
+ * <tr><td>0</td><td>CDC ACM control</td><td>1 IN (interrupt)</td><td>32 bytes</td></tr>
+ * <tr><td>1</td><td>CDC ACM data</td><td>4 IN and OUT (bulk)</td><td>256 bytes</td></tr>
+ * <tr><td>2</td><td>HID joystick</td><td>3 IN (interrupt, every 1 ms)</td><td>128 bytes</td></tr>
+ * </table>
+ *
+ * Endpoints 2 and 5 are not used.  The two CDC ACM interfaces are grouped by
+ * an Interface Association Descriptor, so the host knows they make up one
+ * function.
+ *
+ * The virtual COM port works exactly as described in usb_com.h, and the
+ * joystick works as described for #usbHidJoystickInput and
+ * #usbHidJoystickInputUpdated in usb_hid.h.  The keyboard and mouse
+ * interfaces of usb_hid.h are not available.
+ *
+ * To use this library, link your app with <code>usb_cdc_hid.lib</code>,
+ * <code>usb_cdc_acm.lib</code>, and <code>usb_hid.lib</code>, in that order,
+ * so that the USB descriptors and callbacks come from this library instead of
+ * usb_cdc_acm_device.c or usb_hid.c.  Only the joystick part of
+ * <code>usb_hid.lib</code> (usb_hid_joystick.c) gets linked in.  Call
+ * usbInit() and then call usbCdcHidService() regularly instead of
+ * usbComService() and usbHidService().  Do not call usbHidService() or
+ * usbHidKeyCodeFromAsciiChar(): they would pull in usb_hid.c, whose
+ * descriptors and callbacks conflict with the ones in this library.
+ *
+ * The USB descriptors are fixed, not built at run time: the interfaces and
+ * endpoints in the table above can only be changed by editing
+ * usb_cdc_hid.c, usb_cdc_constants.h, and usb_hid_constants.h.
+ *
+ * Example code:
+ *
+\code
+usbHidJoystickInput.x = readX();
+usbHidJoystickInputUpdated = 1;
+
+if (usbComRxAvailable() && usbComTxAvailable())
+{
+    usbComTxSendByte(usbComRxReceiveByte());
+}
+
+usbCdcHidService();
+\endcode
+ *
+ * The device uses a different USB product ID than a plain Wixel, so the host
+ * needs a driver for the CDC ACM function of a composite device.
+ */
+
+#ifndef _USB_CDC_HID_H
+#define _USB_CDC_HID_H
+
+#include <usb_com.h>
+#include <usb_hid.h>
+
+/*! This must be called regularly.  It does everything that usbComService()
+ * does, and sends #usbHidJoystickInput to the host when
+ * #usbHidJoystickInputUpdated is 1. */
+void usbCdcHidService(void);
+
+#endif
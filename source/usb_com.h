@@ -6,6 +6,7 @@
 #ifndef _USB_COM_H
 #define _USB_COM_H
 
+#include <cc2511_map.h>
 #include <time.h>
 #include <com.h>
 /*! additional typedef added by Adrien de Croy
@@ -93,7 +94,8 @@ void usbComTxControlSignalEvents(uint8 signalEvents);
 extern ACM_LINE_CODING XDATA usbComLineCoding;
 
 /*! A pointer to a function that will be called whenever #usbComLineCoding gets set
- * by the USB host. */
+ * by the USB host.  It is called from usbComService(), never from an
+ * interrupt, so it can do anything the main loop can do. */
 extern HandlerFunction * usbComLineCodingChangeHandler;
 
 /*! This function should be called regularly (at least every 50&nbsp;ms) if you are
@@ -136,6 +138,50 @@ uint8 usbComRxReceiveByte(void);
  * See also usbComRxReceiveByte(). */
 void usbComRxReceive(uint8 XDATA * buffer, uint8 size);
 
+/*! Reading this register gets the next byte of the packet found by
+ * usbComRxPeek().  It is the FIFO register of the CDC data endpoint. */
+#define USB_COM_RX_FIFO USBF4
+
+/*! \return The number of bytes left in the packet that was most recently
+ *   received from the USB host, or 0 if there is no packet.
+ *
+ * This function, together with #USB_COM_RX_FIFO and usbComRxRelease(),
+ * lets you read received bytes straight from the USB module's FIFO, with
+ * no function call and no endpoint selection for each byte.  You can pass
+ * the bytes directly to wherever they need to go (for example a UART or a
+ * radio packet), so each byte is copied only once.
+ *
+ * Each read of #USB_COM_RX_FIFO returns the next byte of the packet.  You
+ * must not read more bytes than this function returned.  You do not have to
+ * read them all at once: if you stop early, the next call to this function
+ * returns the number of bytes that are left.  When you are done with the
+ * packet, call usbComRxRelease() so the USB module can receive another one.
+ *
+ * Example code that sends bytes from USB to UART 0:
+ *
+\code
+uint8 count = usbComRxPeek();
+if (count > uart0TxAvailable()){ count = uart0TxAvailable(); }
+while(count--)
+{
+    uart0TxSendByte(USB_COM_RX_FIFO);
+}
+if (usbComRxPeek() == 0)
+{
+    usbComRxRelease();
+}
+\endcode
+ *
+ * Do not mix this with usbComRxReceiveByte() and usbComRxReceive() while a
+ * packet is being read, because those functions release the packet
+ * themselves when they read its last byte. */
+uint8 usbComRxPeek(void);
+
+/*! Tells the USB module that we are done with the packet found by
+ * usbComRxPeek(), so it can receive another one.  Any bytes of the packet
+ * that were not read are discarded. */
+void usbComRxRelease(void);
+
 /*! \return The number of bytes available in the TX buffers.
  *
  * The <code>usb_cdc_acm.lib</code> library uses a double-buffered endpoint
@@ -164,10 +210,101 @@ void usbComTxSendByte(uint8 byte);
  * The \p size parameter should not exceed the last value returned by usbComTxAvailable(). */
 void usbComTxSend(const uint8 XDATA * buffer, uint8 size);
 
+/*! Send a partly filled packet every time usbComService() is called.  This
+ * is the default, and gives the lowest latency, but a program that sends a
+ * few bytes at a time can end up using one USB frame for every few bytes. */
+#define USB_COM_FLUSH_IMMEDIATE  0
+
+/*! Only send full (64-byte) packets.  A partly filled packet, or the empty
+ * packet that ends a transfer after a full packet, waits until you call
+ * usbComTxFlush().  Use this for bulk data where you know when a block of
+ * data ends. */
+#define USB_COM_FLUSH_FULL       1
+
+/*! Send a partly filled packet (or an empty packet) once it has waited for
+ * the timeout specified in usbComTxSetFlushPolicy(), so bytes that are sent
+ * close together share a packet. */
+#define USB_COM_FLUSH_TIMED      2
+
+/*! Sets when usbComService() sends a packet that is not full.  Full packets
+ * are always sent right away.
+ *
+ * \param mode #USB_COM_FLUSH_IMMEDIATE, #USB_COM_FLUSH_FULL, or
+ *   #USB_COM_FLUSH_TIMED.
+ * \param timeoutUs For #USB_COM_FLUSH_TIMED, the longest time that a byte
+ *   can wait in a partly filled packet, in microseconds.  The time is counted
+ *   from when the first byte of the packet was added (or, for the empty
+ *   packet that ends a transfer, from when the last full packet was sent).
+ *   The packet is sent by the first call to usbComService() after that time,
+ *   so call usbComService() at least that often.  Ignored in the other modes.
+ *
+ * Every USB transfer has to end with a packet that is not full, so the host
+ * knows to pass the data up to the program reading the port.  When the data
+ * ends exactly at the end of a packet, this library sends an empty packet
+ * afterwards, following the same rules as a partly filled packet. */
+void usbComTxSetFlushPolicy(uint8 mode, uint16 timeoutUs);
+
+/*! Makes the next call to usbComService() send the partly filled packet (or
+ * the empty packet that ends a transfer) regardless of the flush policy.
+ * Does nothing if there is nothing waiting to be sent. */
+void usbComTxFlush(void);
+
+/*! For usbComTxPacketCount(): packets with 64 bytes. */
+#define USB_COM_TX_PACKET_FULL   0
+
+/*! For usbComTxPacketCount(): packets with 1 to 63 bytes. */
+#define USB_COM_TX_PACKET_SHORT  1
+
+/*! For usbComTxPacketCount(): empty packets sent to end a transfer. */
+#define USB_COM_TX_PACKET_EMPTY  2
+
+/*! \return The number of data packets of the specified kind that have been
+ *   sent to the USB host (modulo 2^32).
+ * \param type #USB_COM_TX_PACKET_FULL, #USB_COM_TX_PACKET_SHORT, or
+ *   #USB_COM_TX_PACKET_EMPTY.
+ *
+ * Dividing usbComTxByteCount() by the total number of packets gives the
+ * average number of bytes per packet, which shows how well the flush policy
+ * is working. */
+uint32 usbComTxPacketCount(uint8 type);
+
+/*! \return The number of data bytes that have been sent to the USB host
+ *   (modulo 2^32). */
+uint32 usbComTxByteCount(void);
+
+/*! Sets the packet and byte counts to zero. */
+void usbComTxClearStatistics(void);
+
+/*! Initializes the CDC ACM endpoints (see usb_cdc_constants.h).  This is
+ * called from usbCallbackInitEndpoints() (see usb.h).  You only need it if
+ * you are writing your own USB descriptors and callbacks, for example for a
+ * composite device, instead of using the ones in usb_cdc_acm_device.c. */
+void usbComInitEndpoints(void);
+
+/*! Handles the CDC ACM class requests sent to the CDC ACM interfaces.  This
+ * is called from usbCallbackSetupHandler() (see usb.h).  See
+ * usbComInitEndpoints().
+ *
+ * This only records a control line state change; the function passed to
+ * usbComRequestLineStateChangeNotification() is called later, from
+ * usbComService(). */
+void usbComSetupHandler(void);
+
+/*! Handles the data of a CDC ACM control write request (SET_LINE_CODING).
+ * This is called from usbCallbackControlWriteHandler() (see usb.h).  See
+ * usbComInitEndpoints().
+ *
+ * This only records that the line coding changed;
+ * #usbComLineCodingChangeHandler is called later, from usbComService(). */
+void usbComControlWriteHandler(void);
+
 /*! Added by Adrien de Croy.  Used to request the system to go into bootloader mode soon.  This is so we can do this from
  * protocol  */
 void requestBootloaderSoon();
 
+/*! Registers a function that will be called with the new
+ * #usbComControlLineState whenever the USB host changes it.  The function is
+ * called from usbComService(), never from an interrupt. */
 void usbComRequestLineStateChangeNotification(LineStateChangeNotificationFunc pFunc);
 
 #endif
@@ -163,6 +163,42 @@ extern BIT usbHidJoystickInputUpdated;
 /*! This must be called regularly if you are implementing an HID device. */
 void usbHidService(void);
 
+/* Joystick functions for composite devices ***********************************/
+// These are in usb_hid_joystick.c.  You only need them if you are writing
+// your own USB descriptors and callbacks for a device with a joystick
+// interface, like usb_cdc_hid.c does.  The joystick must use interface
+// #HID_JOYSTICK_INTERFACE_NUMBER and endpoint #HID_JOYSTICK_ENDPOINT (see
+// usb_hid_constants.h).
+
+/*! The joystick's HID report descriptor.  It is
+ * #HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE bytes long. */
+extern uint8 CODE usbHidJoystickReportDescriptor[];
+
+/*! The USB string descriptor for the name of the joystick interface. */
+extern uint16 CODE usbHidJoystickStringDescriptor[];
+
+/*! Initializes the joystick's IN endpoint.  This should be called from
+ * usbCallbackInitEndpoints() (see usb.h). */
+void usbHidJoystickInitEndpoints(void);
+
+/*! Handles the HID class requests sent to the joystick interface.  This
+ * should be called from usbCallbackSetupHandler() (see usb.h) when wIndex
+ * is #HID_JOYSTICK_INTERFACE_NUMBER. */
+void usbHidJoystickSetupHandler(void);
+
+/*! Handles the requests for the joystick's HID descriptor and report
+ * descriptor.  This should be called from usbCallbackClassDescriptorHandler()
+ * (see usb.h) when wIndex is #HID_JOYSTICK_INTERFACE_NUMBER.
+ *
+ * \param hidDescriptor The joystick's 9-byte HID descriptor, which is part
+ *   of your configuration descriptor. */
+void usbHidJoystickClassDescriptorHandler(uint8 XDATA * hidDescriptor);
+
+/*! Sends #usbHidJoystickInput to the host if #usbHidJoystickInputUpdated is
+ * 1 and the endpoint is ready.  This should be called regularly, but only
+ * when #usbDeviceState is USB_STATE_CONFIGURED. */
+void usbHidJoystickService(void);
+
 /*! Converts an ASCII-encoded character into the corresponding HID Key Code,
  * suitable for the keyCodes array in HID_KEYBOARD_IN_REPORT.
  * Note that many pairs of ASCII characters map to the same key code because
@@ -149,4 +149,101 @@
 #define MOUSE_BUTTON_RIGHT  1
 #define MOUSE_BUTTON_MIDDLE 2
 
+/* HID Joystick Configuration *************************************************/
+// The joystick function (usb_hid_joystick.c) is used by both usb_hid.c and
+// usb_cdc_hid.c, and uses the same interface and endpoint in both.
+// We picked endpoint 3 because its 128-byte FIFO can hold two joystick
+// reports, and it is not used by CDC ACM (see usb_cdc_constants.h).
+
+#define HID_IN_JOYSTICK_PACKET_SIZE          20
+#define HID_JOYSTICK_INTERFACE_NUMBER        2
+#define HID_JOYSTICK_ENDPOINT                3
+
+// The size of usbHidJoystickReportDescriptor, which the HID descriptors in the
+// configuration descriptors need at compile time.
+#define HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE  56
+
+/* HID Class Constants ********************************************************/
+// These are used in the USB descriptors of usb_hid.c and usb_cdc_hid.c.
+
+// USB Class Code from HID 1.11 Section 4.1: The HID Class
+#define HID_CLASS    3
+
+// USB Subclass Code from HID 1.11 Section 4.2: Subclass
+#define HID_SUBCLASS_BOOT 1
+
+// USB Protocol Codes from HID 1.11 Section 4.3: Protocols
+#define HID_PROTOCOL_KEYBOARD 1
+#define HID_PROTOCOL_MOUSE    2
+
+// USB Descriptor types from HID 1.11 Section 7.1
+#define HID_DESCRIPTOR_TYPE_HID    0x21
+#define HID_DESCRIPTOR_TYPE_REPORT 0x22
+
+// Country Codes from HID 1.11 Section 6.2.1
+#define HID_COUNTRY_NOT_LOCALIZED 0
+
+// HID Report Items from HID 1.11 Section 6.2.2
+#define HID_USAGE_PAGE      0x05
+#define HID_USAGE           0x09
+#define HID_COLLECTION      0xA1
+#define HID_END_COLLECTION  0xC0
+#define HID_REPORT_COUNT    0x95
+#define HID_REPORT_SIZE     0x75
+#define HID_USAGE_MIN       0x19
+#define HID_USAGE_MAX       0x29
+#define HID_LOGICAL_MIN     0x15
+#define HID_LOGICAL_MIN_2   0x16 // 2-byte data
+#define HID_LOGICAL_MAX     0x25
+#define HID_LOGICAL_MAX_2   0x26 // 2-byte data
+#define HID_INPUT           0x81
+#define HID_OUTPUT          0x91
+
+// HID Report Usage Pages from HID Usage Tables 1.12 Section 3, Table 1
+#define HID_USAGE_PAGE_GENERIC_DESKTOP 0x01
+#define HID_USAGE_PAGE_KEY_CODES       0x07
+#define HID_USAGE_PAGE_LEDS            0x08
+#define HID_USAGE_PAGE_BUTTONS         0x09
+
+// HID Report Usages from HID Usage Tables 1.12 Section 4, Table 6
+#define HID_USAGE_POINTER  0x01
+#define HID_USAGE_MOUSE    0x02
+#define HID_USAGE_JOYSTICK 0x04
+#define HID_USAGE_KEYBOARD 0x06
+#define HID_USAGE_X        0x30
+#define HID_USAGE_Y        0x31
+#define HID_USAGE_Z        0x32
+#define HID_USAGE_RX       0x33
+#define HID_USAGE_RY       0x34
+#define HID_USAGE_RZ       0x35
+#define HID_USAGE_SLIDER   0x36
+#define HID_USAGE_DIAL     0x37
+#define HID_USAGE_WHEEL    0x38
+
+// HID Report Collection Types from HID 1.12 6.2.2.6
+#define HID_COLLECTION_PHYSICAL    0
+#define HID_COLLECTION_APPLICATION 1
+
+// HID Input/Output/Feature Item Data (attributes) from HID 1.11 6.2.2.5
+#define HID_ITEM_CONSTANT 0x1
+#define HID_ITEM_VARIABLE 0x2
+#define HID_ITEM_RELATIVE 0x4
+
+// Request Codes from HID 1.11 Section 7.2
+#define HID_REQUEST_GET_REPORT   0x1
+#define HID_REQUEST_GET_IDLE     0x2
+#define HID_REQUEST_GET_PROTOCOL 0x3
+#define HID_REQUEST_SET_REPORT   0x9
+#define HID_REQUEST_SET_IDLE     0xA
+#define HID_REQUEST_SET_PROTOCOL 0xB
+
+// Report Types from HID 1.11 Section 7.2.1
+#define HID_REPORT_TYPE_INPUT   1
+#define HID_REPORT_TYPE_OUTPUT  2
+#define HID_REPORT_TYPE_FEATURE 3
+
+// Protocols from HID 1.11 Section 7.2.5
+#define HID_PROTOCOL_BOOT   0
+#define HID_PROTOCOL_REPORT 1
+
 #endif /* USB_HID_CONSTANTS_H_ */
@@ -1,20 +1,77 @@
 #include <cc2511_types.h>
 #include "adc.h"
 
-static uint16 millivoltCalibration = 3300;
+// The calibration (VDD in millivolts) is stored as its quotient and remainder
+// when divided by 2047, so that converting a result needs no division:
+//   (x * calibration + bias) / 2047 = x * whole + (x * fraction + bias) / 2047
+// and since x * fraction + bias is less than 2^22 - 1, the last division can
+// be done exactly with a shift-and-add reciprocal (see divideBy2047).
+// The defaults correspond to a calibration of 3300 mV.
+static uint8 millivoltScaleWhole = 1;
+static uint16 millivoltScaleFraction = 3300 - 2047;
+
+// Returns n / 2047, rounded down.  Only exact for n < 2^22 - 1.
+#define divideBy2047(n) ((uint16)(((n) + ((n) >> 11) + 1) >> 11))
+
+// Returns (magnitude * calibration + bias) / 2047, rounded down, where
+// calibration = whole * 2047 + fraction.  magnitude must be at most 2048 and
+// fraction at most 2046.
+static uint16 scaleMillivolts(uint16 magnitude, uint8 whole, uint16 fraction, uint16 bias)
+{
+    uint32 n = (uint32)magnitude * fraction + bias;
+    return magnitude * whole + divideBy2047(n);
+}
 
 uint16 adcReadVddMillivolts()
 {
-    //return adcRead(15|ADC_REFERENCE_INTERNAL);
-    return ((uint32)adcRead(15|ADC_REFERENCE_INTERNAL)*3750 + 1023) / 2047;
+    // 3750 = 1 * 2047 + 1703
+    return scaleMillivolts(adcRead(15|ADC_REFERENCE_INTERNAL), 1, 1703, 1023);
 }
 
 void adcSetMillivoltCalibration(uint16 vddMillivolts)
 {
-    millivoltCalibration = vddMillivolts;
+    millivoltScaleWhole = vddMillivolts / 2047;
+    millivoltScaleFraction = vddMillivolts % 2047;
+}
+
+// Returns ((int32)adcResult * calibration + 1023) / 2047, using the same
+// rounding as the division in C (towards zero) and the same truncation to
+// 16 bits.
+static int16 convertToMillivolts(int16 adcResult, uint8 whole, uint16 fraction)
+{
+    uint16 q;
+
+    if (adcResult >= 0)
+    {
+        return scaleMillivolts(adcResult, whole, fraction, 1023);
+    }
+
+    // For a negative result, with m = -adcResult, C gives
+    //   -((m * calibration - 1023) / 2047) = 1 - (m * calibration + 1024) / 2047
+    // with the divisions rounded down, or 0 if m * calibration < 1023.
+    // q can only be 0 here if whole is 0, because m is at least 1.
+    q = scaleMillivolts(-adcResult, whole, fraction, 1024);
+    if (q == 0 && whole == 0)
+    {
+        return 0;
+    }
+    return 1 - q;
 }
 
 int16 adcConvertToMillivolts(int16 adcResult)
 {
-    return ((int32)adcResult * millivoltCalibration + 1023) / 2047;
+    return convertToMillivolts(adcResult, millivoltScaleWhole, millivoltScaleFraction);
+}
+
+void adcConvertBufferToMillivolts(int16 XDATA * buffer, uint16 count)
+{
+    // Load the calibration once for the whole buffer.
+    uint8 whole = millivoltScaleWhole;
+    uint16 fraction = millivoltScaleFraction;
+
+    while (count--)
+    {
+        *buffer = convertToMillivolts(*buffer, whole, fraction);
+        buffer++;
+    }
 }
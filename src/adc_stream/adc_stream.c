@@ -0,0 +1,463 @@
+/* adc_stream.c:
+ *  Uses ADC sequence conversions and DMA channel 2 to stream samples into a
+ *  circular buffer of blocks.
+ *  See adc_stream.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <dma.h>
+#include <time.h>
+#include <adc_stream.h>
+
+/** Note: This library assumes that the Wixel is running at 24 MHz and that
+ *  CLKCON.TICKSPD is 000 (see boardClockInit()). **/
+
+// Used instead of a block number when the DMA is writing to the discard
+// buffer because all the real blocks are waiting to be read.
+#define DISCARD_BLOCK 0xFF
+
+// ADCCON1 values: STSEL[1:0] selects the event that starts a sequence.
+// Bits 1:0 must be 11.
+#define ADCCON1_FULL_SPEED  0b00010011
+#define ADCCON1_TIMER1      0b00100011
+#define ADCCON1_STOPPED     0b00110011   // Only started by ADCCON1.ST, which we never set.
+
+// The largest moving average window, in frames.
+#define MAX_AVERAGE_LENGTH 16
+
+// DMA trigger number for "ADC end of a conversion in a sequence".
+#define DMA_TRIGGER_ADC_CHALL  20
+
+static BIT adcStreamStartedFlag = 0;
+static BIT timer1Used = 0;
+
+static uint16 XDATA adcStreamBuffer[ADC_STREAM_BLOCK_COUNT][ADC_STREAM_MAX_BLOCK_SAMPLES];
+static uint16 XDATA discardBuffer[ADC_STREAM_MAX_BLOCK_SAMPLES];
+
+static uint8 DATA blockSamples = 0;
+static uint8 DATA blockFrames = 0;
+static uint8 DATA channelCount = 0;
+static uint8 DATA analogPins = 0;
+
+// The number of completed blocks waiting to be read.  Incremented by the ISR
+// and decremented by the main loop (both are single instructions).
+static volatile uint8 DATA blocksReady = 0;
+
+// The next block the main loop will read.  Only used by the main loop.
+static uint8 DATA readBlock = 0;
+
+// The block the DMA is writing to now, the block it will write to next, and
+// the next block in the ring that has not been handed to the DMA yet.
+// Only used by the ISR (and by adcStreamStart while the DMA is stopped).
+static uint8 DATA fillBlock;
+static uint8 DATA nextBlock;
+static uint8 DATA writeBlock;
+
+volatile uint8 DATA adcStreamOverrunCount = 0;
+volatile uint8 DATA adcStreamFilterOverrunCount = 0;
+
+// Filter settings from adcStreamSetFilter().  filterShift is the number of
+// extra bits of resolution (1-3) and the filter ratio is 4 to that power.
+static uint8 DATA filterType = ADC_STREAM_FILTER_NONE;
+static uint8 DATA filterShift = ADC_STREAM_RATIO_4;
+
+// Filter state.  Only used by the ISR (and by adcStreamStart while the DMA is
+// stopped).  The CIC filter uses both integrators and both combs; the
+// decimation filter only uses integrator1 as an accumulator.
+static uint8 DATA filterFrameCount;
+static uint8 DATA historyIndex;
+static int32 XDATA integrator1[6];
+static int32 XDATA integrator2[6];
+static int32 XDATA comb1[6];
+static int32 XDATA comb2[6];
+static int16 XDATA movingSum[6];
+static int16 XDATA history[6][MAX_AVERAGE_LENGTH];
+static int16 XDATA frameOut[6];
+
+static volatile int16 XDATA filteredSamples[ADC_STREAM_FILTERED_BUFFER_SIZE];  // must be a power of two
+static volatile uint8 DATA filteredMainLoopIndex = 0;  // Index of next sample main loop will read.
+static volatile uint8 DATA filteredInterruptIndex = 0; // Index of next sample interrupt will write.
+
+static void setDestination(uint8 block)
+{
+    uint16 XDATA * address = (block == DISCARD_BLOCK) ? discardBuffer : adcStreamBuffer[block];
+    dmaConfig.adc.DESTADDRH = (uint16)address >> 8;
+    dmaConfig.adc.DESTADDRL = (uint16)address;
+}
+
+// Puts the samples in frameOut into the filtered sample buffer.
+// Only called from the ISR.
+static void emitFrame(void)
+{
+    uint8 index = filteredInterruptIndex;
+    uint8 c;
+
+    if (((filteredMainLoopIndex - index - 1) & (ADC_STREAM_FILTERED_BUFFER_SIZE - 1)) < channelCount)
+    {
+        // There is not enough room for the whole frame, so it is lost.
+        adcStreamFilterOverrunCount++;
+        return;
+    }
+
+    for (c = 0; c < channelCount; c++)
+    {
+        filteredSamples[index] = frameOut[c];
+        index = (index + 1) & (ADC_STREAM_FILTERED_BUFFER_SIZE - 1);
+    }
+    filteredInterruptIndex = index;
+}
+
+// Runs the selected filter over a completed block.  Only called from the ISR,
+// so it avoids 16-bit and 32-bit multiplication and division.
+static void filterBlock(uint16 XDATA * samples)
+{
+    uint8 frames = blockFrames;
+    uint8 ratio = 1 << (filterShift << 1);
+    uint8 c;
+
+    while (frames--)
+    {
+        for (c = 0; c < channelCount; c++)
+        {
+            // Keep the sign so that noise around 0 V averages correctly.
+            int16 x = (int16)*samples++ >> 4;
+
+            switch (filterType)
+            {
+            case ADC_STREAM_FILTER_DECIMATE:
+                integrator1[c] += x;
+                break;
+
+            case ADC_STREAM_FILTER_MOVING_AVERAGE:
+                movingSum[c] += x - history[c][historyIndex];
+                history[c][historyIndex] = x;
+                frameOut[c] = movingSum[c] >> filterShift;
+                break;
+
+            default:  // ADC_STREAM_FILTER_CIC
+                integrator1[c] += x;
+                integrator2[c] += integrator1[c];
+                break;
+            }
+        }
+
+        if (filterType == ADC_STREAM_FILTER_MOVING_AVERAGE)
+        {
+            historyIndex = (historyIndex + 1) & (ratio - 1);
+            emitFrame();
+            continue;
+        }
+
+        if (++filterFrameCount != ratio)
+        {
+            continue;
+        }
+        filterFrameCount = 0;
+
+        for (c = 0; c < channelCount; c++)
+        {
+            if (filterType == ADC_STREAM_FILTER_DECIMATE)
+            {
+                frameOut[c] = integrator1[c] >> filterShift;
+                integrator1[c] = 0;
+            }
+            else
+            {
+                // The gain of a second-order CIC filter is the square of its
+                // ratio, so shift by 4*filterShift, less the extra bits.
+                int32 y = integrator2[c] - comb1[c];
+                comb1[c] = integrator2[c];
+                frameOut[c] = (y - comb2[c]) >> (filterShift * 3);
+                comb2[c] = y;
+            }
+        }
+        emitFrame();
+    }
+}
+
+ISR(DMA, 0)
+{
+    uint8 completedBlock;
+
+    if (!(DMAIRQ & (1<<DMA_CHANNEL_ADC)))
+    {
+        return;
+    }
+
+    // Clear our flag.  Writing a 1 to a bit in DMAIRQ has no effect, so
+    // this does not clear the flags of the other channels.
+    DMAIRQ = ~(1<<DMA_CHANNEL_ADC);
+    DMAIF = 0;
+
+    // The DMA has finished fillBlock.  In repeated mode it re-armed itself
+    // and reloaded its configuration, so it is now writing to nextBlock.
+    // Filtered blocks are not given to the main loop.
+    completedBlock = fillBlock;
+    if (completedBlock == DISCARD_BLOCK)
+    {
+        adcStreamOverrunCount++;
+    }
+    else if (filterType == ADC_STREAM_FILTER_NONE)
+    {
+        blocksReady++;
+    }
+    fillBlock = nextBlock;
+
+    // Choose the block after that.  The blocks in use are the ones waiting
+    // to be read plus the one being filled; if that leaves no room, the DMA
+    // will write the next block's worth of samples to the discard buffer.
+    if (blocksReady + (fillBlock != DISCARD_BLOCK) < ADC_STREAM_BLOCK_COUNT)
+    {
+        nextBlock = writeBlock;
+        writeBlock = (writeBlock + 1) & (ADC_STREAM_BLOCK_COUNT - 1);
+    }
+    else
+    {
+        nextBlock = DISCARD_BLOCK;
+    }
+    setDestination(nextBlock);
+
+    // The completed block will not be handed to the DMA again until the next
+    // interrupt, so we have a whole block's worth of time to filter it.
+    if (filterType != ADC_STREAM_FILTER_NONE && completedBlock != DISCARD_BLOCK)
+    {
+        filterBlock(adcStreamBuffer[completedBlock]);
+    }
+}
+
+// Configures Timer 1 so that its channel 0 compare event happens
+// framesPerSecond times per second.
+static void configureTimer1(uint16 framesPerSecond)
+{
+    uint32 ticks = 24000000 / framesPerSecond;
+    uint8 div = 0;   // T1CTL.DIV: 0 = /1, 1 = /8, 2 = /32, 3 = /128
+
+    while (ticks > 0x10000 && div < 3)
+    {
+        ticks >>= (div == 0) ? 3 : 2;
+        div++;
+    }
+    if (ticks > 0x10000)
+    {
+        ticks = 0x10000;
+    }
+
+    T1CTL = 0;
+    T1CNTL = 0;                  // resets high and low bytes
+    T1CC0 = (uint16)(ticks - 1);
+    T1CCTL0 = 0b00000100;        // MODE = 1 (compare), no interrupt, no output pin
+    T1CTL = (div << 2) | 0b10;   // Modulo mode: count from 0 to T1CC0.
+}
+
+void adcStreamSetFilter(uint8 filter, uint8 ratio)
+{
+    if (ratio < ADC_STREAM_RATIO_4){ ratio = ADC_STREAM_RATIO_4; }
+    if (ratio > ADC_STREAM_RATIO_64){ ratio = ADC_STREAM_RATIO_64; }
+    if (filter == ADC_STREAM_FILTER_MOVING_AVERAGE && ratio > ADC_STREAM_RATIO_16)
+    {
+        ratio = ADC_STREAM_RATIO_16;
+    }
+
+    adcStreamStop();
+    filterType = filter;
+    filterShift = ratio;
+}
+
+// Clears the filter state and the filtered sample buffer.
+static void resetFilter(void)
+{
+    uint8 c, i;
+
+    for (c = 0; c < 6; c++)
+    {
+        integrator1[c] = integrator2[c] = comb1[c] = comb2[c] = 0;
+        movingSum[c] = 0;
+        for (i = 0; i < MAX_AVERAGE_LENGTH; i++)
+        {
+            history[c][i] = 0;
+        }
+    }
+    filterFrameCount = 0;
+    historyIndex = 0;
+    filteredMainLoopIndex = filteredInterruptIndex = 0;
+}
+
+void adcStreamStart(uint8 channelMask, uint8 options, uint16 framesPerSecond, uint8 framesPerBlock)
+{
+    uint8 lastChannel = 0;
+    uint8 i;
+
+    adcStreamStop();
+
+    channelCount = 0;
+    channelMask &= 0b00111111;
+    for (i = 0; i < 6; i++)
+    {
+        if (channelMask & (1<<i))
+        {
+            channelCount++;
+            lastChannel = i;
+        }
+    }
+    if (channelCount == 0)
+    {
+        return;
+    }
+
+    if (framesPerBlock == 0)
+    {
+        framesPerBlock = 1;
+    }
+    if (framesPerBlock > ADC_STREAM_MAX_BLOCK_SAMPLES / channelCount)
+    {
+        framesPerBlock = ADC_STREAM_MAX_BLOCK_SAMPLES / channelCount;
+    }
+    blockFrames = framesPerBlock;
+    blockSamples = framesPerBlock * channelCount;
+    resetFilter();
+
+    blocksReady = 0;
+    readBlock = 0;
+    fillBlock = 0;
+    nextBlock = 1;
+    writeBlock = 2;
+
+    // DMA channel 2: copy 16-bit results from the ADC to the buffer, one
+    // each time a conversion in the sequence finishes.
+    dmaConfig.adc.SRCADDRH = XDATA_SFR_ADDRESS(ADCL) >> 8;
+    dmaConfig.adc.SRCADDRL = XDATA_SFR_ADDRESS(ADCL);
+    setDestination(fillBlock);
+    dmaConfig.adc.VLEN_LENH = 0;
+    dmaConfig.adc.LENL = blockSamples;
+    dmaConfig.adc.DC6 = 0b11000000 | DMA_TRIGGER_ADC_CHALL; // WORDSIZE = 1, TMODE = 10 (repeated single)
+    dmaConfig.adc.DC7 = 0b00011010; // SRCINC = 0, DESTINC = 1, IRQMASK = 1, M8 = 0, PRIORITY = 2 (high)
+
+    DMAIRQ = ~(1<<DMA_CHANNEL_ADC);
+    DMAARM = (1<<DMA_CHANNEL_ADC);
+
+    // The configuration was loaded when we armed the channel; it will be
+    // loaded again when the channel re-arms itself at the end of the block,
+    // so this is where the second block goes.  Loading takes 9 clock
+    // cycles, so wait for it to finish before changing the address.
+    delayMicroseconds(1);
+    setDestination(nextBlock);
+
+    DMAIE = 1;
+    EA = 1;
+
+    // Give the pins to the ADC.  Channels whose ADCCFG bit is cleared are
+    // skipped by the sequence.
+    analogPins = channelMask;
+    ADCCFG |= analogPins;
+
+    // ADCCON2 has the same layout as ADCCON3: reference, decimation rate,
+    // and the last channel in the sequence.
+    ADCCON1 = ADCCON1_STOPPED;
+    ADCCON2 = 0b10110000 ^ (options & 0b11110000) ^ lastChannel;
+
+    adcStreamStartedFlag = 1;
+
+    if (framesPerSecond)
+    {
+        configureTimer1(framesPerSecond);
+        timer1Used = 1;
+        ADCCON1 = ADCCON1_TIMER1;
+    }
+    else
+    {
+        ADCCON1 = ADCCON1_FULL_SPEED;
+    }
+}
+
+void adcStreamStop(void)
+{
+    if (!adcStreamStartedFlag)
+    {
+        return;
+    }
+
+    ADCCON1 = ADCCON1_STOPPED;
+    if (timer1Used)
+    {
+        T1CTL = 0;
+        T1CCTL0 = 0;
+        timer1Used = 0;
+    }
+
+    DMAARM = 0x80 | (1<<DMA_CHANNEL_ADC);  // Abort the transfer.
+    DMAIRQ = ~(1<<DMA_CHANNEL_ADC);
+    DMAIF = 0;
+
+    ADCCFG &= ~analogPins;
+    analogPins = 0;
+
+    adcStreamStartedFlag = 0;
+}
+
+BIT adcStreamStarted(void)
+{
+    return adcStreamStartedFlag;
+}
+
+uint8 adcStreamBlockSamples(void)
+{
+    return blockSamples;
+}
+
+uint8 adcStreamBlocksAvailable(void)
+{
+    return blocksReady;
+}
+
+uint16 XDATA * adcStreamGetBlock(void)
+{
+    if (blocksReady == 0)
+    {
+        return 0;
+    }
+    return adcStreamBuffer[readBlock];
+}
+
+void adcStreamReleaseBlock(void)
+{
+    if (blocksReady == 0)
+    {
+        return;
+    }
+    readBlock = (readBlock + 1) & (ADC_STREAM_BLOCK_COUNT - 1);
+    blocksReady--;
+}
+
+uint8 adcStreamFilteredAvailable(void)
+{
+    return (filteredInterruptIndex - filteredMainLoopIndex) & (ADC_STREAM_FILTERED_BUFFER_SIZE - 1);
+}
+
+uint8 adcStreamReadFiltered(int16 XDATA * samples, uint8 maxCount)
+{
+    uint8 count;
+    uint8 i;
+
+    if (channelCount == 0)
+    {
+        return 0;
+    }
+
+    // The ISR adds whole frames, so the number available is always a
+    // multiple of channelCount.
+    count = adcStreamFilteredAvailable();
+    maxCount -= maxCount % channelCount;
+    if (count > maxCount)
+    {
+        count = maxCount;
+    }
+
+    for (i = 0; i < count; i++)
+    {
+        samples[i] = filteredSamples[filteredMainLoopIndex];
+        filteredMainLoopIndex = (filteredMainLoopIndex + 1) & (ADC_STREAM_FILTERED_BUFFER_SIZE - 1);
+    }
+
+    return count;
+}
@@ -0,0 +1,346 @@
+/* gpio_interrupt.c:
+ *  Records edges on the Port 0 and Port 1 pins in the Port 0 and Port 1 ISRs
+ *  and queues them in a circular buffer for the main loop.
+ *  See gpio_interrupt.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <gpio.h>
+#include <gpio_interrupt.h>
+#include <usb.h>
+
+/** Internal Channel Number   Pins
+ *  0-5                       P0_0 - P0_5
+ *  6-13                      P1_0 - P1_7
+ */
+#define CHANNEL_COUNT 14
+#define PORT1_FIRST_CHANNEL 6
+
+// Returned by pinToChannel() for pins that this library does not support.
+#define NO_CHANNEL 0xFF
+
+// PICTL bits
+#define PICTL_P0ICON  (1<<0)
+#define PICTL_P1ICON  (1<<1)
+#define PICTL_P0IENL  (1<<3)
+#define PICTL_P0IENH  (1<<4)
+
+// IEN2.P1IE: Port 1 interrupt enable.
+#define IEN2_P1IE     (1<<4)
+
+// The millisecond counter maintained by the T4 ISR in time.c.
+// We read it directly in our ISRs because getMs() is not reentrant.
+// Assumption: The T4, P0INT, and P1INT interrupts have the same priority
+// (the default), so they can not interrupt each other while we read it.
+extern PDATA volatile uint32 timeMs;
+
+static volatile GPIO_EVENT XDATA gpioEvents[GPIO_INTERRUPT_EVENT_BUFFER_SIZE];  // must be a power of two
+static volatile uint8 DATA gpioEventsMainLoopIndex = 0;  // Index of next event main loop will read.
+static volatile uint8 DATA gpioEventsInterruptIndex = 0; // Index of next event interrupt will write.
+
+volatile uint8 DATA gpioInterruptOverflowCount = 0;
+
+// Per-channel settings.  An edge of 0 means the channel is disabled.
+static uint8 XDATA channelEdge[CHANNEL_COUNT];
+static uint8 XDATA channelDebounceMs[CHANNEL_COUNT];
+static GpioEventHandler XDATA channelHandler[CHANNEL_COUNT];
+
+// The lower 16 bits of the time of the last event recorded on each channel.
+static uint16 XDATA channelLastEventTime[CHANNEL_COUNT];
+
+// Non-zero if the channel is in its debounce period.
+static volatile uint8 XDATA channelDebouncing[CHANNEL_COUNT];
+
+// Bitmasks of the pins that this library is watching on each port.
+static volatile uint8 DATA port0PinMask = 0;
+static volatile uint8 DATA port1PinMask = 0;
+
+// If these bits are set, the ISR must flip PICTL.PnICON after every event
+// because the port needs to detect both kinds of edges.
+static volatile BIT port0FollowLevel = 0;
+static volatile BIT port1FollowLevel = 0;
+
+// Pins 6-9 do not exist (Port 0 only has P0_0 - P0_5), and Port 2 pins are
+// not supported, so those give NO_CHANNEL.
+static uint8 pinToChannel(uint8 pinNumber)
+{
+    if (pinNumber < 6)
+    {
+        return pinNumber;
+    }
+    if (pinNumber >= 10 && pinNumber < 18)
+    {
+        return pinNumber - 10 + PORT1_FIRST_CHANNEL;
+    }
+    return NO_CHANNEL;
+}
+
+// Records events for all the pins whose bits are set in "flags".
+// This is only called from the ISRs.  It is not reentrant, but that is OK
+// because the P0INT and P1INT interrupts have the same priority.
+// Returns the level of the last pin that was processed.
+static uint8 recordEdges(uint8 channel, uint8 pinNumber, uint8 flags, uint8 levels, uint32 now)
+{
+    uint8 level = 0;
+
+    for(; flags; flags >>= 1, levels >>= 1, channel++, pinNumber++)
+    {
+        uint8 nextIndex;
+        volatile GPIO_EVENT XDATA * event;
+
+        if (!(flags & 1))
+        {
+            continue;
+        }
+
+        level = levels & 1;
+
+        // Discard edges that the user did not ask for.  These can happen
+        // when the port is detecting both kinds of edges.
+        if (!(channelEdge[channel] & (level ? GPIO_EDGE_RISING : GPIO_EDGE_FALLING)))
+        {
+            continue;
+        }
+
+        // Discard edges that happen during the debounce period.
+        if (channelDebouncing[channel])
+        {
+            if ((uint16)((uint16)now - channelLastEventTime[channel]) < channelDebounceMs[channel])
+            {
+                continue;
+            }
+            channelDebouncing[channel] = 0;
+        }
+
+        nextIndex = (gpioEventsInterruptIndex + 1) & (GPIO_INTERRUPT_EVENT_BUFFER_SIZE - 1);
+        if (nextIndex == gpioEventsMainLoopIndex)
+        {
+            // The buffer is full, so this event is lost.
+            gpioInterruptOverflowCount++;
+            continue;
+        }
+
+        event = gpioEvents + gpioEventsInterruptIndex;
+        event->timeMs = now;
+        event->pinNumber = pinNumber;
+        event->level = level;
+        gpioEventsInterruptIndex = nextIndex;
+
+        if (channelDebounceMs[channel])
+        {
+            channelLastEventTime[channel] = (uint16)now;
+            channelDebouncing[channel] = 1;
+        }
+    }
+
+    return level;
+}
+
+ISR(P0INT, 0)
+{
+    uint8 levels = P0;
+    uint8 flags = P0IFG & port0PinMask;
+
+    // Clear the flags we are handling.  Writing a 1 to a bit in P0IFG has no
+    // effect, so this only clears those flags.
+    P0IFG = ~flags;
+
+    // Handle USB resume the way usb.h recommends, so that usbSleep() wakes up
+    // even if this ISR runs before it can look at the USB_RESUME flag.
+    if (P0IFG & 0x80)
+    {
+        usbSuspendMode = 0;
+        P0IFG = ~0x80;
+    }
+    P0IF = 0;
+
+    if (flags)
+    {
+        if (recordEdges(0, 0, flags, levels, timeMs))
+        {
+            if (port0FollowLevel){ PICTL |= PICTL_P0ICON; }   // Pin is high: look for a falling edge.
+        }
+        else
+        {
+            if (port0FollowLevel){ PICTL &= ~PICTL_P0ICON; }  // Pin is low: look for a rising edge.
+        }
+    }
+}
+
+ISR(P1INT, 0)
+{
+    uint8 levels = P1;
+    uint8 flags = P1IFG & port1PinMask;
+
+    P1IFG = ~flags;
+    P1IF = 0;
+
+    if (flags)
+    {
+        if (recordEdges(PORT1_FIRST_CHANNEL, 10, flags, levels, timeMs))
+        {
+            if (port1FollowLevel){ PICTL |= PICTL_P1ICON; }
+        }
+        else
+        {
+            if (port1FollowLevel){ PICTL &= ~PICTL_P1ICON; }
+        }
+    }
+}
+
+// Decides how the edge detection hardware of a port should be configured,
+// based on the edges requested for each channel on that port.
+// Returns GPIO_EDGE_RISING, GPIO_EDGE_FALLING, GPIO_EDGE_BOTH, or 0 if no
+// pins on the port are enabled.
+static uint8 portEdge(uint8 firstChannel, uint8 channelCount)
+{
+    uint8 edge = 0;
+    while(channelCount--)
+    {
+        edge |= channelEdge[firstChannel++];
+    }
+    return edge;
+}
+
+// Updates PICTL and P1IEN to match the settings of the channels.
+// pinNumber is the pin that was just changed; if its port needs to detect
+// both edges, we start by looking for the edge opposite to its current level.
+// The port interrupts must be disabled when this is called.
+static void configurePorts(uint8 pinNumber)
+{
+    BIT pinHigh = isPinHigh(pinNumber);
+    uint8 edge;
+
+    // Port 0
+    edge = portEdge(0, 6);
+    port0FollowLevel = (edge == GPIO_EDGE_BOTH);
+    if (edge == GPIO_EDGE_FALLING || (port0FollowLevel && pinNumber < 10 && pinHigh))
+    {
+        PICTL |= PICTL_P0ICON;
+    }
+    else
+    {
+        PICTL &= ~PICTL_P0ICON;
+    }
+
+    PICTL &= ~(PICTL_P0IENL | PICTL_P0IENH);
+    if (port0PinMask & 0x0F){ PICTL |= PICTL_P0IENL; }
+    if (port0PinMask & 0x30){ PICTL |= PICTL_P0IENH; }
+
+    // Port 1
+    edge = portEdge(PORT1_FIRST_CHANNEL, 8);
+    port1FollowLevel = (edge == GPIO_EDGE_BOTH);
+    if (edge == GPIO_EDGE_FALLING || (port1FollowLevel && pinNumber >= 10 && pinHigh))
+    {
+        PICTL |= PICTL_P1ICON;
+    }
+    else
+    {
+        PICTL &= ~PICTL_P1ICON;
+    }
+
+    P1IEN = port1PinMask;
+}
+
+void gpioInterruptEnable(uint8 pinNumber, uint8 edge, uint8 debounceMs, GpioEventHandler handler)
+{
+    uint8 channel = pinToChannel(pinNumber);
+
+    if (channel == NO_CHANNEL)
+    {
+        return;
+    }
+
+    P0IE = 0;  // Make sure we don't get interrupted in the middle of an update.
+    IEN2 &= ~IEN2_P1IE;
+
+    channelEdge[channel] = edge & GPIO_EDGE_BOTH;
+    channelDebounceMs[channel] = debounceMs;
+    channelHandler[channel] = handler;
+    channelDebouncing[channel] = 0;
+
+    if (pinNumber < 10)
+    {
+        port0PinMask |= (1<<pinNumber);
+        P0IFG = ~(1<<pinNumber);            // Clear any stale flag for this pin.
+    }
+    else
+    {
+        port1PinMask |= (1<<(pinNumber - 10));
+        P1IFG = ~(1<<(pinNumber - 10));
+    }
+
+    configurePorts(pinNumber);
+
+    if (port0PinMask){ P0IE = 1; }
+    if (port1PinMask){ IEN2 |= IEN2_P1IE; }
+    EA = 1;  // Enable interrupts in general.
+}
+
+void gpioInterruptDisable(uint8 pinNumber)
+{
+    uint8 channel = pinToChannel(pinNumber);
+
+    if (channel == NO_CHANNEL)
+    {
+        return;
+    }
+
+    P0IE = 0;
+    IEN2 &= ~IEN2_P1IE;
+
+    channelEdge[channel] = 0;
+    channelHandler[channel] = 0;
+
+    if (pinNumber < 10)
+    {
+        port0PinMask &= ~(1<<pinNumber);
+    }
+    else
+    {
+        port1PinMask &= ~(1<<(pinNumber - 10));
+    }
+
+    configurePorts(pinNumber);
+
+    if (port0PinMask){ P0IE = 1; }
+    if (port1PinMask){ IEN2 |= IEN2_P1IE; }
+}
+
+uint8 gpioInterruptEventsAvailable(void)
+{
+    return (gpioEventsInterruptIndex - gpioEventsMainLoopIndex) & (GPIO_INTERRUPT_EVENT_BUFFER_SIZE - 1);
+}
+
+uint8 gpioInterruptReadEvents(GPIO_EVENT XDATA * events, uint8 maxCount)
+{
+    uint8 count = 0;
+
+    // Only read gpioEventsInterruptIndex once; events added by the ISR
+    // while we are copying will be returned next time.
+    uint8 interruptIndex = gpioEventsInterruptIndex;
+
+    while(count < maxCount && gpioEventsMainLoopIndex != interruptIndex)
+    {
+        events[count] = gpioEvents[gpioEventsMainLoopIndex];
+        gpioEventsMainLoopIndex = (gpioEventsMainLoopIndex + 1) & (GPIO_INTERRUPT_EVENT_BUFFER_SIZE - 1);
+        count++;
+    }
+
+    return count;
+}
+
+void gpioInterruptService(void)
+{
+    static GPIO_EVENT XDATA event;
+
+    while(gpioInterruptReadEvents(&event, 1))
+    {
+        GpioEventHandler handler = channelHandler[pinToChannel(event.pinNumber)];
+        if (handler)
+        {
+            handler(&event);
+        }
+    }
+}
@@ -0,0 +1,341 @@
+/* input_capture.c:
+ *  Uses the capture channels of Timer 1 to timestamp edges.
+ *  See input_capture.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <input_capture.h>
+
+/** Note: This library assumes that the Wixel is running at 24 MHz and that
+ *  CLKCON.TICKSPD is 000 (see boardClockInit()). **/
+
+#define MAX_CAPTURES 3
+
+// T1CTL bits
+#define T1CTL_OVFIF   (1<<4)
+#define T1CTL_CH0IF   (1<<5)
+#define T1CTL_CH1IF   (1<<6)
+#define T1CTL_CH2IF   (1<<7)
+
+static BIT inputCaptureStartedFlag = 0;
+
+// The upper 16 bits of the 32-bit time.  Incremented by the ISR every time
+// Timer 1 overflows (every 2.73 ms).
+static volatile uint16 DATA overflowCount;
+
+// The bitmasks of the pins used on Port 0 and Port 1.
+static uint8 capturePinsOnPort0;
+static uint8 capturePinsOnPort1;
+
+// The pin used by each capture channel.  Port 0 pins are 2-4, Port 1 pins are 10-12.
+static uint8 XDATA capturePin[MAX_CAPTURES];
+
+// Bit n is set if capture channel n is used.
+static uint8 DATA captureChannels = 0;
+
+/*! This struct is part of the internal implementation of the input capture library. */
+struct CAPTURE_DATA
+{
+    uint32 lastRise;     /*!< Time of the last rising edge. */
+    uint32 pulseWidth;   /*!< Width of the last high pulse, or 0. */
+    uint32 period;       /*!< Time between the last two rising edges, or 0. */
+    uint8 riseCount;     /*!< Number of rising edges, modulo 256. */
+};
+
+static volatile struct CAPTURE_DATA XDATA captureData[MAX_CAPTURES];
+
+static volatile CAPTURE_EVENT XDATA captureEvents[INPUT_CAPTURE_EVENT_BUFFER_SIZE];  // must be a power of two
+static volatile uint8 DATA captureEventsMainLoopIndex = 0;  // Index of next event main loop will read.
+static volatile uint8 DATA captureEventsInterruptIndex = 0; // Index of next event interrupt will write.
+
+volatile uint8 DATA inputCaptureOverflowCount = 0;
+
+// Records one capture.  Only called from the ISR.
+static void recordCapture(uint8 captureNum, uint16 captured, BIT overflowPending, BIT level)
+{
+    uint32 time;
+    uint8 nextIndex;
+    volatile struct CAPTURE_DATA XDATA * d = captureData + captureNum;
+
+    // If the timer overflowed but we have not incremented overflowCount yet,
+    // then a small captured value means the edge happened after the overflow.
+    time = ((uint32)(overflowCount + (overflowPending && !(captured & 0x8000))) << 16) | captured;
+
+    if (level)
+    {
+        if (d->riseCount || d->lastRise)
+        {
+            d->period = time - d->lastRise;
+        }
+        d->lastRise = time;
+        d->riseCount++;
+    }
+    else if (d->riseCount)
+    {
+        d->pulseWidth = time - d->lastRise;
+    }
+
+    nextIndex = (captureEventsInterruptIndex + 1) & (INPUT_CAPTURE_EVENT_BUFFER_SIZE - 1);
+    if (nextIndex == captureEventsMainLoopIndex)
+    {
+        inputCaptureOverflowCount++;
+        return;
+    }
+
+    captureEvents[captureEventsInterruptIndex].time = time;
+    captureEvents[captureEventsInterruptIndex].captureNum = captureNum;
+    captureEvents[captureEventsInterruptIndex].level = level;
+    captureEventsInterruptIndex = nextIndex;
+}
+
+static BIT readCapturePin(uint8 captureNum)
+{
+    switch(capturePin[captureNum])
+    {
+    case 2:  return P0_2;
+    case 3:  return P0_3;
+    case 4:  return P0_4;
+    case 12: return P1_2;
+    case 11: return P1_1;
+    default: return P1_0;
+    }
+}
+
+// Returns the Timer 1 channel that captures on the specified pin, or 0xFF if
+// the pin is not a capture pin.  The channel is fixed by the hardware.
+static uint8 pinToChannel(uint8 pin)
+{
+    switch(pin)
+    {
+    case 2:  case 12: return 0;
+    case 3:  case 11: return 1;
+    case 4:  case 10: return 2;
+    default: return 0xFF;
+    }
+}
+
+ISR(T1, 0)
+{
+    uint8 flags = T1CTL;
+    BIT overflowPending = (flags & T1CTL_OVFIF) ? 1 : 0;
+
+    // Clear the flags we are about to handle.  Writing a 1 to a flag bit has
+    // no effect, so flags that got set after we read T1CTL are not lost.
+    // The lower bits of T1CTL (DIV and MODE) are preserved.
+    T1CTL = (flags & 0x0F) | (~flags & 0xF0);
+
+    if (flags & T1CTL_CH0IF)
+    {
+        recordCapture(0, T1CC0, overflowPending, readCapturePin(0));
+    }
+
+    if (flags & T1CTL_CH1IF)
+    {
+        recordCapture(1, T1CC1, overflowPending, readCapturePin(1));
+    }
+
+    if (flags & T1CTL_CH2IF)
+    {
+        recordCapture(2, T1CC2, overflowPending, readCapturePin(2));
+    }
+
+    if (overflowPending)
+    {
+        overflowCount++;
+    }
+}
+
+BIT inputCaptureStart(uint8 XDATA * pins, uint8 numPins)
+{
+    uint8 i;
+
+    if (pins != 0)
+    {
+        uint8 port0 = 0, port1 = 0, channels = 0;
+
+        if (numPins == 0 || numPins > MAX_CAPTURES)
+        {
+            return 0;
+        }
+
+        // Check all the pins before changing anything.
+        for (i = 0; i < numPins; i++)
+        {
+            uint8 channel = pinToChannel(pins[i]);
+            if (channel == 0xFF || (channels & (1<<channel)))
+            {
+                return 0;   // Not a capture pin, or two pins for the same channel.
+            }
+            channels |= (1<<channel);
+
+            if (pins[i] < 10)
+            {
+                port0 |= (1<<pins[i]);
+            }
+            else
+            {
+                port1 |= (1<<(pins[i] - 10));
+            }
+        }
+
+        if (port0 && port1)
+        {
+            return 0;   // Timer 1 can only use one of its pin locations at a time.
+        }
+
+        if (inputCaptureStartedFlag)
+        {
+            inputCaptureStop();
+        }
+
+        capturePinsOnPort0 = port0;
+        capturePinsOnPort1 = port1;
+        captureChannels = channels;
+        for (i = 0; i < numPins; i++)
+        {
+            capturePin[pinToChannel(pins[i])] = pins[i];
+        }
+    }
+    else if (inputCaptureStartedFlag)
+    {
+        inputCaptureStop();
+    }
+
+    for (i = 0; i < MAX_CAPTURES; i++)
+    {
+        captureData[i].lastRise = 0;
+        captureData[i].pulseWidth = 0;
+        captureData[i].period = 0;
+        captureData[i].riseCount = 0;
+    }
+    captureEventsMainLoopIndex = captureEventsInterruptIndex = 0;
+
+    // Turn off the timer and reset the counters.
+    T1CTL = 0;
+    T1CNTL = 0;  // resets high and low bytes
+    overflowCount = 0;
+
+    // Choose the Timer 1 location and give the pins to the timer.
+    P0DIR &= ~capturePinsOnPort0;
+    P1DIR &= ~capturePinsOnPort1;
+    if (capturePinsOnPort1)
+    {
+        PERCFG |= (1<<6);   // PERCFG.T1CFG = 1:  Timer 1 uses Alt. 2 location (P1_2, P1_1, P1_0)
+        P1SEL |= capturePinsOnPort1;
+    }
+    else
+    {
+        PERCFG &= ~(1<<6);  // PERCFG.T1CFG = 0:  Timer 1 uses Alt. 1 location (P0_2, P0_3, P0_4)
+        P0SEL |= capturePinsOnPort0;
+
+        // Set PRIP0[1:0] to 11 (Timer 1 channel 2 - USART0) so that Timer 1
+        // gets P0_4.  See the similar code in servo.c.
+        P2DIR |= 0b11000000;
+    }
+
+    // Configure the used Timer 1 channels in capture mode on both edges with
+    // their interrupts enabled (IM=1, MODE=0, CAP=11).
+    T1CCTL0 = (captureChannels & (1<<0)) ? 0b01000011 : 0;
+    T1CCTL1 = (captureChannels & (1<<1)) ? 0b01000011 : 0;
+    T1CCTL2 = (captureChannels & (1<<2)) ? 0b01000011 : 0;
+
+    // Timer 1: Start free-running mode, counting from 0x0000 to 0xFFFF, with
+    // no prescaler.  The overflow interrupt is always enabled for Timer 1.
+    T1CTL = 0b00000001;
+
+    T1IE = 1; // Enable the Timer 1 interrupt.
+    EA = 1;   // Enable interrupts in general.
+
+    inputCaptureStartedFlag = 1;
+    return 1;
+}
+
+void inputCaptureStop(void)
+{
+    if (!inputCaptureStartedFlag)
+    {
+        return;
+    }
+
+    T1IE = 0;
+    T1CCTL0 = T1CCTL1 = T1CCTL2 = 0;
+    T1CTL = 0;
+    P0SEL &= ~capturePinsOnPort0;
+    P1SEL &= ~capturePinsOnPort1;
+
+    inputCaptureStartedFlag = 0;
+}
+
+uint32 inputCaptureGetTime(void)
+{
+    uint8 low;
+    uint8 high;
+    uint16 overflows;
+
+    T1IE = 0; // Make sure we don't get interrupted in the middle of reading the time.
+    low = T1CNTL;      // Reading T1CNTL latches T1CNTH.
+    high = T1CNTH;
+    overflows = overflowCount;
+    if ((T1CTL & T1CTL_OVFIF) && !(high & 0x80))
+    {
+        // The timer overflowed but the ISR has not run yet.
+        overflows++;
+    }
+    T1IE = inputCaptureStartedFlag;
+
+    return ((uint32)overflows << 16) | ((uint16)high << 8) | low;
+}
+
+uint8 inputCaptureEventsAvailable(void)
+{
+    return (captureEventsInterruptIndex - captureEventsMainLoopIndex) & (INPUT_CAPTURE_EVENT_BUFFER_SIZE - 1);
+}
+
+uint8 inputCaptureReadEvents(CAPTURE_EVENT XDATA * events, uint8 maxCount)
+{
+    uint8 count = 0;
+    uint8 interruptIndex = captureEventsInterruptIndex;
+
+    while(count < maxCount && captureEventsMainLoopIndex != interruptIndex)
+    {
+        events[count] = captureEvents[captureEventsMainLoopIndex];
+        captureEventsMainLoopIndex = (captureEventsMainLoopIndex + 1) & (INPUT_CAPTURE_EVENT_BUFFER_SIZE - 1);
+        count++;
+    }
+
+    return count;
+}
+
+uint32 inputCapturePulseWidth(uint8 captureNum)
+{
+    uint32 width;
+    T1IE = 0; // Make sure we don't get interrupted in the middle of reading.
+    width = captureData[captureNum].pulseWidth;
+    T1IE = inputCaptureStartedFlag;
+    return width;
+}
+
+uint32 inputCapturePeriod(uint8 captureNum)
+{
+    uint32 period;
+    T1IE = 0;
+    period = captureData[captureNum].period;
+    T1IE = inputCaptureStartedFlag;
+    return period;
+}
+
+uint32 inputCaptureFrequency(uint8 captureNum)
+{
+    uint32 period = inputCapturePeriod(captureNum);
+    if (period == 0)
+    {
+        return 0;
+    }
+    return (INPUT_CAPTURE_TICKS_PER_SECOND + (period >> 1)) / period;
+}
+
+uint8 inputCaptureEdgeCount(uint8 captureNum)
+{
+    return captureData[captureNum].riseCount;
+}
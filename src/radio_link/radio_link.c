@@ -132,7 +132,7 @@ void radioLinkInit()
 static uint8 randomTxDelay()
 {
     // 200 and 250 were chosen arbitrarily.
-    return (radioLinkTxCurrentPacketTries > 200 ? 250 : 1) + (randomNumber() & 3);
+    return (radioLinkTxCurrentPacketTries > 200 ? 250 : 1) + (randomNumberFromIsr() & 3);
 }
 
 BIT radioLinkConnected()
@@ -181,6 +181,9 @@ void radioLinkTxSendPacket(uint8 payloadType)
         radioLinkTxMainLoopIndex++;
     }
 
+    // Top up the pool that randomTxDelay() uses in the RF ISR.
+    randomPoolService();
+
     // Make sure that radioMacEventHandler runs soon so it can see this new data and send it.
     // This must be done LAST.
     radioMacStrobe();
@@ -27,6 +27,7 @@
 #include <radio_registers.h>
 
 #include <random.h>
+#include <time.h>
 
 #define MAX_LATENCY_OF_STROBE  10
 
@@ -57,6 +58,32 @@ volatile uint8 DATA radioMacState = RADIO_MAC_STATE_OFF;
 volatile uint8 DATA savedRadioMacState;
 volatile uint8 DATA savedWOREVT1;
 
+// Residency statistics (see radioMacResidencyMs()), indexed by the
+// RADIO_MAC_STATE_* values, which match the RADIO_MAC_RESIDENCY_* values.
+// The time in each state is a 40-bit number of microseconds, so that no
+// division is needed in the ISR.
+static uint32 XDATA residencyUs[4];
+static uint8 XDATA residencyUsHigh[4];
+static uint8 DATA residencyState = RADIO_MAC_STATE_OFF;
+static uint32 XDATA residencyStart;
+
+// Adds the time since the last call to the state the radio was in, and
+// starts timing radioMacState.  Must be called with the RF interrupt
+// disabled, or from the RF ISR.
+static void residencyUpdate()
+{
+    uint32 now = getUs();
+    uint32 elapsed = now - residencyStart;
+
+    residencyStart = now;
+    residencyUs[residencyState] += elapsed;
+    if (residencyUs[residencyState] < elapsed)
+    {
+        residencyUsHigh[residencyState]++;
+    }
+    residencyState = radioMacState;
+}
+
 ISR(RF, 0)
 {
     S1CON = 0; // Clear the general RFIF interrupt registers
@@ -209,6 +236,8 @@ void radioMacEvent(uint8 event)
     	break;
     }
 
+    residencyUpdate();
+
     // Clear the strobe bit because we just ran the radioMacEventHandler.
     strobe = 0;
 }
@@ -229,6 +258,7 @@ void radioMacSleep()
 void radioMacResume()
 {
 	radioMacState = savedRadioMacState;
+	residencyUpdate();
 
 	if (MCSM2 == 0x00)
 	{
@@ -258,6 +288,8 @@ void radioMacInit()
 {
     radioRegistersInit();
 
+    residencyStart = getUs();
+
     // MCSM.FS_AUTOCAL = 1: Calibrate freq when going from IDLE to RX or TX (or FSTXON).
     MCSM0 = 0x14;    // Main Radio Control State Machine Configuration
     MCSM1 = 0x05;    // Disable CCA.  After RX, go to FSTXON.  After TX, go to FSTXON.
@@ -312,3 +344,34 @@ void radioMacTx(uint8 XDATA * packet)
 
     radioMacState = RADIO_MAC_STATE_TX;
 }
+
+uint32 radioMacResidencyMs(uint8 state)
+{
+    uint32 us;
+    uint8 high;
+    uint8 oldIEN2 = IEN2;
+
+    IEN2 &= ~0x01;    // Disable RF general interrupt
+    residencyUpdate();
+    us = residencyUs[state];
+    high = residencyUsHigh[state];
+    IEN2 = oldIEN2;
+
+    // (high * 2^32 + us) / 1000, where 2^32 = 4294967 * 1000 + 296
+    return high * (uint32)4294967 + us / 1000 + ((uint32)high * 296 + us % 1000) / 1000;
+}
+
+void radioMacClearResidency()
+{
+    uint8 i;
+    uint8 oldIEN2 = IEN2;
+
+    IEN2 &= ~0x01;    // Disable RF general interrupt
+    residencyUpdate();
+    for (i = 0; i < 4; i++)
+    {
+        residencyUs[i] = 0;
+        residencyUsHigh[i] = 0;
+    }
+    IEN2 = oldIEN2;
+}
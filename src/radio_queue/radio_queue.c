@@ -79,7 +79,7 @@ void radioQueueInit()
 // This is used to decide when to next transmit a queued data packet.
 static uint8 randomTxDelay()
 {
-    return 1 + (randomNumber() & 3);
+    return 1 + (randomNumberFromIsr() & 3);
 }
 
 /* TX FUNCTIONS (called by higher-level code in main loop) ********************/
@@ -117,6 +117,9 @@ void radioQueueTxSendPacket(void)
         radioQueueTxMainLoopIndex++;
     }
 
+    // Top up the pool that randomTxDelay() uses in the RF ISR.
+    randomPoolService();
+
     // Make sure that radioMacEventHandler runs soon so it can see this new data and send it.
     // This must be done LAST.
     radioMacStrobe();
@@ -2,9 +2,48 @@
 #include <cc2511_map.h>
 #include <random.h>
 
-/* Returns a new random number.  Warning: this is not reentrant.  It is possible that this function
- * could occasionally return the same random number to an ISR caller as it returns to a main loop
- * caller.
+/* The pool of bytes from the hardware random number generator that ISRs can
+ * take from without waiting.  The main loop is the only code that touches
+ * the hardware; it adds bytes at randomPoolMainLoopIndex, and ISRs take them
+ * at randomPoolInterruptIndex. */
+static volatile uint8 XDATA randomPool[RANDOM_POOL_SIZE];  // must be a power of two
+static volatile uint8 DATA randomPoolMainLoopIndex = 0;   // Index of next byte main loop will write.
+static volatile uint8 DATA randomPoolInterruptIndex = 0;  // Index of next byte interrupt will read.
+
+/* The states of the two software generators.  Each one has exactly one kind
+ * of caller, so neither needs to be protected from the other.  They must
+ * never be 0. */
+static uint16 DATA isrGeneratorState = 0xACE1;
+static uint16 DATA fastGeneratorState = 0x1D87;
+
+/* Advances a 16-bit xorshift generator (shifts 7, 9, 8), which visits every
+ * non-zero state.  This is a macro rather than a function so that the ISR
+ * and main loop versions do not share a non-reentrant function. */
+#define XORSHIFT16(x) { x ^= x << 7; x ^= x >> 9; x ^= x << 8; }
+
+/* Moves bytes from the hardware generator to the pool until the pool is full
+ * or the hardware is still busy.  Only called from the main loop. */
+void randomPoolService(void)
+{
+    uint8 nextIndex;
+
+    while(!(ADCCON1 & 0x0C))
+    {
+        nextIndex = (randomPoolMainLoopIndex + 1) & (RANDOM_POOL_SIZE - 1);
+        if (nextIndex == randomPoolInterruptIndex)
+        {
+            return;  // The pool is full.
+        }
+
+        randomPool[randomPoolMainLoopIndex] = RNDL;
+        ADCCON1 = (ADCCON1 & 0x30) | 0x07;   // Start generating the next random number.
+        randomPoolMainLoopIndex = nextIndex;
+    }
+}
+
+/* Returns a new random number.  This must only be called from the main loop,
+ * because it is the only code besides randomPoolService() that uses the
+ * hardware generator.  ISRs should use randomNumberFromIsr() instead.
  */
 uint8 randomNumber()
 {
@@ -15,6 +54,40 @@ uint8 randomNumber()
     return rand;
 }
 
+uint8 randomNumberFromIsr()
+{
+    uint8 index = randomPoolInterruptIndex;
+
+    XORSHIFT16(isrGeneratorState);
+
+    if (index != randomPoolMainLoopIndex)
+    {
+        // Mix the pool byte into the software generator too, so that it keeps
+        // picking up fresh randomness while the pool is being used.
+        isrGeneratorState ^= randomPool[index];
+        if (isrGeneratorState == 0){ isrGeneratorState = 0xACE1; }
+        randomPoolInterruptIndex = (index + 1) & (RANDOM_POOL_SIZE - 1);
+    }
+
+    return (uint8)isrGeneratorState;
+}
+
+uint8 randomFast()
+{
+    XORSHIFT16(fastGeneratorState);
+    return (uint8)fastGeneratorState;
+}
+
+void randomAddEntropy(uint8 byte)
+{
+    while(ADCCON1 & 0x0C);                   // Wait for the random number to finish.
+    RNDH = byte;                             // Run the byte through the CRC, mixing it into the state.
+
+    // Mix it into the main loop's software generator too.
+    fastGeneratorState = ((fastGeneratorState << 8) | (fastGeneratorState >> 8)) ^ byte;
+    if (fastGeneratorState == 0){ fastGeneratorState = 0x1D87; }
+}
+
 void randomSeed(uint8 seed_msb, uint8 seed_lsb)
 {
     // Rescue the random number from these two bad states: 0x0000 and 0x8003.
@@ -30,4 +103,11 @@ void randomSeed(uint8 seed_msb, uint8 seed_lsb)
     randomNumber();
     randomNumber();
     randomNumber();
+
+    // Seed the main loop's software generator from the hardware one.  The
+    // ISR's generator is not written here because an ISR might be using it;
+    // it picks up the new seed from the pool instead.
+    fastGeneratorState = ((uint16)randomNumber() << 8) | randomNumber() | 1;
+
+    randomPoolService();
 }
@@ -0,0 +1,131 @@
+/*! \file random_from_noise.c
+ * See random.h for more information.
+ */
+
+#include <cc2511_types.h>
+#include <cc2511_map.h>
+#include <random.h>
+#include <time.h>
+
+// MARCSTATE values
+#define MARCSTATE_IDLE  0x01
+#define MARCSTATE_RX    0x0D
+
+// Command strobes for RFST
+#define SRX     2
+#define SIDLE   4
+
+// Number of samples taken from each noise source.
+#define RSSI_SAMPLES    64
+#define ADC_SAMPLES     64
+
+// The byte being assembled from noise samples, and how many bits of noise
+// have gone into it since it was last passed to randomAddEntropy().
+static uint8 XDATA collected;
+static uint8 DATA collectedBits;
+
+// Folds a measurement down to 2 bits and adds them to the byte being
+// collected, and passes it on every 8 bits (4 measurements).  Each
+// measurement is only credited with 2 bits of noise, so only 2 bits of it
+// go into the byte; XORing the other bits in would just overwrite the
+// noise of the measurements before it.
+static void collect(uint8 noise)
+{
+    noise ^= noise >> 4;
+    noise ^= noise >> 2;
+    collected = (collected << 2) | (noise & 3);
+    collectedBits += 2;
+    if (collectedBits >= 8)
+    {
+        randomAddEntropy(collected);
+        collectedBits = 0;
+    }
+}
+
+static uint8 adcReadNoise(uint8 adccon3)
+{
+    ADCIF = 0;               // Clear the flag.
+    ADCCON3 = adccon3;
+    while(!ADCIF){};         // Wait for the reading to finish.
+
+    // The 12-bit result is in bits 4-15 of ADC, and its lowest bits are
+    // mostly noise.  Return its lowest 8 bits; collect() folds them together.
+    return (uint8)(ADC >> 4);
+}
+
+// Returns 1 if the radio was in RX or could be put in RX.  The radio is only
+// strobed if ownRadio is 1; otherwise the RSSI is only read if some other
+// code already has the radio in RX.
+static BIT rssiCollect(BIT ownRadio)
+{
+    BIT startedRx = 0;
+    uint8 i;
+
+    if (ownRadio && MARCSTATE == MARCSTATE_IDLE)
+    {
+        RFST = SRX;
+        startedRx = 1;
+
+        // Wait for the synthesizer to calibrate and settle (about 800 us).
+        for (i = 0; i < 20 && MARCSTATE != MARCSTATE_RX; i++)
+        {
+            delayMicroseconds(100);
+        }
+    }
+
+    if (MARCSTATE != MARCSTATE_RX)
+    {
+        if (startedRx){ RFST = SIDLE; }
+        return 0;
+    }
+
+    for (i = 0; i < RSSI_SAMPLES; i++)
+    {
+        // The RSSI is updated every few tens of microseconds; wait long
+        // enough that consecutive samples are not identical.
+        delayMicroseconds(60);
+        collect(RSSI);
+    }
+
+    if (startedRx){ RFST = SIDLE; }
+    return 1;
+}
+
+// Rescues the hardware generator if the mixing happened to leave it in one
+// of its two bad states (see randomSeed()).  The software generator used by
+// randomFast() has received the same noise, so the generator is seeded from
+// it instead of from a constant, which keeps the noise that was collected.
+static void rescueGenerator(void)
+{
+    uint8 msb, lsb;
+
+    while(ADCCON1 & 0x0C);
+    if ((RNDH == 0 && RNDL == 0) || (RNDH == 0x80 && RNDL == 0x03))
+    {
+        msb = randomFast();
+        lsb = randomFast();
+        randomSeed(msb, lsb);
+    }
+}
+
+void randomSeedFromNoise(BIT ownRadio)
+{
+    uint8 i;
+
+    collected = 0;
+    collectedBits = 0;
+
+    rssiCollect(ownRadio);
+
+    for (i = 0; i < ADC_SAMPLES; i++)
+    {
+        // Alternate between the temperature sensor and VDD/3, both measured
+        // against the internal reference with 12-bit resolution.
+        collect(adcReadNoise((i & 1) ? 0b00111110 : 0b00111111));
+    }
+
+    rescueGenerator();
+
+    // Give the ISRs some of the new randomness.
+    randomPoolService();
+}
@@ -0,0 +1,134 @@
+/* scheduler.c:
+ *  A run-to-completion scheduler with event flags and PM0 idle.
+ *  See scheduler.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <time.h>
+#include <sleep.h>
+#include <scheduler.h>
+
+static SchedulerTask XDATA taskFunction[SCHEDULER_MAX_TASKS];
+static uint32 XDATA taskRunTime[SCHEDULER_MAX_TASKS];
+static uint32 XDATA taskRunCount[SCHEDULER_MAX_TASKS];
+
+// The events posted to each task since it last ran.  Written by ISRs, so the
+// main loop only reads and clears them with interrupts disabled.
+static volatile uint8 XDATA taskEvents[SCHEDULER_MAX_TASKS];
+
+// Bit n is set if the task with priority n has events waiting (or, for a
+// polled task, if the CPU has woken up since it last ran).  Setting a bit in
+// a DATA variable is a single instruction, so ISRs can do it safely.
+static volatile uint8 DATA readyTasks = 0;
+
+// Bit n is set if the task with priority n is polled.
+static uint8 DATA polledTasks = 0;
+
+static uint32 XDATA idleTime = 0;
+
+void schedulerAddTask(uint8 priority, SchedulerTask task, uint8 flags)
+{
+    uint8 mask = 1 << priority;
+    uint8 oldEA = EA;
+
+    EA = 0;
+    taskFunction[priority] = task;
+    taskEvents[priority] = 0;
+    readyTasks &= ~mask;
+    polledTasks &= ~mask;
+    if (task && (flags & SCHEDULER_POLLED))
+    {
+        polledTasks |= mask;
+        readyTasks |= mask;
+    }
+    EA = oldEA;
+}
+
+void schedulerPost(uint8 priority, uint8 events) __reentrant
+{
+    uint8 oldEA = EA;
+    EA = 0;
+    taskEvents[priority] |= events;
+    readyTasks |= (1 << priority);
+    EA = oldEA;
+}
+
+void schedulerRunOnce(void)
+{
+    uint8 priority;
+    uint8 mask;
+    uint8 events;
+    uint32 start;
+
+    while(readyTasks)
+    {
+        // Find the highest priority ready task.
+        for (priority = 0, mask = 1; !(readyTasks & mask); priority++, mask <<= 1){}
+
+        EA = 0;
+        readyTasks &= ~mask;
+        events = taskEvents[priority];
+        taskEvents[priority] = 0;
+        EA = 1;
+
+        if (taskFunction[priority])
+        {
+            start = getUs();
+            taskFunction[priority](events);
+            taskRunTime[priority] += getUs() - start;
+            taskRunCount[priority]++;
+        }
+    }
+
+    // Idle the CPU (PM0) until the next interrupt if nothing is ready.
+    // Interrupts are disabled for the check, and sleepIdle() enables them
+    // right before it goes idle, so an event posted after the check wakes
+    // the CPU up instead of waiting for the next interrupt.
+    EA = 0;
+    if (!readyTasks)
+    {
+        idleTime += sleepIdle();
+    }
+    else
+    {
+        EA = 1;
+    }
+
+    // Every interrupt might have given the polled tasks some work.
+    readyTasks |= polledTasks;
+}
+
+void schedulerRun(void)
+{
+    while(1)
+    {
+        schedulerRunOnce();
+    }
+}
+
+uint32 schedulerTaskRunTime(uint8 priority)
+{
+    return taskRunTime[priority];
+}
+
+uint32 schedulerTaskRunCount(uint8 priority)
+{
+    return taskRunCount[priority];
+}
+
+uint32 schedulerIdleTime(void)
+{
+    return idleTime;
+}
+
+void schedulerClearStatistics(void)
+{
+    uint8 i;
+    for (i = 0; i < SCHEDULER_MAX_TASKS; i++)
+    {
+        taskRunTime[i] = 0;
+        taskRunCount[i] = 0;
+    }
+    idleTime = 0;
+}
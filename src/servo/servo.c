@@ -2,15 +2,15 @@
 
 /** Note: This library assumes that the Wixel is running at 24 MHz. **/
 
-/** Note: The servo pulse period used by this library is 2^16/24*7 = 19114.66 microseconds.
- *  There is no easy way to get a period of 20000 microseconds:
- *  We can't run the timer in modulo mode because then we would lose control of the
+/** Note: The default servo pulse period used by this library is 2^16/24*7 = 19114.66 microseconds.
+ *  We can't run the timer in modulo mode all the time because then we would lose control of the
  *    duty cycle of channel 0 (T1CC0 would be used to set the timer period).
  *  We can't set the T1CNT in an interrupt, because any write to T1CNTL resets the count to 0.
- *  We could delay for 900 microseconds in this interrupt and then write to T1CNTL,
- *    but that uses up a lot of CPU time.
- *  During one of the timer periods we could try switching the timer to modulo mode,
- *    to make the period shorter.
+ *  Instead, the timer periods that generate pulses always run in free-running mode, and
+ *    the rest of the servo period is made of "update" timer periods that run in modulo
+ *    mode, with lengths chosen so the servo period comes out right (see servosSetPeriod).
+ *  Timer periods that have nothing to do (because some pins or software groups are not used)
+ *    are skipped, which allows shorter servo periods.
  */
 
 /** Internal Channel Number   Pin       Timer 1 Channel     Alt Location
@@ -20,9 +20,66 @@
  *  3                         P1_2      0                   2
  *  4                         P1_1      1                   2
  *  5                         P1_0      2                   2
+ *  6-21                      any P0/P1 (software channels 0-15)
  */
 
-#define MAX_SERVOS 6
+/** Servo period layout.  Each servo period is made of up to 7 Timer 1 periods
+ *  (P0-P6), plus extra update periods (P7) if needed to make it longer.
+ *  The interrupt that runs at the beginning of period Pn is "case n" below.
+ *
+ *  Period    Hardware pulses     Software pulses     Mode
+ *  P0        -                   group 0             free-running
+ *  P1        Port 0 (Alt. 1)     -                   free-running
+ *  P2        -                   group 1             free-running
+ *  P3        -                   group 2             free-running
+ *  P4        Port 1 (Alt. 2)     -                   free-running
+ *  P5        -                   group 3             free-running
+ *  P6        -                   - (updates)         modulo
+ *  P7...     -                   -                   modulo
+ *
+ *  P0-P5 are skipped if they have nothing to do.  All of the Port 0 and
+ *  Port 1 pins are GPIO during the update periods, so changing T1CC0 does
+ *  not cause any glitches.
+ *
+ *  Software channel s is in group (s & 3).  All the pulses in a group start
+ *  together at SOFTWARE_PULSE_START and end in order of increasing width.
+ *  The Timer 1 ISR starts the pulses.  To end a pulse, Timer 3 (which has no
+ *  other job) is used as an alarm that fires a little before the end of the
+ *  pulse, and its ISR spins on T1CNT until the exact tick.  This gives us the
+ *  same time base as the hardware channels, with a jitter equal to the length
+ *  of the polling loop (well under 1 microsecond), as long as the T1 and T3
+ *  ISRs are not delayed by more than SOFTWARE_LEAD_TICKS.
+ */
+
+#define HARDWARE_SERVO_COUNT 6
+#define MAX_SOFTWARE_SERVOS 16
+#define MAX_SERVOS (HARDWARE_SERVO_COUNT + MAX_SOFTWARE_SERVOS)
+#define FIRST_SOFTWARE_CHANNEL HARDWARE_SERVO_COUNT
+
+#define SOFTWARE_GROUP_COUNT 4
+#define SOFTWARE_GROUP_SIZE (MAX_SOFTWARE_SERVOS / SOFTWARE_GROUP_COUNT)
+
+// The Timer 1 count at which software pulses start (40 us after the overflow).
+// This leaves time for the T1 ISR to start and do its other work.
+#define SOFTWARE_PULSE_START  960
+
+// The longest software pulse we can generate without running into the next
+// Timer 1 period.
+#define SOFTWARE_MAX_POSITION ((uint16)SERVO_MAX_TARGET_MICROSECONDS * SERVO_TICKS_PER_MICROSECOND)
+
+// The Timer 3 alarm fires this many Timer 1 ticks (40 us) before the end of a pulse.
+#define SOFTWARE_LEAD_TICKS   960
+
+// Pulses that end less than this many ticks (2 us) apart are ended together,
+// because the ISR could not end them separately on time anyway.
+#define SOFTWARE_MERGE_TICKS  48
+
+// Timer 3 runs with a prescaler of 128, so each Timer 3 tick is 128 Timer 1 ticks.
+#define TIMER3_SHIFT          7
+
+// T3CTL: DIV=111 (/128), START=1, OVFIM=1, CLR=0, MODE=01 (down).
+// In down mode, the counter is loaded from T3CC0 when the timer is started.
+#define T3CTL_ALARM           0b11111001
 
 // Keeps track of whether the library has been enabled or not.
 static BIT servosStartedFlag = 0;
@@ -33,9 +90,76 @@ static volatile BIT servosMovingFlag = 0;
 
 volatile uint8 DATA servoCounter = 0;
 
+#define UPDATE_SLOT 6
+#define EXTRA_UPDATE_SLOT 7
+
+// T1CTL values: no prescaler, free-running or modulo mode.
+#define T1CTL_FREE_RUNNING 0b00000001
+#define T1CTL_MODULO       0b00000010
+
+// The default servo period: seven full Timer 1 periods (19.11 ms).
+#define DEFAULT_PERIOD_TICKS 0x70000
+
+// The shortest allowed update period (1 ms), which leaves enough time for
+// the position updates.
+#define MIN_UPDATE_TICKS 24000
+
+// The servo period selected by servosSetPeriod(), in timer ticks.
+static uint32 XDATA servoPeriodTicks = DEFAULT_PERIOD_TICKS;
+
+// The total length of the timer periods P0-P5 that are in use, in ticks.
+// The servo period can not be shorter than this plus MIN_UPDATE_TICKS.
+static uint32 XDATA servoUsedTicks = 0;
+
+// The length of the servo period that is actually being generated, in ticks.
+// This is only different from servoPeriodTicks if servosStart() was called
+// with pins that need a longer period.
+static uint32 XDATA servoActualPeriodTicks = DEFAULT_PERIOD_TICKS;
+
+// The slot (value of servoCounter) that comes after each of the slots P0-P5,
+// and the first slot of each servo period.
+static uint8 XDATA servoNextSlot[UPDATE_SLOT];
+static uint8 DATA servoFirstSlot = 0;
+
+// The update periods: there are updateSlotCount of them, each is
+// updateSlotTop + 1 ticks long, and the first updateLongSlotCount of them
+// are one tick longer than that.
+static uint8 DATA updateSlotCount = 1;
+static uint8 DATA updateLongSlotCount = 0;
+static uint16 DATA updateSlotTop = 0xFFFF;
+
+// The index of the current update period.  Only used by the ISR.
+static uint8 DATA updateSlotIndex;
+
+// 1 if Timer 1 is in modulo mode.  Only used by the ISR.
+static BIT timer1Modulo = 0;
+
+// The length of the servo period in milliseconds, with 8 fractional bits.
+static uint16 XDATA servoPeriodMsQ8;
+
+// State of the keyframe sequence player.  See servoSequencePlay().
+static SERVO_SEQUENCE CODE * XDATA sequenceCurrent = 0;  // The sequence playing, or 0.
+static SERVO_SEQUENCE CODE * XDATA sequenceQueued = 0;   // The sequence to play next, or 0.
+static uint16 CODE * XDATA sequenceKeyframe;  // Points to the current keyframe.
+static uint8 XDATA sequenceKeyframeIndex;
+static uint8 XDATA sequenceKeyframeSize;     // The size of each keyframe, in bytes.
+static uint32 XDATA sequenceElapsed;         // Time spent in the current keyframe (ms, 8 fractional bits).
+static BIT sequencePaused = 0;
+static uint16 XDATA sequencePausedTarget[SERVO_MAX_COUNT];
+
 // Associates external channel number (the number picked by the user) to the
 // internal channel number.
-static uint8 XDATA servoAssignment[MAX_SERVOS];
+static uint8 XDATA servoAssignment[SERVO_MAX_COUNT];
+
+// The number of software channels in use.
+static uint8 DATA softwareServoCount = 0;
+
+// 1 if ISR(T3) is linked into the app, so software channels can be used.
+// Only servo_software.c sets this (see servoEnableSoftwareChannels).
+static BIT softwareChannelsEnabled = 0;
+
+// The number of servos (the numPins argument of servosStart).
+static uint8 DATA servoCount = 0;
 
 /*! This struct is part of the internal implementation of the servo library.
  *  See servo.h. */
@@ -44,11 +168,38 @@ struct SERVO_DATA
     uint16 target;       /*!< Target position, measured in ticks. */
     uint16 position;     /*!< Current position, measured in ticks. */
     uint16 positionReg;  /*!< The value to be written to the duty cycle register. */
-    uint16 speed;        /*!< The speed limit of the servo, in ticks per servo period (or 0 for no limit). */
+    uint16 speed;        /*!< The speed used for the current move, in ticks per servo period (or 0 for no limit). */
+    uint16 speedLimit;   /*!< The speed limit set by servoSetSpeed().  Normally equal to speed. */
+    uint16 acceleration; /*!< The acceleration limit, in ticks per servo period per servo period (or 0 for no limit). */
+    uint16 velocity;     /*!< The current speed, in ticks per servo period.  Only used if acceleration != 0. */
+    uint16 brakeDistance; /*!< The distance needed to stop from the current velocity. */
+    uint8 reverse;       /*!< 1 if the servo is moving towards smaller positions. */
 };
 
 static volatile struct SERVO_DATA XDATA servoData[MAX_SERVOS];
 
+/*! This struct is part of the internal implementation of the servo library.
+ *  It holds a set of targets staged by servoStageTarget(). */
+struct SERVO_BATCH
+{
+    uint16 target[SERVO_MAX_COUNT];  /*!< The staged targets, indexed by servo number. */
+    uint16 speed[SERVO_MAX_COUNT];   /*!< The speed to use for each move. */
+    uint8 staged[SERVO_MAX_COUNT];   /*!< Non-zero if the servo has a staged target. */
+};
+
+// Two batches: the main loop stages targets in one of them while the other
+// one is waiting to be applied by the ISR.  servosCommitTargets() swaps them.
+static struct SERVO_BATCH XDATA servoBatches[2];
+
+#define NO_BATCH 0xFF
+
+// The batch that servoStageTarget() writes to.  Only used by the main loop.
+static uint8 DATA stagingBatch = 0;
+
+// The batch that the ISR will apply at the start of the next servo period,
+// or NO_BATCH.  Set by the main loop and cleared by the ISR.
+static volatile uint8 DATA pendingBatch = NO_BATCH;
+
 // Bitmasks for keeping track of which pins are being used as servos.
 // A 1 bit indicates that the pin is a servo pulse output pin.
 // A 0 but indicates that the pin will be used for something else and
@@ -56,11 +207,471 @@ static volatile struct SERVO_DATA XDATA servoData[MAX_SERVOS];
 static volatile uint8 servoPinsOnPort0;
 static volatile uint8 servoPinsOnPort1;
 
+// The same, for the pins driven by software channels.  These pins stay GPIO
+// outputs the whole time and are driven by writing to P0 and P1.
+static uint8 softwarePinsOnPort0;
+static uint8 softwarePinsOnPort1;
+
+// The pin of each software channel, as a bitmask for P0 and a bitmask for P1.
+static uint8 XDATA softwarePort0Mask[MAX_SOFTWARE_SERVOS];
+static uint8 XDATA softwarePort1Mask[MAX_SOFTWARE_SERVOS];
+
+/*! This struct is part of the internal implementation of the servo library.
+ *  It represents the falling edges of one or more software pulses. */
+struct SERVO_EDGE
+{
+    uint16 time;         /*!< The value of T1CNT at which the pins go low. */
+    uint8 port0Mask;     /*!< The pins on Port 0 to drive low. */
+    uint8 port1Mask;     /*!< The pins on Port 1 to drive low. */
+};
+
+/*! This struct is part of the internal implementation of the servo library.
+ *  It holds the schedule for one group of software channels, and is
+ *  computed from the positions at the beginning of every servo period. */
+struct SERVO_GROUP
+{
+    uint8 port0Mask;     /*!< The pins on Port 0 to drive high at the start. */
+    uint8 port1Mask;     /*!< The pins on Port 1 to drive high at the start. */
+    uint8 edgeCount;     /*!< The number of entries in edges. */
+    struct SERVO_EDGE edges[SOFTWARE_GROUP_SIZE];  /*!< Sorted by time. */
+};
+
+static struct SERVO_GROUP XDATA servoGroups[SOFTWARE_GROUP_COUNT];
+
+// Sets the target of a servo, making it take effect immediately if necessary.
+// This is called from the T1 ISR and from the main loop with T1IE = 0, so
+// it can not be called by both at the same time.
+static void applyTarget(volatile struct SERVO_DATA XDATA * d, uint16 target)
+{
+    if ((d->speed == 0 && d->acceleration == 0) || d->target == 0 || target == 0)
+    {
+        d->position = target;
+        d->positionReg = ~target + 1;
+        d->velocity = d->brakeDistance = 0;
+    }
+    else if (target != d->position)
+    {
+        servosMovingFlag = 1;
+    }
+
+    d->target = target;
+}
+
+// Computes the next position of a servo that has an acceleration limit.
+// The profile is trapezoidal: the velocity changes by the acceleration in each
+// servo period, up to the speed limit.  The servo starts braking when the
+// distance to the target reaches the braking distance, which is the sum of
+// the velocities that the servo will have while slowing down:
+//   brake(v) = (v-a) + (v-2a) + ...
+// Since brake(v+a) = brake(v) + v, the braking distance can be kept up to
+// date with additions and subtractions.  This is only called from the T1 ISR,
+// so it must not use 16-bit multiplication, division, or modulus.
+static uint16 accelerateServo(volatile struct SERVO_DATA XDATA * d, uint16 pos)
+{
+    uint16 target = d->target;
+    uint16 vel = d->velocity;
+    uint16 brake = d->brakeDistance;
+    uint16 a = d->acceleration;
+    uint16 cap = d->speed ? d->speed : 0xFFFF;
+    uint16 distance;
+    BIT towards;
+
+    if (a > cap)
+    {
+        a = cap;
+    }
+
+    if (vel == 0)
+    {
+        // The servo is stopped, so it can start moving in either direction.
+        d->reverse = (target < pos);
+    }
+
+    if (d->reverse)
+    {
+        towards = (target < pos);
+        distance = pos - target;
+    }
+    else
+    {
+        towards = (target > pos);
+        distance = target - pos;
+    }
+
+    if (towards && vel <= cap - a && distance >= (uint32)vel + vel + a + brake)
+    {
+        // Speed up.  There is still enough room to stop afterwards.
+        brake += vel;
+        vel += a;
+    }
+    else if (towards && vel <= cap && distance >= (uint32)vel + brake)
+    {
+        // Keep the same speed.
+    }
+    else if (vel >= a)
+    {
+        // Slow down: the servo is getting close to the target, it is moving
+        // away from the target, or the speed limit was lowered.
+        vel -= a;
+        brake -= vel;
+    }
+    else
+    {
+        vel = brake = 0;
+    }
+
+    if (towards && brake == 0 && distance <= vel)
+    {
+        // Arrived.  This also handles distances less than one acceleration step.
+        pos = target;
+        vel = 0;
+    }
+    else if (towards && vel == 0)
+    {
+        pos = target;
+    }
+    else if (d->reverse)
+    {
+        // If the target changed suddenly, the servo might pass it and come
+        // back, but it should never go below 1 (0 would turn off the pulses).
+        pos = (pos > vel) ? pos - vel : 1;
+    }
+    else
+    {
+        pos = (0xFFFF - pos > vel) ? pos + vel : 0xFFFF;
+    }
+
+    d->velocity = vel;
+    d->brakeDistance = brake;
+    return pos;
+}
+
+// Returns n / d, rounded up, or 0xFFFF if that does not fit in 16 bits.
+// This is only called from the T1 ISR and from the main loop with T1IE = 0,
+// so it does the division with shifts and subtractions instead of calling
+// the division support routines, which are not reentrant.
+static uint16 divideRoundUp(uint32 n, uint16 d)
+{
+    uint32 divisor = (uint32)d << 15;
+    uint16 bit = 0x8000;
+    uint16 quotient = 0;
+
+    n += d - 1;
+    if (n >= divisor << 1)
+    {
+        return 0xFFFF;
+    }
+
+    while(bit)
+    {
+        if (n >= divisor)
+        {
+            n -= divisor;
+            quotient |= bit;
+        }
+        divisor >>= 1;
+        bit >>= 1;
+    }
+    return quotient;
+}
+
+// Starts moving the servos to the current keyframe.  Each servo gets the
+// speed that makes it arrive in the last servo period of the keyframe: the
+// distance divided by the number of servo periods that the rest of the
+// keyframe takes.  If the keyframe is shorter than a servo period, the
+// servos jump to their targets.
+// This is only called from the T1 ISR and from the main loop with T1IE = 0.
+static void applyKeyframe(void)
+{
+    uint16 CODE * k = sequenceKeyframe + 1;
+    uint32 duration = (uint32)*sequenceKeyframe << 8;
+    uint16 periods = 0;
+    uint8 i;
+
+    if (duration > sequenceElapsed)
+    {
+        periods = divideRoundUp(duration - sequenceElapsed, servoPeriodMsQ8);
+    }
+
+    for(i = 0; i < sequenceCurrent->servoCount; i++)
+    {
+        uint16 target = *k++;
+        volatile struct SERVO_DATA XDATA * d = servoData + servoAssignment[i];
+        uint16 position = d->position;
+
+        if (target == SERVO_KEYFRAME_UNCHANGED)
+        {
+            continue;
+        }
+
+        // Convert microseconds to ticks: multiply by 24 without calling the
+        // multiplication support routine.
+        target = (target << 4) + (target << 3);
+
+        d->speed = 0;
+        if (periods > 1)
+        {
+            d->speed = divideRoundUp((target > position) ? (target - position) : (position - target), periods);
+        }
+        applyTarget(d, target);
+    }
+}
+
+// Starts playing a sequence from the beginning, or stops if it is 0.
+// This is only called from the T1 ISR and from the main loop with T1IE = 0.
+static void startSequence(SERVO_SEQUENCE CODE * sequence)
+{
+    sequenceCurrent = sequence;
+    sequencePaused = 0;
+    if (sequence == 0 || sequence->keyframeCount == 0 || sequence->servoCount > servoCount)
+    {
+        sequenceCurrent = 0;
+        return;
+    }
+    sequenceKeyframe = sequence->keyframes;
+    sequenceKeyframeIndex = 0;
+    sequenceKeyframeSize = (1 + sequence->servoCount) * sizeof(uint16);
+    applyKeyframe();
+}
+
+// Advances the sequence player by one servo period.
+// This is only called from the T1 ISR, so it must not use 16-bit
+// multiplication, division, or modulus.
+static void advanceSequence(void)
+{
+    uint32 duration = (uint32)*sequenceKeyframe << 8;
+
+    sequenceElapsed += servoPeriodMsQ8;
+    if (sequenceElapsed < duration)
+    {
+        return;
+    }
+
+    // The current keyframe is done, so move on to the next one.  The time
+    // that it ran over is carried into the next keyframe, so the keyframe
+    // times do not drift by up to a servo period each.  Only one keyframe is
+    // started per servo period, so if the keyframes are shorter than that,
+    // the carry is limited to one period instead of building up forever.
+    sequenceElapsed -= duration;
+    if (sequenceElapsed > servoPeriodMsQ8)
+    {
+        sequenceElapsed = servoPeriodMsQ8;
+    }
+    sequenceKeyframeIndex++;
+    sequenceKeyframe = (uint16 CODE *)((uint8 CODE *)sequenceKeyframe + sequenceKeyframeSize);
+
+    if (sequenceKeyframeIndex < sequenceCurrent->keyframeCount)
+    {
+        applyKeyframe();
+    }
+    else if (sequenceQueued)
+    {
+        startSequence(sequenceQueued);
+        sequenceQueued = 0;
+    }
+    else if (sequenceCurrent->loop)
+    {
+        startSequence(sequenceCurrent);
+    }
+    else
+    {
+        sequenceCurrent = 0;
+    }
+}
+
+// The group whose pulses are being generated, and the next edge to generate.
+// These are only used by the T1 and T3 ISRs, which have the same priority.
+static struct SERVO_GROUP XDATA * DATA activeGroup;
+static uint8 DATA activeEdge;
+static uint16 DATA edgeTime;
+
+// Spins until T1CNT reaches edgeTime.
+// This loop is only a few instructions long, which determines the jitter of
+// the software pulses, so keep it simple.
+static void waitForEdgeTime(void)
+{
+    uint8 low, high;
+    do
+    {
+        low = T1CNTL;   // Reading T1CNTL latches T1CNTH.
+        high = T1CNTH;
+    }
+    while((((uint16)high << 8) | low) < edgeTime);
+}
+
+static uint16 readTimer1(void)
+{
+    uint8 low = T1CNTL;
+    return ((uint16)T1CNTH << 8) | low;
+}
+
+// Generates the falling edges of the active group that are coming up soon,
+// and then arms Timer 3 to call this function again before the next one.
+// This is only called from ISR(T1) and from ISR(T3) in servo_software.c.
+void servoServiceSoftwareEdges(void)
+{
+    while(activeEdge < activeGroup->edgeCount)
+    {
+        struct SERVO_EDGE XDATA * e = activeGroup->edges + activeEdge;
+        uint16 now = readTimer1();
+
+        edgeTime = e->time;
+
+        // Timer 1 is free-running while the pulses are generated, and every
+        // edge is in the current Timer 1 period, so the edge is late if and
+        // only if the count has already passed it.  Late edges are ended now.
+        if (now < edgeTime)
+        {
+            uint16 remaining = edgeTime - now;
+
+            if (remaining > SOFTWARE_LEAD_TICKS)
+            {
+                // The edge is far away, so set an alarm.  The division is
+                // rounded up so that the alarm does not fire more than
+                // SOFTWARE_LEAD_TICKS before the edge.  If the edge is further
+                // away than Timer 3 can count, the alarm will just come back
+                // here and set another one.
+                remaining = (remaining - SOFTWARE_LEAD_TICKS + (1 << TIMER3_SHIFT) - 1) >> TIMER3_SHIFT;
+                T3CTL = 0;
+                T3CC0 = (remaining > 255) ? 255 : remaining;
+                T3CTL = T3CTL_ALARM;
+                return;
+            }
+
+            // The edge is close, so wait for it.
+            waitForEdgeTime();
+        }
+
+        P0 &= ~e->port0Mask;
+        P1 &= ~e->port1Mask;
+        activeEdge++;
+    }
+
+    T3CTL = 0;  // Stop Timer 3.
+}
+
+// Starts generating the pulses of a software group.  This spins until
+// SOFTWARE_PULSE_START, so it should only be called at the beginning of a
+// Timer 1 period.  It is only called from the T1 ISR.
+static void startSoftwareGroup(uint8 group)
+{
+    activeGroup = servoGroups + group;
+    activeEdge = 0;
+    if (activeGroup->edgeCount == 0)
+    {
+        return;
+    }
+
+    edgeTime = SOFTWARE_PULSE_START;
+    waitForEdgeTime();
+    P0 |= activeGroup->port0Mask;
+    P1 |= activeGroup->port1Mask;
+
+    servoServiceSoftwareEdges();
+}
+
+// Computes the schedule of each software group from the current positions.
+// This is only called from the T1 ISR, so it must not use 16-bit
+// multiplication, division, or modulus (see the warning in the ISR).
+static void buildSoftwareSchedule(void)
+{
+    uint8 g, s, k;
+
+    for(g = 0; g < SOFTWARE_GROUP_COUNT; g++)
+    {
+        struct SERVO_GROUP XDATA * group = servoGroups + g;
+        struct SERVO_EDGE XDATA * edges = group->edges;
+        uint8 count = 0;
+
+        group->port0Mask = group->port1Mask = 0;
+
+        for(s = g; s < softwareServoCount; s += SOFTWARE_GROUP_COUNT)
+        {
+            uint16 pos = servoData[FIRST_SOFTWARE_CHANNEL + s].position;
+            uint16 end;
+
+            if (pos == 0)
+            {
+                continue;  // No pulses for this channel.
+            }
+
+            if (pos > SOFTWARE_MAX_POSITION)
+            {
+                pos = SOFTWARE_MAX_POSITION;
+            }
+            end = SOFTWARE_PULSE_START + pos;
+
+            group->port0Mask |= softwarePort0Mask[s];
+            group->port1Mask |= softwarePort1Mask[s];
+
+            // Find the first edge that comes after this one.
+            for(k = 0; k < count && edges[k].time <= end; k++){}
+
+            if (k > 0 && end - edges[k-1].time < SOFTWARE_MERGE_TICKS)
+            {
+                k--;   // Merge with the edge before.
+            }
+            else if (!(k < count && edges[k].time - end < SOFTWARE_MERGE_TICKS))
+            {
+                // Insert a new edge at position k.
+                uint8 j;
+                for(j = count; j > k; j--)
+                {
+                    edges[j] = edges[j-1];
+                }
+                edges[k].time = end;
+                edges[k].port0Mask = edges[k].port1Mask = 0;
+                count++;
+            }
+
+            edges[k].port0Mask |= softwarePort0Mask[s];
+            edges[k].port1Mask |= softwarePort1Mask[s];
+        }
+
+        group->edgeCount = count;
+    }
+}
+
 ISR(T1, 0)
 {
     uint8 i;
+    uint8 slot = servoCounter;
+
+    if (slot < UPDATE_SLOT)
+    {
+        if (timer1Modulo)
+        {
+            // The update periods are over.  T1CC0 is 0xFFFF, so the timer
+            // has been behaving like it is in free-running mode already.
+            T1CTL = T1CTL_FREE_RUNNING;
+            timer1Modulo = 0;
+        }
+        servoCounter = servoNextSlot[slot];
+    }
+    else
+    {
+        if (!timer1Modulo)
+        {
+            T1CTL = T1CTL_MODULO;
+            timer1Modulo = 1;
+        }
+
+        // Set the length of the next timer period.  This is buffered like the
+        // other T1CCx registers, so it takes effect at the next period.
+        updateSlotIndex = (slot == UPDATE_SLOT) ? 1 : updateSlotIndex + 1;
+        if (updateSlotIndex < updateSlotCount)
+        {
+            T1CC0 = updateSlotTop + (updateSlotIndex < updateLongSlotCount);
+            servoCounter = EXTRA_UPDATE_SLOT;
+        }
+        else
+        {
+            T1CC0 = 0xFFFF;
+            servoCounter = servoFirstSlot;
+        }
+    }
 
-    switch(servoCounter++)
+    switch(slot)
     {
     case 0:
         PERCFG &= ~(1<<6);  // PERCFG.T1CFG = 0:  Move Timer 1 to Alt. 1 location (P0_2, P0_3, P0_4)
@@ -68,14 +679,17 @@ ISR(T1, 0)
         T1CC0 = servoData[0].positionReg;  // NOTE: T1CCx is buffered, so these commands
         T1CC1 = servoData[1].positionReg;  // don't take effect until the next timer period.
         T1CC2 = servoData[2].positionReg;
+        if (softwareServoCount){ startSoftwareGroup(0); }
         break;
 
     case 3:
+        P0SEL &= ~servoPinsOnPort0;  // In case P2 was skipped.
         PERCFG |= (1<<6);  // PERCFG.T1CFG = 1:  Move Timer 1 to Alt. 2 location (P1_2, P1_1, P1_0)
         P1SEL |= servoPinsOnPort1;
         T1CC0 = servoData[3].positionReg;
         T1CC1 = servoData[4].positionReg;
         T1CC2 = servoData[5].positionReg;
+        if (softwareServoCount){ startSoftwareGroup(2); }
         break;
 
     case 1:
@@ -87,16 +701,20 @@ ISR(T1, 0)
     case 2:
         // The pulses on port 0 just finished, so assign the pins to be GPIO (driving low) again.
         P0SEL &= ~servoPinsOnPort0;
+        if (softwareServoCount){ startSoftwareGroup(1); }
         break;
 
     case 5:
         // The pulses on port 1 just finished, so assign the pins to be GPIO (driving low) again.
         P1SEL &= ~servoPinsOnPort1;
+        if (softwareServoCount){ startSoftwareGroup(3); }
         break;
 
-    case 6:
-        // Set the counter back to zero so that next time we will start over at the beginning.
-        servoCounter = 0;
+    case UPDATE_SLOT:
+        // In case P2 or P5 was skipped, make sure the pins are GPIO now.
+        // T1CC0 does not reach the end of this period for a long time.
+        P0SEL &= ~servoPinsOnPort0;
+        P1SEL &= ~servoPinsOnPort1;
 
         // Update the positions of all the servos according to their speed limits,
         // and update servosMovingFlag.
@@ -107,14 +725,44 @@ ISR(T1, 0)
         // using external support routines that are not reentrant, so we can't do any of those operations here!
         // The assembly generated by this ISR in servo.lst should be checked whenever making changes to the ISR.
 
+        // Apply the targets committed by servosCommitTargets(), so that all
+        // of the servos in the batch start moving during the same period.
+        if (pendingBatch != NO_BATCH)
+        {
+            struct SERVO_BATCH XDATA * b = servoBatches + pendingBatch;
+            for(i = 0; i < servoCount; i++)
+            {
+                if (b->staged[i])
+                {
+                    volatile struct SERVO_DATA XDATA * d = servoData + servoAssignment[i];
+                    d->speed = b->speed[i];
+                    applyTarget(d, b->target[i]);
+                }
+            }
+            pendingBatch = NO_BATCH;
+        }
+
+        if (sequenceCurrent && !sequencePaused)
+        {
+            advanceSequence();
+        }
+
         servosMovingFlag = 0;
 
-        for(i = 0; i < MAX_SERVOS; i++)
+        for(i = 0; i < FIRST_SOFTWARE_CHANNEL + softwareServoCount; i++)
         {
             volatile struct SERVO_DATA XDATA * d = servoData + i;
             uint16 pos = d->position;
 
-            if (d->speed && pos)
+            if (d->acceleration && pos && d->target)
+            {
+                pos = accelerateServo(d, pos);
+                if (pos != d->target)
+                {
+                    servosMovingFlag = 1;
+                }
+            }
+            else if (d->speed && pos)
             {
                 if (d->target > pos)
                 {
@@ -149,8 +797,73 @@ ISR(T1, 0)
             d->positionReg = ~pos + 1;
         }
 
+        if (softwareServoCount)
+        {
+            buildSoftwareSchedule();
+        }
+
         break;
     }
+
+    if (servoCounter == UPDATE_SLOT)
+    {
+        // The next timer period is the first update period, so set its length.
+        // T1CC1 and T1CC2 do not have any pulses scheduled, and the update
+        // period returns the pins to GPIO long before T1CNT reaches T1CC0,
+        // so this does not affect any outputs.
+        T1CC0 = updateSlotTop + (updateLongSlotCount != 0);
+    }
+}
+
+// Decides which timer periods are needed and how long the update periods
+// should be, based on the pins in use and servoPeriodTicks.
+static void configureSchedule(void)
+{
+    uint8 used[UPDATE_SLOT];
+    uint8 i, last;
+    uint32 updateTicks;
+    uint32 usedTicks = 0;
+
+    // P2 and P5 are only needed for software pulses, because P3 and the
+    // update period also return the hardware pins to GPIO.
+    used[0] = servoPinsOnPort0 || softwareServoCount > 0;
+    used[1] = servoPinsOnPort0 != 0;
+    used[2] = softwareServoCount > 1;
+    used[3] = servoPinsOnPort1 || softwareServoCount > 2;
+    used[4] = servoPinsOnPort1 != 0;
+    used[5] = softwareServoCount > 3;
+
+    // Link the used slots together, in order, ending with the update slot.
+    updateTicks = servoPeriodTicks;
+    last = UPDATE_SLOT;
+    for (i = UPDATE_SLOT; i > 0; i--)
+    {
+        servoNextSlot[i-1] = last;
+        if (used[i-1])
+        {
+            last = i-1;
+            updateTicks -= 0x10000;
+            usedTicks += 0x10000;
+        }
+    }
+    servoFirstSlot = last;
+    servoUsedTicks = usedTicks;
+
+    // The period might be too short for the pins passed to servosStart().
+    if ((int32)updateTicks < MIN_UPDATE_TICKS)
+    {
+        updateTicks = MIN_UPDATE_TICKS;
+    }
+
+    // Split the rest of the servo period into update periods of at most
+    // 0x10000 ticks, and spread the remainder over them one tick at a time.
+    updateSlotCount = (updateTicks + 0xFFFF) >> 16;
+    updateSlotTop = updateTicks / updateSlotCount - 1;
+    updateLongSlotCount = updateTicks % updateSlotCount;
+
+    // 24000 ticks per millisecond, rounded to the nearest 1/256 ms.
+    servoActualPeriodTicks = usedTicks + updateTicks;
+    servoPeriodMsQ8 = (servoActualPeriodTicks * 256 + 12000) / 24000;
 }
 
 static uint8 pinToInternalChannelNumber(uint8 pin)
@@ -163,14 +876,55 @@ static uint8 pinToInternalChannelNumber(uint8 pin)
     case 12: return 3;
     case 11: return 4;
     case 10: return 5;
-    default: return 0;
+    default: return 0xFF;   // Not a Timer 1 pin, so it needs a software channel.
     }
 }
 
-void servosStart(uint8 XDATA * pins, uint8 numPins)
+// Returns 1 if every pin can be driven by a Timer 1 channel or, when
+// software channels are enabled, by a software channel.
+static BIT pinsSupported(uint8 XDATA * pins, uint8 numPins)
 {
+    uint8 usedChannels = 0;  // Bitmask of the hardware channels used so far.
     uint8 i;
 
+    for (i = 0; i < numPins; i++)
+    {
+        uint8 pin = pins[i];
+        uint8 internalChannelNumber = pinToInternalChannelNumber(pin);
+
+        if (internalChannelNumber != 0xFF && !(usedChannels & (1<<internalChannelNumber)))
+        {
+            usedChannels |= (1<<internalChannelNumber);
+        }
+        else if (!softwareChannelsEnabled || !(pin < 6 || (pin >= 10 && pin < 18)))
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// This is only called from servosStartWithSoftwareChannels in servo_software.c,
+// so software channels are never used unless ISR(T3) is linked in.
+void servoEnableSoftwareChannels(void)
+{
+    softwareChannelsEnabled = 1;
+}
+
+BIT servosStart(uint8 XDATA * pins, uint8 numPins)
+{
+    uint8 i;
+
+    if (numPins > SERVO_MAX_COUNT)
+    {
+        numPins = SERVO_MAX_COUNT;
+    }
+
+    if (pins != 0 && !pinsSupported(pins, numPins))
+    {
+        return 0;
+    }
+
     if (servosStartedFlag)
     {
         servosStop();
@@ -183,37 +937,84 @@ void servosStart(uint8 XDATA * pins, uint8 numPins)
     // of the old speeds, targets, and positions.
     if (pins != 0)
     {
+        uint8 usedChannels = 0;  // Bitmask of the hardware channels used so far.
+
         servoPinsOnPort0 = servoPinsOnPort1 = 0;
+        softwarePinsOnPort0 = softwarePinsOnPort1 = 0;
+        softwareServoCount = 0;
+        servoCount = numPins;
         for (i = 0; i < MAX_SERVOS; i++)
         {
             servoData[i].target = 0;
             servoData[i].position = 0;
             servoData[i].positionReg = 0;
             servoData[i].speed = 0;
+            servoData[i].speedLimit = 0;
+            servoData[i].acceleration = 0;
+            servoData[i].velocity = 0;
+            servoData[i].brakeDistance = 0;
+        }
 
-            if (i < numPins)
-            {
-                uint8 internalChannelNumber = pinToInternalChannelNumber(pins[i]);
+        for (i = 0; i < SERVO_MAX_COUNT; i++)
+        {
+            servoBatches[0].staged[i] = servoBatches[1].staged[i] = 0;
+        }
+        pendingBatch = NO_BATCH;
+        sequenceCurrent = sequenceQueued = 0;
 
-                servoAssignment[i] = internalChannelNumber;
+        for (i = 0; i < numPins; i++)
+        {
+            uint8 pin = pins[i];
+            uint8 internalChannelNumber = pinToInternalChannelNumber(pin);
 
-                switch(internalChannelNumber)
+            if (internalChannelNumber == 0xFF || (usedChannels & (1<<internalChannelNumber)))
+            {
+                // Use a software channel.  pinsSupported() checked that the
+                // pin is on Port 0 or Port 1.
+                uint8 s = softwareServoCount++;
+                internalChannelNumber = FIRST_SOFTWARE_CHANNEL + s;
+                softwarePort0Mask[s] = softwarePort1Mask[s] = 0;
+                if (pin < 6)
                 {
-                case 0: P0_2 = 0; servoPinsOnPort0 |= (1<<2); break;
-                case 1: P0_3 = 0; servoPinsOnPort0 |= (1<<3); break;
-                case 2: P0_4 = 0; servoPinsOnPort0 |= (1<<4); break;
-                case 3: P1_2 = 0; servoPinsOnPort1 |= (1<<2); break;
-                case 4: P1_1 = 0; servoPinsOnPort1 |= (1<<1); break;
-                case 5: P1_0 = 0; servoPinsOnPort1 |= (1<<0); break;
+                    softwarePort0Mask[s] = (1<<pin);
                 }
+                else
+                {
+                    softwarePort1Mask[s] = (1<<(pin - 10));
+                }
+                softwarePinsOnPort0 |= softwarePort0Mask[s];
+                softwarePinsOnPort1 |= softwarePort1Mask[s];
+            }
+            else
+            {
+                usedChannels |= (1<<internalChannelNumber);
+            }
+
+            servoAssignment[i] = internalChannelNumber;
+
+            switch(internalChannelNumber)
+            {
+            case 0: P0_2 = 0; servoPinsOnPort0 |= (1<<2); break;
+            case 1: P0_3 = 0; servoPinsOnPort0 |= (1<<3); break;
+            case 2: P0_4 = 0; servoPinsOnPort0 |= (1<<4); break;
+            case 3: P1_2 = 0; servoPinsOnPort1 |= (1<<2); break;
+            case 4: P1_1 = 0; servoPinsOnPort1 |= (1<<1); break;
+            case 5: P1_0 = 0; servoPinsOnPort1 |= (1<<0); break;
             }
         }
 
+        for (i = 0; i < SOFTWARE_GROUP_COUNT; i++)
+        {
+            servoGroups[i].edgeCount = 0;
+        }
+
         // Set all the pins being used to be general-purpose outputs driving low for now.
-        P0SEL &= ~servoPinsOnPort0;
-        P0DIR |= servoPinsOnPort0;
-        P1SEL &= ~servoPinsOnPort1;
-        P1DIR |= servoPinsOnPort1;
+        P0 &= ~softwarePinsOnPort0;
+        P1 &= ~softwarePinsOnPort1;
+        P0SEL &= ~(servoPinsOnPort0 | softwarePinsOnPort0);
+        P0DIR |= servoPinsOnPort0 | softwarePinsOnPort0;
+        P1SEL &= ~(servoPinsOnPort1 | softwarePinsOnPort1);
+        P1DIR |= servoPinsOnPort1 | softwarePinsOnPort1;
 
         if (servoPinsOnPort0)
         {
@@ -229,7 +1030,9 @@ void servosStart(uint8 XDATA * pins, uint8 numPins)
     // Turn off the timer and reset the counters.
     T1CTL = 0;
     T1CNTL = 0;  // resets high and low bytes
-    servoCounter = 0;
+    configureSchedule();
+    servoCounter = servoFirstSlot;
+    timer1Modulo = 0;
 
     // Configure Timer 1 Channels 0-2 to be in compare mode.  Set output on compare-up, clear on 0.
     // This means all three pulses will start at different times but end at the same time.
@@ -244,13 +1047,33 @@ void servosStart(uint8 XDATA * pins, uint8 numPins)
     // Timer 1: Start free-running mode, counting from 0x0000 to 0xFFFF.
     T1CTL = 0b00000001;
 
-    // Set the Timer 1 interrupt priority to 2, the second highest.
-    IP0 &= ~(1<<1);
-    IP1 |= (1<<1);
+    if (softwareServoCount)
+    {
+        // Timer 3 is the alarm for the software channels: stop it and
+        // disable its compare channels so that only the overflow interrupts it.
+        T3CTL = 0;
+        T3CCTL0 = T3CCTL1 = 0;
+        T3OVFIF = 0;
+        T3IF = 0;
+
+        // Set the Timer 1 and Timer 3 interrupt priorities to 3, the highest,
+        // because the accuracy of the software pulses depends on their latency.
+        // This also affects the ADC, P2INT/USB, and UART1 interrupts.
+        IP0 |= (1<<1) | (1<<3);
+        IP1 |= (1<<1) | (1<<3);
+        T3IE = 1; // Enable the Timer 3 interrupt.
+    }
+    else
+    {
+        // Set the Timer 1 interrupt priority to 2, the second highest.
+        IP0 &= ~(1<<1);
+        IP1 |= (1<<1);
+    }
     T1IE = 1; // Enable the Timer 1 interrupt.
     EA = 1;   // Enable interrupts in general.
 
     servosStartedFlag = 1;
+    return 1;
 }
 
 void servosStop(void)
@@ -273,12 +1096,42 @@ void servosStop(void)
     P0SEL &= ~servoPinsOnPort0;
     P1SEL &= ~servoPinsOnPort1;
 
+    // The software pulses of the last period have also finished by now,
+    // because they are shorter than a Timer 1 period.  Stop the alarm and
+    // make sure the software pins are low.
+    T3IE = 0;
+    T3CTL = 0;
+    P0 &= ~softwarePinsOnPort0;
+    P1 &= ~softwarePinsOnPort1;
+
     // Turn off Timer 1.
     T1CTL = 0;
 
     servosStartedFlag = 0;
 }
 
+BIT servosSetPeriod(uint16 periodMicroseconds)
+{
+    uint32 ticks = periodMicroseconds ? (uint32)periodMicroseconds * SERVO_TICKS_PER_MICROSECOND : DEFAULT_PERIOD_TICKS;
+
+    if (ticks < servoUsedTicks + MIN_UPDATE_TICKS)
+    {
+        // Too short for the pins in use, so keep the current period.
+        return 0;
+    }
+
+    T1IE = 0; // Make sure we don't get interrupted in the middle of an update.
+    servoPeriodTicks = ticks;
+    configureSchedule();
+    T1IE = servosStartedFlag;
+    return 1;
+}
+
+uint16 servosGetPeriod(void)
+{
+    return (servoActualPeriodTicks + SERVO_TICKS_PER_MICROSECOND/2) / SERVO_TICKS_PER_MICROSECOND;
+}
+
 BIT servosStarted(void)
 {
     return servosStartedFlag;
@@ -303,18 +1156,10 @@ void servoSetTargetHighRes(uint8 servoNum, uint16 target)
 
     T1IE = 0; // Make sure we don't get interrupted in the middle of an update.
 
-    // Make this function have an immediate effect, if necessary.
-    if (d->speed == 0 || d->target == 0 || target == 0)
-    {
-        d->position = target;
-        d->positionReg = ~target + 1;
-    }
-    else if (target != d->position)
-    {
-        servosMovingFlag = 1;
-    }
-
-    d->target = target;
+    // Undo any speed scaling from a synchronized batch, and make this
+    // function have an immediate effect, if necessary.
+    d->speed = d->speedLimit;
+    applyTarget(d, target);
 
     T1IE = servosStartedFlag;
 }
@@ -347,10 +1192,213 @@ void servoSetSpeed(uint8 servoNum, uint16 speed)
 {
     T1IE = 0; // Make sure we don't get interrupted in the middle of an update.
     servoData[servoAssignment[servoNum]].speed = speed;
+    servoData[servoAssignment[servoNum]].speedLimit = speed;
     T1IE = servosStartedFlag;
 }
 
 uint16 servoGetSpeed(uint8 servoNum)
 {
-    return servoData[servoAssignment[servoNum]].speed;
+    return servoData[servoAssignment[servoNum]].speedLimit;
+}
+
+void servoStageTarget(uint8 servoNum, uint16 targetMicroseconds)
+{
+    servoStageTargetHighRes(servoNum, targetMicroseconds * SERVO_TICKS_PER_MICROSECOND);
+}
+
+void servoStageTargetHighRes(uint8 servoNum, uint16 target)
+{
+    // The staging batch is only used by the main loop, so no need to disable interrupts.
+    servoBatches[stagingBatch].target[servoNum] = target;
+    servoBatches[stagingBatch].staged[servoNum] = 1;
+}
+
+void servosCommitTargets(BIT synchronized)
+{
+    struct SERVO_BATCH XDATA * b = servoBatches + stagingBatch;
+    uint16 frames = 0;
+    uint8 i;
+
+    // Choose the speed of each move.
+    for (i = 0; i < servoCount; i++)
+    {
+        b->speed[i] = servoData[servoAssignment[i]].speedLimit;
+    }
+
+    if (synchronized)
+    {
+        // Find out how many servo periods the slowest move will take.
+        // Servos without a speed limit, or that are starting from or going to
+        // 0 (no pulses), move immediately and are not included.
+        for (i = 0; i < servoCount; i++)
+        {
+            uint16 position = servoGetPositionHighRes(i);
+            uint16 target = b->target[i];
+            uint16 distance = (target > position) ? (target - position) : (position - target);
+            uint16 speed = b->speed[i];
+            uint16 f;
+
+            if (!b->staged[i] || speed == 0 || position == 0 || target == 0)
+            {
+                continue;
+            }
+
+            f = distance / speed + (distance % speed != 0);
+            if (f > frames)
+            {
+                frames = f;
+            }
+
+            b->speed[i] = distance;  // Remember the distance for the next loop.
+            b->staged[i] = 2;        // Mark this move as one to scale.
+        }
+
+        // Slow down the other moves so they take the same number of periods.
+        // The speed is rounded up so no move takes longer than the slowest one.
+        for (i = 0; i < servoCount; i++)
+        {
+            uint16 distance = b->speed[i];
+
+            if (b->staged[i] != 2)
+            {
+                continue;
+            }
+
+            b->speed[i] = frames ? (distance / frames + (distance % frames != 0)) : 0;
+            if (b->speed[i] == 0)
+            {
+                b->speed[i] = 1;
+            }
+        }
+    }
+
+    // Wait for the ISR to apply the previous batch, if there is one.
+    // This takes at most one servo period.
+    while(pendingBatch != NO_BATCH && servosStartedFlag){};
+
+    // Swap the batches.  The ISR will apply this one at the start of the next servo period.
+    pendingBatch = stagingBatch;
+    stagingBatch ^= 1;
+    for (i = 0; i < SERVO_MAX_COUNT; i++)
+    {
+        servoBatches[stagingBatch].staged[i] = 0;
+    }
+}
+
+void servoSetAcceleration(uint8 servoNum, uint16 acceleration)
+{
+    volatile struct SERVO_DATA XDATA * d = servoData + servoAssignment[servoNum];
+
+    T1IE = 0; // Make sure we don't get interrupted in the middle of an update.
+    if (acceleration == 0)
+    {
+        d->velocity = d->brakeDistance = 0;
+    }
+    d->acceleration = acceleration;
+    T1IE = servosStartedFlag;
+}
+
+uint16 servoGetAcceleration(uint8 servoNum)
+{
+    return servoData[servoAssignment[servoNum]].acceleration;
+}
+
+void servoSequencePlay(SERVO_SEQUENCE CODE * sequence)
+{
+    T1IE = 0; // Make sure we don't get interrupted in the middle of an update.
+    sequenceQueued = 0;
+    sequenceElapsed = 0;
+    startSequence(sequence);
+    T1IE = servosStartedFlag;
+}
+
+void servoSequenceQueue(SERVO_SEQUENCE CODE * sequence)
+{
+    T1IE = 0;
+    if (sequenceCurrent)
+    {
+        sequenceQueued = sequence;
+    }
+    else
+    {
+        sequenceElapsed = 0;
+        startSequence(sequence);
+    }
+    T1IE = servosStartedFlag;
+}
+
+void servoSequenceStop(void)
+{
+    servoSequencePlay(0);
+}
+
+void servoSequencePause(void)
+{
+    uint8 i;
+
+    T1IE = 0;
+    if (sequenceCurrent && !sequencePaused)
+    {
+        // Remember where each servo was going, and stop it as soon as it
+        // can: a servo with an acceleration limit keeps decelerating until
+        // it reaches its braking point, and any other servo stops where it is.
+        for (i = 0; i < sequenceCurrent->servoCount; i++)
+        {
+            volatile struct SERVO_DATA XDATA * d = servoData + servoAssignment[i];
+            uint16 position = d->position;
+            uint16 brake = d->brakeDistance;
+
+            sequencePausedTarget[i] = d->target;
+            if (position == 0 || d->target == 0)
+            {
+                continue;
+            }
+
+            if (d->acceleration == 0 || d->velocity == 0)
+            {
+                d->target = position;
+            }
+            else if (d->reverse)
+            {
+                d->target = (position > brake) ? position - brake : 1;
+            }
+            else
+            {
+                d->target = (0xFFFF - position > brake) ? position + brake : 0xFFFF;
+            }
+        }
+        sequencePaused = 1;
+    }
+    T1IE = servosStartedFlag;
+}
+
+void servoSequenceResume(void)
+{
+    uint8 i;
+
+    T1IE = 0;
+    if (sequenceCurrent && sequencePaused)
+    {
+        for (i = 0; i < sequenceCurrent->servoCount; i++)
+        {
+            servoData[servoAssignment[i]].target = sequencePausedTarget[i];
+        }
+        sequencePaused = 0;
+    }
+    T1IE = servosStartedFlag;
+}
+
+BIT servoSequencePlaying(void)
+{
+    return sequenceCurrent != 0;
+}
+
+uint8 servoSequenceKeyframe(void)
+{
+    return sequenceKeyframeIndex;
+}
+
+BIT servosCommitPending(void)
+{
+    return pendingBatch != NO_BATCH;
 }
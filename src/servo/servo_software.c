@@ -0,0 +1,24 @@
+/* Timer 3 interrupt for the software servo channels.
+ *
+ * This is in its own file so that it only gets linked into apps that define
+ * SERVO_SOFTWARE_CHANNELS before including servo.h (see servo.h).  That macro
+ * makes servosStart() call servosStartWithSoftwareChannels(), which links this
+ * file, and this file is the only place that enables the software channels,
+ * so they are never used without the ISR. */
+
+#include <servo.h>
+
+void servoServiceSoftwareEdges(void);
+void servoEnableSoftwareChannels(void);
+
+BIT servosStartWithSoftwareChannels(uint8 XDATA * pins, uint8 numPins)
+{
+    servoEnableSoftwareChannels();
+    return servosStart(pins, numPins);
+}
+
+ISR(T3, 0)
+{
+    T3OVFIF = 0;
+    servoServiceSoftwareEdges();
+}
@@ -0,0 +1,397 @@
+/* timer_wheel.c:
+ *  A hierarchical timer wheel advanced by the Timer 4 ISR in time.c.
+ *  See timer_wheel.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <time.h>
+#include <timer_wheel.h>
+#include <sleep.h>
+
+// The millisecond counter maintained by the T4 ISR in time.c.
+extern PDATA volatile uint32 timeMs;
+
+/** The wheel has three levels of 64 slots each:
+ *  Level 0 (lists 0-63):     one slot per millisecond, for timers due in less than 64 ms.
+ *  Level 1 (lists 64-127):   one slot per 64 ms, for timers due in less than 4096 ms.
+ *  Level 2 (lists 128-191):  one slot per 4096 ms, for timers due in less than 262144 ms.
+ *  Timers due even later go in the overflow list.
+ *  When a level 0 slot comes around, its timers are due.  When a level 1 or
+ *  level 2 slot comes around, its timers are moved ("cascaded") down to the
+ *  lower levels.
+ *  The due list holds the timers that the ISR is about to expire; keeping them
+ *  in a real list means a callback can cancel any timer safely. */
+#define SLOT_BITS       6
+#define SLOT_COUNT      (1<<SLOT_BITS)
+#define LEVEL1_LIST     SLOT_COUNT
+#define LEVEL2_LIST     (2*SLOT_COUNT)
+#define OVERFLOW_LIST   (3*SLOT_COUNT)
+#define DUE_LIST        (3*SLOT_COUNT + 1)
+#define LIST_COUNT      (3*SLOT_COUNT + 2)
+
+// Used for "no timer" in the links and "no list" in timerList.
+#define NONE 0xFF
+
+// timerFlags bits
+#define FLAG_IN_USE     0x01
+#define FLAG_ISR        0x02
+#define FLAG_PENDING    0x04
+
+// The timers, stored as parallel arrays so that indexing them never needs a
+// multiplication (which would not be safe in the ISR).
+static uint32 XDATA timerExpires[TIMER_WHEEL_POOL_SIZE];
+static uint32 XDATA timerPeriod[TIMER_WHEEL_POOL_SIZE];
+static TimerWheelCallback XDATA timerCallback[TIMER_WHEEL_POOL_SIZE];
+static uint8 XDATA timerNext[TIMER_WHEEL_POOL_SIZE];
+static uint8 XDATA timerPrev[TIMER_WHEEL_POOL_SIZE];
+static uint8 XDATA timerList[TIMER_WHEEL_POOL_SIZE];
+static volatile uint8 XDATA timerFlags[TIMER_WHEEL_POOL_SIZE];
+
+static uint8 XDATA listHead[LIST_COUNT];
+
+// The first timer in the pool of free timers (linked with timerNext).
+static uint8 DATA freeHead;
+
+// The number of main loop timers waiting for timerWheelService().
+static volatile uint8 DATA pendingCount;
+
+// The time of the wheel, in milliseconds.  This follows getMs(), and is only
+// changed by the ISR.
+static volatile uint32 XDATA wheelTime;
+
+/* The functions below change the lists, so they must only be called by the
+ * ISR, or with the Timer 4 interrupt disabled. */
+
+static void link(uint8 t, uint8 list)
+{
+    uint8 head = listHead[list];
+    timerNext[t] = head;
+    timerPrev[t] = NONE;
+    if (head != NONE)
+    {
+        timerPrev[head] = t;
+    }
+    listHead[list] = t;
+    timerList[t] = list;
+}
+
+static void unlink(uint8 t)
+{
+    uint8 list = timerList[t];
+    uint8 next = timerNext[t];
+    uint8 prev = timerPrev[t];
+
+    if (list == NONE)
+    {
+        return;
+    }
+
+    if (prev != NONE)
+    {
+        timerNext[prev] = next;
+    }
+    else
+    {
+        listHead[list] = next;
+    }
+
+    if (next != NONE)
+    {
+        timerPrev[next] = prev;
+    }
+    timerList[t] = NONE;
+}
+
+// Puts a timer in the right list for its expiration time.
+static void place(uint8 t)
+{
+    uint32 expires = timerExpires[t];
+    uint32 delta = expires - wheelTime;
+
+    if (delta < SLOT_COUNT)
+    {
+        link(t, (uint8)expires & (SLOT_COUNT - 1));
+    }
+    else if (delta < ((uint32)1 << (2*SLOT_BITS)))
+    {
+        link(t, LEVEL1_LIST + ((uint8)(expires >> SLOT_BITS) & (SLOT_COUNT - 1)));
+    }
+    else if (delta < ((uint32)1 << (3*SLOT_BITS)))
+    {
+        link(t, LEVEL2_LIST + ((uint8)(expires >> (2*SLOT_BITS)) & (SLOT_COUNT - 1)));
+    }
+    else
+    {
+        link(t, OVERFLOW_LIST);
+    }
+}
+
+// Moves every timer in a list to the list it belongs in now.
+static void cascade(uint8 list)
+{
+    uint8 t = listHead[list];
+    listHead[list] = NONE;
+
+    while (t != NONE)
+    {
+        uint8 next = timerNext[t];
+        place(t);
+        t = next;
+    }
+}
+
+static void freeTimer(uint8 t)
+{
+    unlink(t);
+    if (timerFlags[t] & FLAG_PENDING)
+    {
+        pendingCount--;
+    }
+    timerFlags[t] = 0;
+    timerNext[t] = freeHead;
+    freeHead = t;
+}
+
+// Puts every timer back in the right list after the time has jumped
+// (because sleepUntil() added the time spent in PM1 or PM2).  Timers whose
+// time has passed become due now; a periodic timer that should have expired
+// several times only expires once.
+static void resync(uint32 time)
+{
+    uint8 t;
+
+    wheelTime = time;
+    for (t = 0; t < TIMER_WHEEL_POOL_SIZE; t++)
+    {
+        if (timerList[t] != NONE)
+        {
+            unlink(t);
+            if ((int32)(timerExpires[t] - time) < 1)
+            {
+                timerExpires[t] = time + 1;
+            }
+            place(t);
+        }
+    }
+}
+
+// Called by the Timer 4 ISR every millisecond.
+static void timerWheelTick(void)
+{
+    uint32 now = timeMs;
+    uint8 slot = (uint8)now & (SLOT_COUNT - 1);
+    uint8 t;
+
+    if (now - wheelTime != 1)
+    {
+        resync(now - 1);
+    }
+    wheelTime = now;
+
+    if (slot == 0)
+    {
+        uint8 slot1 = (uint8)(now >> SLOT_BITS) & (SLOT_COUNT - 1);
+        if (slot1 == 0)
+        {
+            uint8 slot2 = (uint8)(now >> (2*SLOT_BITS)) & (SLOT_COUNT - 1);
+            if (slot2 == 0)
+            {
+                cascade(OVERFLOW_LIST);
+            }
+            cascade(LEVEL2_LIST + slot2);
+        }
+        cascade(LEVEL1_LIST + slot1);
+    }
+
+    // Move the due timers to the due list.
+    t = listHead[slot];
+    listHead[slot] = NONE;
+    while (t != NONE)
+    {
+        uint8 next = timerNext[t];
+        link(t, DUE_LIST);
+        t = next;
+    }
+
+    while ((t = listHead[DUE_LIST]) != NONE)
+    {
+        BIT oneShot = (timerPeriod[t] == 0);
+
+        unlink(t);
+        if (!oneShot)
+        {
+            timerExpires[t] += timerPeriod[t];
+            place(t);
+        }
+
+        if (timerFlags[t] & FLAG_ISR)
+        {
+            timerCallback[t](t);
+            if (oneShot && (timerFlags[t] & FLAG_IN_USE) && timerList[t] == NONE)
+            {
+                freeTimer(t);
+            }
+        }
+        else if (!(timerFlags[t] & FLAG_PENDING))
+        {
+            timerFlags[t] |= FLAG_PENDING;
+            pendingCount++;
+        }
+    }
+}
+
+void timerWheelInit(void)
+{
+    uint8 i;
+
+    T4IE = 0;  // The ISR must not see a half-written timeMsHook.
+    timeMsHook = 0;
+
+    for (i = 0; i < LIST_COUNT; i++)
+    {
+        listHead[i] = NONE;
+    }
+
+    freeHead = NONE;
+    for (i = TIMER_WHEEL_POOL_SIZE; i-- > 0; )
+    {
+        timerFlags[i] = 0;
+        timerList[i] = NONE;
+        timerNext[i] = freeHead;
+        freeHead = i;
+    }
+
+    pendingCount = 0;
+    wheelTime = timeMs;
+
+    timeMsHook = timerWheelTick;
+    T4IE = 1;
+}
+
+uint8 timerWheelStart(uint32 delayMs, uint32 periodMs, TimerWheelCallback callback, uint8 flags) __reentrant
+{
+    uint8 t;
+    uint8 oldT4IE = T4IE;
+
+    T4IE = 0;  // Make sure we don't get interrupted in the middle of an update.
+
+    t = freeHead;
+    if (t != NONE)
+    {
+        freeHead = timerNext[t];
+
+        if (delayMs == 0)
+        {
+            delayMs = 1;
+        }
+        timerExpires[t] = wheelTime + delayMs;
+        timerPeriod[t] = periodMs;
+        timerCallback[t] = callback;
+        timerFlags[t] = (flags & TIMER_WHEEL_ISR) ? (FLAG_IN_USE | FLAG_ISR) : FLAG_IN_USE;
+        place(t);
+    }
+
+    T4IE = oldT4IE;
+    return t;
+}
+
+void timerWheelCancel(uint8 timer) __reentrant
+{
+    uint8 oldT4IE;
+
+    if (timer >= TIMER_WHEEL_POOL_SIZE)
+    {
+        return;
+    }
+
+    oldT4IE = T4IE;
+    T4IE = 0;
+    if (timerFlags[timer] & FLAG_IN_USE)
+    {
+        freeTimer(timer);
+    }
+    T4IE = oldT4IE;
+}
+
+BIT timerWheelActive(uint8 timer)
+{
+    return timer < TIMER_WHEEL_POOL_SIZE && (timerFlags[timer] & FLAG_IN_USE);
+}
+
+void timerWheelService(void)
+{
+    uint8 t;
+
+    for (t = 0; pendingCount && t < TIMER_WHEEL_POOL_SIZE; t++)
+    {
+        TimerWheelCallback callback;
+
+        if (!(timerFlags[t] & FLAG_PENDING))
+        {
+            continue;
+        }
+
+        T4IE = 0;
+        timerFlags[t] &= ~FLAG_PENDING;
+        pendingCount--;
+        callback = timerCallback[t];
+        T4IE = 1;
+
+        callback(t);
+
+        // A one-shot timer is finished once its callback has run, unless the
+        // callback cancelled it already.
+        T4IE = 0;
+        if ((timerFlags[t] & FLAG_IN_USE) && timerList[t] == NONE && timerPeriod[t] == 0)
+        {
+            freeTimer(t);
+        }
+        T4IE = 1;
+    }
+}
+
+BIT timerWheelNextDeadline(uint32 XDATA * deadlineMs)
+{
+    BIT found = 0;
+    uint32 best = 0;
+    uint8 t;
+
+    T4IE = 0;
+    for (t = 0; t < TIMER_WHEEL_POOL_SIZE; t++)
+    {
+        if (timerList[t] != NONE && (!found || (int32)(timerExpires[t] - best) < 0))
+        {
+            best = timerExpires[t];
+            found = 1;
+        }
+    }
+    T4IE = 1;
+
+    if (found)
+    {
+        *deadlineMs = best;
+    }
+    return found;
+}
+
+void timerWheelSleep(void)
+{
+    uint32 XDATA deadline;
+
+    if (pendingCount)
+    {
+        return;
+    }
+
+    if (timerWheelNextDeadline(&deadline))
+    {
+        // The wheel expires a timer in the tick where getMs() reaches its
+        // time, so wake up just before that tick.
+        sleepUntil(deadline - 1);
+    }
+    else
+    {
+        sleepUntil(SLEEP_NO_DEADLINE);
+    }
+}
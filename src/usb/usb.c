@@ -2,8 +2,8 @@
 #include <cc2511_map.h>
 #include <cc2511_types.h>
 #include <board.h>
+#include <dma.h>
 
-// TODO: make the usb library work will with Sleep Mode 0 (an interrupt should be enabled for all the endpoints we care about so we can handle them quickly)
 // TODO: SUSPEND MODE!
 
 extern uint8 CODE usbConfigurationDescriptor[];
@@ -23,37 +23,116 @@ XDATA uint8 * controlTransferPointer;
 
 volatile BIT usbSuspendMode = 0;
 
-// TODO: eventually: Enable the USB interrupt and only set usbActivityFlag in the ISR
 volatile BIT usbActivityFlag = 0;
 
+// 1 if the USB events are handled by the USB ISR instead of usbPoll().
+static BIT usbInterruptMode = 0;
+
+volatile uint8 DATA usbInEndpointEvents = 0;
+volatile uint8 DATA usbOutEndpointEvents = 0;
+
 void usbInit()
 {
 }
 
-// TODO: try using DMA in usbReadFifo and usbWriteFifo and see how that affects the speed of usbComTxSend(x, 128).
+// The arguments for the copy loops in usb_fifo.s.
+uint8 DATA usbFifoCount;
+uint8 DATA usbFifoAddress;   // The low byte of the FIFO's address.
+void usbFifoRead(uint8 XDATA * buffer);
+void usbFifoWrite(const uint8 XDATA * buffer);
+
 void usbReadFifo(uint8 endpointNumber, uint8 count, uint8 XDATA * buffer)
 {
-    XDATA uint8 * fifo = (XDATA uint8 *)(0xDE20 + (uint8)(endpointNumber<<1));
-    while(count > 0)
+    usbFifoCount = count;
+    usbFifoAddress = 0x20 + (uint8)(endpointNumber<<1);
+    usbFifoRead(buffer);
+
+    usbActivityFlag = 1;
+}
+
+void usbWriteFifo(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer)
+{
+    usbFifoCount = count;
+    usbFifoAddress = 0x20 + (uint8)(endpointNumber<<1);
+    usbFifoWrite(buffer);
+
+    // We don't set the usbActivityFlag here; we wait until the packet is
+    // actually sent.
+}
+
+// Sets up the USB DMA channel to copy count bytes between a FIFO and memory,
+// runs it, and waits for it to finish.
+static void usbFifoDma(uint16 source, uint16 destination, uint8 count, uint8 dc7)
+{
+    if (count == 0)
     {
-        count--;
-        *(buffer++) = *fifo;
+        return;
     }
 
+    dmaConfig.usb.SRCADDRH = source >> 8;
+    dmaConfig.usb.SRCADDRL = source;
+    dmaConfig.usb.DESTADDRH = destination >> 8;
+    dmaConfig.usb.DESTADDRL = destination;
+    dmaConfig.usb.VLEN_LENH = 0;
+    dmaConfig.usb.LENL = count;
+    dmaConfig.usb.DC6 = 0b00100000;  // WORDSIZE = 0, TMODE = 01 (block), TRIG = 0 (DMAREQ)
+    dmaConfig.usb.DC7 = dc7;
+
+    DMAIRQ = ~(1<<DMA_CHANNEL_USB);
+    DMAARM = (1<<DMA_CHANNEL_USB);
+
+    // Loading the configuration takes 9 clock cycles.
+    __asm
+        nop
+        nop
+        nop
+        nop
+        nop
+        nop
+        nop
+        nop
+        nop
+    __endasm;
+
+    DMAREQ = (1<<DMA_CHANNEL_USB);
+    while(!(DMAIRQ & (1<<DMA_CHANNEL_USB))){}
+    DMAIRQ = ~(1<<DMA_CHANNEL_USB);
+}
+
+void usbReadFifoDma(uint8 endpointNumber, uint8 count, uint8 XDATA * buffer)
+{
+    // SRCINC = 0, DESTINC = 1, IRQMASK = 0, M8 = 0, PRIORITY = 2 (high)
+    usbFifoDma(0xDE20 + (uint8)(endpointNumber<<1), (uint16)buffer, count, 0b00010010);
+
     usbActivityFlag = 1;
 }
 
-void usbWriteFifo(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer)
+void usbWriteFifoDma(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer)
+{
+    // SRCINC = 1, DESTINC = 0, IRQMASK = 0, M8 = 0, PRIORITY = 2 (high)
+    usbFifoDma((uint16)buffer, 0xDE20 + (uint8)(endpointNumber<<1), count, 0b01000010);
+}
+
+// Copies between Endpoint 0's FIFO and memory.  The event handler below uses
+// these instead of usbReadFifo() and usbWriteFifo() because it might be
+// running in the USB ISR while the main loop is in the middle of one of those
+// (non-reentrant) functions.
+static void ep0ReadFifo(uint8 count, uint8 XDATA * buffer)
 {
-    XDATA uint8 * fifo = (XDATA uint8 *)(0xDE20 + (uint8)(endpointNumber<<1));
     while(count > 0)
     {
         count--;
-        *fifo = *(buffer++);
+        *(buffer++) = USBF0;
     }
+}
 
-    // We don't set the usbActivityFlag here; we wait until the packet is
-    // actually sent.
+static void ep0WriteFifo(uint8 count, const uint8 XDATA * buffer)
+{
+    while(count > 0)
+    {
+        count--;
+        USBF0 = *(buffer++);
+    }
 }
 
 // Performs some basic tasks that should be done after USB is connected and after every
@@ -68,19 +147,43 @@ static void basicUsbInit()
     // Enable the USB common interrupts we care about: Reset, Resume, Suspend.
     // Without this, we USBCIF.SUSPENDIF will not get set (the datasheet is incomplete).
     USBCIE = 0b0111;
+
+    if (usbInterruptMode)
+    {
+        // Enable the interrupts for all of the IN endpoints (including
+        // Endpoint 0) and all of the OUT endpoints.
+        USBIIE = 0b111111;
+        USBOIE = 0b111110;
+    }
+    else
+    {
+        USBIIE = 0;
+        USBOIE = 0;
+    }
 }
 
-void usbPoll()
+void usbHandleEvents(uint8 usbcif, uint8 usbiif);
+
+void usbEnableInterrupt()
 {
-    uint8 usbcif;
-    uint8 usbiif;
-    //uint8 usboif = USBOIF;
+    usbInterruptMode = 1;
+    if (usbDeviceState != USB_STATE_DETACHED)
+    {
+        basicUsbInit();   // Enables the endpoint interrupts.
+        USBIF = 0;
+        IEN2 |= (1<<1);   // Enable the USB interrupt (IEN2.P2IE = 1).
+    }
+    usbPoll();
+}
 
+void usbPoll()
+{
     if (!usbPowerPresent())
     {
         // The VBUS line is low.  This usually means that the USB cable has been
         // disconnected or the computer has been turned off.
 
+        IEN2 &= ~(1<<1);  // Disable the USB interrupt (IEN2.P2IE = 0).
         SLEEP &= ~(1<<7); // Disable the USB module (SLEEP.USB_EN = 0).
 
         disableUsbPullup();
@@ -100,11 +203,25 @@ void usbPoll()
         usbDeviceState = USB_STATE_POWERED;
 
         basicUsbInit();
+
+        if (usbInterruptMode)
+        {
+            USBIF = 0;
+            IEN2 |= (1<<1);   // Enable the USB interrupt (IEN2.P2IE = 1).
+        }
     }
 
-    usbcif = USBCIF;
-    usbiif = USBIIF;
+    if (!usbInterruptMode)
+    {
+        usbHandleEvents(USBCIF, USBIIF);
+    }
+}
 
+// Handles the USB common events (Suspend, Resume, Reset) and the events on
+// Endpoint 0, given the values read from USBCIF and USBIIF.  This is called
+// by usbPoll(), or by the USB ISR (usb_isr.c) after usbEnableInterrupt().
+void usbHandleEvents(uint8 usbcif, uint8 usbiif)
+{
     if (usbcif & (1<<0)) // Check SUSPENDIF
     {
         // The bus has been idle for 3 ms, so we are now in Suspend mode.
@@ -163,7 +280,7 @@ void usbPoll()
                 {
                     bytesReceived = controlTransferBytesLeft;
                 }
-                usbReadFifo(0, bytesReceived, controlTransferPointer);
+                ep0ReadFifo(bytesReceived, controlTransferPointer);
                 controlTransferPointer += bytesReceived;
                 controlTransferBytesLeft -= bytesReceived;
 
@@ -201,7 +318,7 @@ void usbPoll()
                 // A SETUP packet has been received from the computer, starting a new
                 // control transfer.
 
-                usbReadFifo(0, 8, (uint8 XDATA *)&usbSetupPacket); // Store the data in usbSetupPacket.
+                ep0ReadFifo(8, (uint8 XDATA *)&usbSetupPacket); // Store the data in usbSetupPacket.
 
                 // Wipe out the information about the last control transfer.
                 controlTransferState = CONTROL_TRANSFER_STATE_NONE;
@@ -279,7 +396,7 @@ void usbPoll()
             }
 
             // Arm endpoint 0 to send the next packet.
-            usbWriteFifo(0, bytesToSend, controlTransferPointer);
+            ep0WriteFifo(bytesToSend, controlTransferPointer);
             USBCS0 = usbcs0;
 
             // Update the control transfer state.
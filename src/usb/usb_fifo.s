@@ -0,0 +1,170 @@
+    .module usb_fifo
+    .optsdcc -mmcs51 --model-medium
+    .area CSEG (CODE)
+
+; void usbFifoRead(uint8 XDATA * buffer)
+; void usbFifoWrite(const uint8 XDATA * buffer)
+;
+;   These are the inner loops of usbReadFifo() and usbWriteFifo() in usb.c.
+;   They copy usbFifoCount bytes between the buffer and the USB FIFO whose
+;   address is 0xDE00 + usbFifoAddress.
+;
+; Implementation Details:
+;    A C loop reloads DPTR from two different pointers for every byte.  Here
+;    the FIFO is accessed with MOVX @R0 (the high byte of the address comes
+;    from the MPAGE register) while DPTR points to the buffer, so each byte
+;    takes just three instructions, and the loop is unrolled 8 times.
+;
+;    The compiler uses MOVX @Ri to access PDATA, and an ISR could do that,
+;    so interrupts are disabled while MPAGE is changed.  They are enabled
+;    briefly between each group of 8 bytes so that an ISR never has to wait
+;    for more than about a microsecond.  (A write to IEN0 delays interrupts
+;    by one instruction, hence the NOP.)
+;
+;    R0 = low byte of the FIFO address
+;    R2 = number of bytes
+;    R3 = saved MPAGE
+;    R4 = loop counter
+;    C  = saved EA
+
+    .globl _usbFifoRead
+    .globl _usbFifoWrite
+    .globl _usbFifoCount
+    .globl _usbFifoAddress
+
+MPAGE = 0x93
+EA    = 0xAF
+
+_usbFifoRead:
+    mov r0,_usbFifoAddress
+    mov a,_usbFifoCount
+    jz readDone
+    mov r2,a
+    mov r3,MPAGE
+    mov c,EA
+    clr EA
+    mov MPAGE,#0xDE
+
+    ; Copy (count % 8) bytes one at a time.
+    anl a,#7
+    jz readBlocks
+    mov r4,a
+readOne:
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    djnz r4,readOne
+
+    ; Copy the rest 8 bytes at a time.
+readBlocks:
+    mov a,r2
+    rr a
+    rr a
+    rr a
+    anl a,#0x1F
+    jz readEnd
+    mov r4,a
+readEight:
+    mov MPAGE,r3
+    mov EA,c
+    nop
+    clr EA
+    mov MPAGE,#0xDE
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    movx a,@r0
+    movx @dptr,a
+    inc dptr
+    djnz r4,readEight
+
+readEnd:
+    mov MPAGE,r3
+    mov EA,c
+readDone:
+    ret
+
+_usbFifoWrite:
+    mov r0,_usbFifoAddress
+    mov a,_usbFifoCount
+    jz writeDone
+    mov r2,a
+    mov r3,MPAGE
+    mov c,EA
+    clr EA
+    mov MPAGE,#0xDE
+
+    ; Copy (count % 8) bytes one at a time.
+    anl a,#7
+    jz writeBlocks
+    mov r4,a
+writeOne:
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    djnz r4,writeOne
+
+    ; Copy the rest 8 bytes at a time.
+writeBlocks:
+    mov a,r2
+    rr a
+    rr a
+    rr a
+    anl a,#0x1F
+    jz writeEnd
+    mov r4,a
+writeEight:
+    mov MPAGE,r3
+    mov EA,c
+    nop
+    clr EA
+    mov MPAGE,#0xDE
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    movx a,@dptr
+    movx @r0,a
+    inc dptr
+    djnz r4,writeEight
+
+writeEnd:
+    mov MPAGE,r3
+    mov EA,c
+writeDone:
+    ret
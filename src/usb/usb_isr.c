@@ -0,0 +1,39 @@
+/* USB interrupt, used in interrupt-driven mode (see usbEnableInterrupt()).
+ *
+ * This is in its own file so that it only gets linked into apps that define
+ * USB_INTERRUPT_MODE before including usb.h (see usb.h). */
+
+#include <usb.h>
+#include <cc2511_map.h>
+
+void usbHandleEvents(uint8 usbcif, uint8 usbiif);
+
+ISR(USB, 0)
+{
+    uint8 savedIndex = USBINDEX;
+    uint8 usbcif;
+    uint8 usbiif;
+    uint8 usboif;
+
+    // Clear the CPU interrupt flag first so that any USB event that happens
+    // while we are running will make the ISR run again.
+    USBIF = 0;
+
+    // Reading these registers clears them.
+    usbcif = USBCIF;
+    usbiif = USBIIF;
+    usboif = USBOIF;
+
+    if ((usbiif & ~1) | usboif)
+    {
+        // Let the main loop know which non-zero endpoints need attention.
+        usbInEndpointEvents |= usbiif & ~1;
+        usbOutEndpointEvents |= usboif;
+        usbActivityFlag = 1;
+    }
+
+    usbHandleEvents(usbcif, usbiif);
+
+    // The main loop might have been in the middle of accessing an endpoint.
+    USBINDEX = savedIndex;
+}
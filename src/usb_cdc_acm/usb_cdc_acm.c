@@ -2,66 +2,14 @@
 #include <cc2511_types.h>
 #include <usb.h>
 #include <usb_com.h>
-#include <board.h>           // just for boardStartBootloader() and serialNumberString
+#include <usb_cdc_constants.h>
+#include <board.h>           // just for boardStartBootloader()
 #include <time.h>            // just for timing the start of the bootloader
 
 // NOTE: We could easily remove the dependency on time.h if we added a
 // function called startBootloaderSoon() in board.h that started the bootloader
 // after some delay.
 
-/* CDC ACM Library Configuration **********************************************/
-// Note: USB 2.0 says that the maximum packet size for full-speed bulk endpoints
-// can only be 8, 16, 32, or 64 bytes.
-// We picked endpoint 4 for the data because it has a 256-byte FIFO memory area,
-// which is exactly enough for us to have two 64-byte IN buffers and two 64-byte
-// OUT buffers.
-
-#define CDC_OUT_PACKET_SIZE          64
-#define CDC_IN_PACKET_SIZE           64
-#define CDC_CONTROL_INTERFACE_NUMBER 0
-#define CDC_DATA_INTERFACE_NUMBER    1
-
-#define CDC_NOTIFICATION_ENDPOINT    1
-#define CDC_NOTIFICATION_FIFO        USBF1   // This must match CDC_NOTIFICATION_ENDPOINT!
-
-#define CDC_DATA_ENDPOINT            4
-#define CDC_DATA_FIFO                USBF4   // This must match CDC_DATA_ENDPOINT!
-
-/* CDC and ACM Constants ******************************************************/
-
-// USB Class Codes
-#define CDC_CLASS 2                  // (CDC 1.20 Section 4.1: Communications Device Class Code).
-#define CDC_DATA_INTERFACE_CLASS 0xA // (CDC 1.20 Section 4.5: Data Class Interface Codes).
-
-// USB Subclass Codes
-#define CDC_SUBCLASS_ACM  2           // (CDC 1.20 Section 4.3: Communications Class Subclass Codes).  Refer to USBPSTN1.2.
-
-// USB Protocol Codes
-#define CDC_PROTOCOL_V250 1          // (CDC 1.20 Section 4.4: Communications Class Protocol Codes).
-
-// USB Descriptor types from CDC 1.20 Section 5.2.3, Table 12
-#define CDC_DESCRIPTOR_TYPE_CS_INTERFACE 0x24
-#define CDC_DESCRIPTOR_TYPE_CS_ENDPOINT  0x25
-
-// USB Descriptor sub-types from CDC 1.20 Table 13: bDescriptor SubType in Communications Class Functional Descriptors
-#define CDC_DESCRIPTOR_SUBTYPE_HEADER                       0
-#define CDC_DESCRIPTOR_SUBTYPE_CALL_MANAGEMENT              1
-#define CDC_DESCRIPTOR_SUBTYPE_ABSTRACT_CONTROL_MANAGEMENT  2
-#define CDC_DESCRIPTOR_SUBTYPE_UNION                        6
-
-// Request Codes from CDC 1.20 Section 6.2: Management Element Requests.
-#define ACM_GET_ENCAPSULATED_RESPONSE 0
-#define ACM_SEND_ENCAPSULATED_COMMAND 1
-
-// Request Codes from PSTN 1.20 Table 13.
-#define ACM_REQUEST_SET_LINE_CODING 0x20
-#define ACM_REQUEST_GET_LINE_CODING 0x21
-#define ACM_REQUEST_SET_CONTROL_LINE_STATE 0x22
-
-// Notification Codes from PSTN 1.20 Table 30.
-#define ACM_NOTIFICATION_RESPONSE_AVAILABLE 0x01
-#define ACM_NOTIFICATION_SERIAL_STATE 0x20
-
 /* Private Prototypes *********************************************************/
 static void doNothing();
 
@@ -104,6 +52,23 @@ static BIT sendEmptyPacketSoon = 0;
 // once we've loaded up a full packet we should always send it immediately.
 static uint8 DATA inFifoBytesLoaded = 0;
 
+// When a packet that is not full may be sent: USB_COM_FLUSH_IMMEDIATE,
+// USB_COM_FLUSH_FULL, or USB_COM_FLUSH_TIMED.
+static uint8 XDATA flushMode = USB_COM_FLUSH_IMMEDIATE;
+static uint16 XDATA flushTimeoutUs;
+
+// In USB_COM_FLUSH_TIMED mode, the time (from getUs()) when the first byte of
+// the partly filled packet was loaded, or when the full packet that requires
+// an empty packet was sent.
+static uint32 XDATA flushStartTime;
+
+// True if usbComTxFlush() was called and the packet has not been sent yet.
+static BIT flushSoon = 0;
+
+// Packet-fill statistics, indexed by USB_COM_TX_PACKET_*.
+static uint32 XDATA txPacketCount[3];
+static uint32 XDATA txByteCount;
+
 // True iff we have received a command from the user to enter bootloader mode.
 static BIT startBootloaderSoon = 0;
 
@@ -112,134 +77,19 @@ static BIT startBootloaderSoon = 0;
 // bootloader mode.  This variable is only valid when startBootloaderSoon == 1.
 static uint8 XDATA startBootloaderRequestTime;
 
-/* CDC ACM USB Descriptors ****************************************************/
-
-USB_DESCRIPTOR_DEVICE CODE usbDeviceDescriptor =
-{
-    sizeof(USB_DESCRIPTOR_DEVICE),
-    USB_DESCRIPTOR_TYPE_DEVICE,
-    0x0200,                 // USB Spec Release Number in BCD format
-    CDC_CLASS,              // Class Code: Communications Device Class
-    0,                      // Subclass code: must be 0 according to CDC 1.20 spec
-    0,                      // Protocol code: must be 0 according to CDC 1.20 spec
-    USB_EP0_PACKET_SIZE,    // Max packet size for Endpoint 0
-    USB_VENDOR_ID_POLOLU,   // Vendor ID
-    0x2200,                 // Product ID (Generic Wixel with one CDC ACM port)
-    0x0000,                 // Device release number in BCD format
-    1,                      // Index of Manufacturer String Descriptor
-    2,                      // Index of Product String Descriptor
-    3,                      // Index of Serial Number String Descriptor
-    1                       // Number of possible configurations.
-};
+// These bits are set by the control request handlers when the host has
+// changed the control line state or the line coding.  The handlers might run
+// in the USB ISR (see usbEnableInterrupt() in usb.h), so they do not call the
+// application's callbacks themselves; usbComService() does that.
+static volatile BIT lineStateChanged = 0;
+static volatile BIT lineCodingChanged = 0;
 
-CODE struct CONFIG1 {
-    struct USB_DESCRIPTOR_CONFIGURATION configuration;
+/* CDC ACM Class Request Handlers *********************************************/
+// These functions are called by the usbCallback* functions of the USB device
+// (usb_cdc_acm_device.c, or a composite device like usb_cdc_hid.c) when a USB
+// event happens that concerns the CDC ACM interfaces.
 
-    struct USB_DESCRIPTOR_INTERFACE communication_interface;
-    unsigned char class_specific[19];  // CDC-Specific Descriptors
-    struct USB_DESCRIPTOR_ENDPOINT notification_element;
-
-    struct USB_DESCRIPTOR_INTERFACE data_interface;
-    struct USB_DESCRIPTOR_ENDPOINT data_out;
-    struct USB_DESCRIPTOR_ENDPOINT data_in;
-} usbConfigurationDescriptor
-=
-{
-    {                                                    // Configuration Descriptor
-        sizeof(struct USB_DESCRIPTOR_CONFIGURATION),
-        USB_DESCRIPTOR_TYPE_CONFIGURATION,
-        sizeof(struct CONFIG1),                          // wTotalLength
-        2,                                               // bNumInterfaces
-        1,                                               // bConfigurationValue
-        0,                                               // iConfiguration
-        0xC0,                                            // bmAttributes: self powered (but may use bus power)
-        50,                                              // bMaxPower
-    },
-    {                                                    // Communications Interface: Used for device management.
-        sizeof(struct USB_DESCRIPTOR_INTERFACE),
-        USB_DESCRIPTOR_TYPE_INTERFACE,
-        CDC_CONTROL_INTERFACE_NUMBER,                    // bInterfaceNumber
-        0,                                               // bAlternateSetting
-        1,                                               // bNumEndpoints
-        CDC_CLASS,                                       // bInterfaceClass
-        CDC_SUBCLASS_ACM,                                // bInterfaceSubClass
-        CDC_PROTOCOL_V250,                               // bInterfaceProtocol
-        0                                                // iInterface
-    },
-    {                                                    // Functional Descriptors.
-
-        5,                                               // 5-byte General Descriptor: Header Functional Descriptor
-        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
-        CDC_DESCRIPTOR_SUBTYPE_HEADER,
-        0x20,0x01,                                       // bcdCDC.  We conform to CDC 1.20.
-
-
-        4,                                               // 4-byte PTSN-Specific Descriptor: Abstract Control Management Functional Descriptor.
-        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
-        CDC_DESCRIPTOR_SUBTYPE_ABSTRACT_CONTROL_MANAGEMENT,
-        2,                                               // bmCapabilities.  See USBPSTN1.2 Table 4.  We support SetLineCoding,
-                                                         //SetControlLineState, GetLineCoding, and SerialState notifications.
-
-        5,                                               // 5-byte General Descriptor: Union Interface Functional Descriptor (CDC 1.20 Table 16).
-        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
-        CDC_DESCRIPTOR_SUBTYPE_UNION,
-        CDC_CONTROL_INTERFACE_NUMBER,                    // index of the control interface
-        CDC_DATA_INTERFACE_NUMBER,                       // index of the subordinate interface
-
-        5,                                               // 5-byte PTSN-Specific Descriptor
-        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
-        CDC_DESCRIPTOR_SUBTYPE_CALL_MANAGEMENT,
-        0x00,                                            // bmCapabilities.  USBPSTN1.2 Table 3.  Device does not handle call management.
-        CDC_DATA_INTERFACE_NUMBER                        // index of the data interface
-    },
-    {
-        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
-        USB_DESCRIPTOR_TYPE_ENDPOINT,
-        USB_ENDPOINT_ADDRESS_IN | CDC_NOTIFICATION_ENDPOINT,  // bEndpointAddress
-        USB_TRANSFER_TYPE_INTERRUPT,                     // bmAttributes
-        10,                                              // wMaxPacketSize
-        1,                                               // bInterval
-    },
-    {
-        sizeof(struct USB_DESCRIPTOR_INTERFACE),         // Data Interface: used for RX and TX data.
-        USB_DESCRIPTOR_TYPE_INTERFACE,
-        CDC_DATA_INTERFACE_NUMBER,                       // bInterfaceNumber
-        0,                                               // bAlternateSetting
-        2,                                               // bNumEndpoints
-        CDC_DATA_INTERFACE_CLASS,                        // bInterfaceClass
-        0,                                               // bInterfaceSubClass
-        0,                                               // bInterfaceProtocol
-        0                                                // iInterface
-    },
-    {                                                    // OUT Endpoint: Sends data out to Wixel.
-        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
-        USB_DESCRIPTOR_TYPE_ENDPOINT,
-        USB_ENDPOINT_ADDRESS_OUT | CDC_DATA_ENDPOINT,    // bEndpointAddress
-        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
-        CDC_OUT_PACKET_SIZE,                             // wMaxPacketSize
-        0,                                               // bInterval
-    },
-    {
-        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
-        USB_DESCRIPTOR_TYPE_ENDPOINT,
-        USB_ENDPOINT_ADDRESS_IN | CDC_DATA_ENDPOINT,     // bEndpointAddress
-        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
-        CDC_IN_PACKET_SIZE,                              // wMaxPacketSize
-        0,                                               // bInterval
-    },
-};
-
-uint8 CODE usbStringDescriptorCount = 4;
-DEFINE_STRING_DESCRIPTOR(languages, 1, USB_LANGUAGE_EN_US)
-DEFINE_STRING_DESCRIPTOR(manufacturer, 18, 'P','o','l','o','l','u',' ','C','o','r','p','o','r','a','t','i','o','n')
-DEFINE_STRING_DESCRIPTOR(product, 5, 'W','i','x','e','l')
-uint16 CODE * CODE usbStringDescriptors[] = { languages, manufacturer, product, serialNumberStringDescriptor };
-
-/* CDC ACM USB callbacks ******************************************************/
-// These functions are called by the low-level USB module (usb.c) when a USB
-// event happens that requires higher-level code to make a decision.
-
-void usbCallbackInitEndpoints()
+void usbComInitEndpoints()
 {
     usbInitEndpointIn(CDC_NOTIFICATION_ENDPOINT, 10);
     usbInitEndpointOut(CDC_DATA_ENDPOINT, CDC_OUT_PACKET_SIZE);
@@ -251,7 +101,7 @@ void usbCallbackInitEndpoints()
 
 // Implements all the control transfers that are required by D1 of the
 // ACM descriptor bmCapabilities, (USBPSTN1.20 Table 4).
-void usbCallbackSetupHandler()
+void usbComSetupHandler()
 {
     if ((usbSetupPacket.bmRequestType & 0x7F) != 0x21)   // Require Type==Class and Recipient==Interface.
         return;
@@ -272,35 +122,20 @@ void usbCallbackSetupHandler()
         case ACM_REQUEST_SET_CONTROL_LINE_STATE:                   // SetControlLineState (USBPSTN1.20 Section 6.3.12 SetControlLineState)
             usbComControlLineState = usbSetupPacket.wValue;
             usbControlAcknowledge();
-
-			if(pLineStateChangeCallback)
-				pLineStateChangeCallback(usbComControlLineState);
-
+            lineStateChanged = 1;
             break;
     }
 
 }
 
-void usbCallbackClassDescriptorHandler(void)
-{
-    // Not used by CDC ACM
-}
-
 static void doNothing(void)
 {
     // Do nothing.
 }
 
-void usbCallbackControlWriteHandler()
+void usbComControlWriteHandler()
 {
-    usbComLineCodingChangeHandler();
-
-    if (usbComLineCoding.dwDTERate == 333 && !startBootloaderSoon)
-    {
-        // The baud rate has been set to 333.  That is the special signal
-        // sent by the USB host telling us to enter bootloader mode.
-		requestBootloaderSoon();
-    }
+    lineCodingChanged = 1;
 }
 
 /* CDC ACM RX Functions *******************************************************/
@@ -362,6 +197,28 @@ void usbComRxReceive(uint8 XDATA* buffer, uint8 size)
 }
 
 
+uint8 usbComRxPeek()
+{
+    // usbComRxAvailable() already does what we need: it returns USBCNTL, which
+    // goes down every time a byte is read from the FIFO.
+    return usbComRxAvailable();
+}
+
+void usbComRxRelease()
+{
+    if (usbDeviceState != USB_STATE_CONFIGURED)
+    {
+        return;
+    }
+
+    USBINDEX = CDC_DATA_ENDPOINT;
+    if (USBCSOL & USBCSOL_OUTPKT_RDY)
+    {
+        USBCSOL &= ~USBCSOL_OUTPKT_RDY;   // Tell the USB module we are done reading this packet, so it can receive more.
+        usbActivityFlag = 1;
+    }
+}
+
 /* CDC ACM TX Functions *******************************************************/
 // These functions can be called by the higher-level user of the CDC ACM library
 // to send bytes to the computer.
@@ -374,6 +231,25 @@ static void sendPacketNow()
     // If the last packet transmitted was a full packet, we should send an empty packet later.
     sendEmptyPacketSoon = (inFifoBytesLoaded == CDC_IN_PACKET_SIZE);
 
+    if (sendEmptyPacketSoon)
+    {
+        txPacketCount[USB_COM_TX_PACKET_FULL]++;
+
+        // The empty packet has to wait for the flush timeout too, in case more
+        // data comes soon and makes it unnecessary.
+        if (flushMode == USB_COM_FLUSH_TIMED)
+        {
+            flushStartTime = getUs();
+        }
+    }
+    else
+    {
+        // A short or empty packet ends the transfer, which is what a flush asks for.
+        txPacketCount[inFifoBytesLoaded ? USB_COM_TX_PACKET_SHORT : USB_COM_TX_PACKET_EMPTY]++;
+        flushSoon = 0;
+    }
+    txByteCount += inFifoBytesLoaded;
+
     // There are 0 bytes in the IN FIFO now.
     inFifoBytesLoaded = 0;
 
@@ -391,6 +267,29 @@ void usbComService(void)
 {
     usbPoll();
 
+    // Report the requests that the control request handlers recorded.
+    if (lineStateChanged)
+    {
+        lineStateChanged = 0;
+        if (pLineStateChangeCallback)
+        {
+            pLineStateChangeCallback(usbComControlLineState);
+        }
+    }
+
+    if (lineCodingChanged)
+    {
+        lineCodingChanged = 0;
+        usbComLineCodingChangeHandler();
+
+        if (usbComLineCoding.dwDTERate == 333 && !startBootloaderSoon)
+        {
+            // The baud rate has been set to 333.  That is the special signal
+            // sent by the USB host telling us to enter bootloader mode.
+            requestBootloaderSoon();
+        }
+    }
+
     // Start bootloader if necessary.
     if (startBootloaderSoon && (uint8)(getMs() - startBootloaderRequestTime) > 70)
     {
@@ -412,14 +311,24 @@ void usbComService(void)
     }
 
     // Send a packet now if there is data loaded in the FIFO waiting to be sent OR
+    // if the last packet sent was full and we need to send an empty packet.
     //
     // Typical USB systems wait for a short or empty packet before forwarding the data
     // up to the software that requested it, so this is necessary.  However, we only transmit
     // an empty packet if there are no packets currently loaded in the FIFO.
+    // The flush policy decides whether the packet can be sent yet.
     USBINDEX = CDC_DATA_ENDPOINT;
     if (inFifoBytesLoaded || ( sendEmptyPacketSoon && !(USBCSIL & USBCSIL_PKT_PRESENT) ) )
     {
-        sendPacketNow();
+        if (flushSoon || flushMode == USB_COM_FLUSH_IMMEDIATE ||
+            (flushMode == USB_COM_FLUSH_TIMED && getUs() - flushStartTime >= flushTimeoutUs))
+        {
+            sendPacketNow();
+        }
+    }
+    else if (!inFifoBytesLoaded && !sendEmptyPacketSoon)
+    {
+        flushSoon = 0;   // Nothing to flush.
     }
 
     // Notify the computer of the current serial state if necessary.
@@ -496,6 +405,11 @@ void usbComTxSend(const uint8 XDATA * buffer, uint8 size)
     uint8 packetSize;
     while(size)
     {
+        if (inFifoBytesLoaded == 0 && flushMode == USB_COM_FLUSH_TIMED)
+        {
+            flushStartTime = getUs();   // This is the first byte of a new packet.
+        }
+
         packetSize = CDC_IN_PACKET_SIZE - inFifoBytesLoaded;   // Decide how many bytes to send in this packet (packetSize).
         if (packetSize > size){ packetSize = size; }
 
@@ -516,6 +430,11 @@ void usbComTxSendByte(uint8 byte)
 {
     // Assumption: usbComTxAvailable() recently returned a non-zero number
 
+    if (inFifoBytesLoaded == 0 && flushMode == USB_COM_FLUSH_TIMED)
+    {
+        flushStartTime = getUs();   // This is the first byte of a new packet.
+    }
+
     CDC_DATA_FIFO = byte;                          // Give the byte to the USB module's FIFO.
     inFifoBytesLoaded++;
 
@@ -527,6 +446,38 @@ void usbComTxSendByte(uint8 byte)
     // Don't set usbActivityFlag here; wait until we actually send the packet.
 }
 
+void usbComTxSetFlushPolicy(uint8 mode, uint16 timeoutUs)
+{
+    flushMode = mode;
+    flushTimeoutUs = timeoutUs;
+
+    // Start timing anything that is already waiting from now.
+    flushStartTime = getUs();
+}
+
+void usbComTxFlush()
+{
+    flushSoon = 1;
+}
+
+uint32 usbComTxPacketCount(uint8 type)
+{
+    return txPacketCount[type];
+}
+
+uint32 usbComTxByteCount()
+{
+    return txByteCount;
+}
+
+void usbComTxClearStatistics()
+{
+    txPacketCount[USB_COM_TX_PACKET_FULL] = 0;
+    txPacketCount[USB_COM_TX_PACKET_SHORT] = 0;
+    txPacketCount[USB_COM_TX_PACKET_EMPTY] = 0;
+    txByteCount = 0;
+}
+
 /* CDC ACM CONTROL SIGNAL FUNCTIONS *******************************************/
 
 uint8 usbComRxControlSignals()
@@ -0,0 +1,161 @@
+/* usb_cdc_acm_device.c:
+ *  The USB descriptors and callbacks for a Wixel that is just one virtual COM
+ *  port.  The CDC ACM functions themselves are in usb_cdc_acm.c.
+ *
+ *  These are in a separate file so that a composite device (like the one in
+ *  usb_cdc_hid.c) can use the CDC ACM functions with its own descriptors.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <usb.h>
+#include <usb_com.h>
+#include <usb_cdc_constants.h>
+#include <board.h>           // just for serialNumberStringDescriptor
+
+/* CDC ACM USB Descriptors ****************************************************/
+
+USB_DESCRIPTOR_DEVICE CODE usbDeviceDescriptor =
+{
+    sizeof(USB_DESCRIPTOR_DEVICE),
+    USB_DESCRIPTOR_TYPE_DEVICE,
+    0x0200,                 // USB Spec Release Number in BCD format
+    CDC_CLASS,              // Class Code: Communications Device Class
+    0,                      // Subclass code: must be 0 according to CDC 1.20 spec
+    0,                      // Protocol code: must be 0 according to CDC 1.20 spec
+    USB_EP0_PACKET_SIZE,    // Max packet size for Endpoint 0
+    USB_VENDOR_ID_POLOLU,   // Vendor ID
+    0x2200,                 // Product ID (Generic Wixel with one CDC ACM port)
+    0x0000,                 // Device release number in BCD format
+    1,                      // Index of Manufacturer String Descriptor
+    2,                      // Index of Product String Descriptor
+    3,                      // Index of Serial Number String Descriptor
+    1                       // Number of possible configurations.
+};
+
+CODE struct CONFIG1 {
+    struct USB_DESCRIPTOR_CONFIGURATION configuration;
+
+    struct USB_DESCRIPTOR_INTERFACE communication_interface;
+    unsigned char class_specific[19];  // CDC-Specific Descriptors
+    struct USB_DESCRIPTOR_ENDPOINT notification_element;
+
+    struct USB_DESCRIPTOR_INTERFACE data_interface;
+    struct USB_DESCRIPTOR_ENDPOINT data_out;
+    struct USB_DESCRIPTOR_ENDPOINT data_in;
+} usbConfigurationDescriptor
+=
+{
+    {                                                    // Configuration Descriptor
+        sizeof(struct USB_DESCRIPTOR_CONFIGURATION),
+        USB_DESCRIPTOR_TYPE_CONFIGURATION,
+        sizeof(struct CONFIG1),                          // wTotalLength
+        2,                                               // bNumInterfaces
+        1,                                               // bConfigurationValue
+        0,                                               // iConfiguration
+        0xC0,                                            // bmAttributes: self powered (but may use bus power)
+        50,                                              // bMaxPower
+    },
+    {                                                    // Communications Interface: Used for device management.
+        sizeof(struct USB_DESCRIPTOR_INTERFACE),
+        USB_DESCRIPTOR_TYPE_INTERFACE,
+        CDC_CONTROL_INTERFACE_NUMBER,                    // bInterfaceNumber
+        0,                                               // bAlternateSetting
+        1,                                               // bNumEndpoints
+        CDC_CLASS,                                       // bInterfaceClass
+        CDC_SUBCLASS_ACM,                                // bInterfaceSubClass
+        CDC_PROTOCOL_V250,                               // bInterfaceProtocol
+        0                                                // iInterface
+    },
+    {                                                    // Functional Descriptors.
+
+        5,                                               // 5-byte General Descriptor: Header Functional Descriptor
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_HEADER,
+        0x20,0x01,                                       // bcdCDC.  We conform to CDC 1.20.
+
+
+        4,                                               // 4-byte PTSN-Specific Descriptor: Abstract Control Management Functional Descriptor.
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_ABSTRACT_CONTROL_MANAGEMENT,
+        2,                                               // bmCapabilities.  See USBPSTN1.2 Table 4.  We support SetLineCoding,
+                                                         //SetControlLineState, GetLineCoding, and SerialState notifications.
+
+        5,                                               // 5-byte General Descriptor: Union Interface Functional Descriptor (CDC 1.20 Table 16).
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_UNION,
+        CDC_CONTROL_INTERFACE_NUMBER,                    // index of the control interface
+        CDC_DATA_INTERFACE_NUMBER,                       // index of the subordinate interface
+
+        5,                                               // 5-byte PTSN-Specific Descriptor
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_CALL_MANAGEMENT,
+        0x00,                                            // bmCapabilities.  USBPSTN1.2 Table 3.  Device does not handle call management.
+        CDC_DATA_INTERFACE_NUMBER                        // index of the data interface
+    },
+    {
+        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_IN | CDC_NOTIFICATION_ENDPOINT,  // bEndpointAddress
+        USB_TRANSFER_TYPE_INTERRUPT,                     // bmAttributes
+        10,                                              // wMaxPacketSize
+        1,                                               // bInterval
+    },
+    {
+        sizeof(struct USB_DESCRIPTOR_INTERFACE),         // Data Interface: used for RX and TX data.
+        USB_DESCRIPTOR_TYPE_INTERFACE,
+        CDC_DATA_INTERFACE_NUMBER,                       // bInterfaceNumber
+        0,                                               // bAlternateSetting
+        2,                                               // bNumEndpoints
+        CDC_DATA_INTERFACE_CLASS,                        // bInterfaceClass
+        0,                                               // bInterfaceSubClass
+        0,                                               // bInterfaceProtocol
+        0                                                // iInterface
+    },
+    {                                                    // OUT Endpoint: Sends data out to Wixel.
+        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_OUT | CDC_DATA_ENDPOINT,    // bEndpointAddress
+        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
+        CDC_OUT_PACKET_SIZE,                             // wMaxPacketSize
+        0,                                               // bInterval
+    },
+    {
+        sizeof(struct USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_IN | CDC_DATA_ENDPOINT,     // bEndpointAddress
+        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
+        CDC_IN_PACKET_SIZE,                              // wMaxPacketSize
+        0,                                               // bInterval
+    },
+};
+
+uint8 CODE usbStringDescriptorCount = 4;
+DEFINE_STRING_DESCRIPTOR(languages, 1, USB_LANGUAGE_EN_US)
+DEFINE_STRING_DESCRIPTOR(manufacturer, 18, 'P','o','l','o','l','u',' ','C','o','r','p','o','r','a','t','i','o','n')
+DEFINE_STRING_DESCRIPTOR(product, 5, 'W','i','x','e','l')
+uint16 CODE * CODE usbStringDescriptors[] = { languages, manufacturer, product, serialNumberStringDescriptor };
+
+/* CDC ACM USB callbacks ******************************************************/
+// These functions are called by the low-level USB module (usb.c) when a USB
+// event happens that requires higher-level code to make a decision.
+
+void usbCallbackInitEndpoints()
+{
+    usbComInitEndpoints();
+}
+
+void usbCallbackSetupHandler()
+{
+    usbComSetupHandler();
+}
+
+void usbCallbackClassDescriptorHandler(void)
+{
+    // Not used by CDC ACM
+}
+
+void usbCallbackControlWriteHandler()
+{
+    usbComControlWriteHandler();
+}
@@ -0,0 +1,265 @@
+/* usb_cdc_hid.c:
+ *  The USB descriptors and callbacks for a composite device with a virtual
+ *  COM port (the CDC ACM functions in usb_cdc_acm.c) and an HID joystick.
+ *  See usb_cdc_hid.h for information on how to use this library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <usb.h>
+#include <usb_cdc_hid.h>
+#include <usb_cdc_constants.h>
+#include <board.h>           // just for serialNumberStringDescriptor
+
+/* Composite Device Configuration *********************************************/
+// The CDC ACM interfaces and endpoints are defined in usb_cdc_constants.h,
+// and the joystick's are defined in usb_hid_constants.h.  The joystick
+// itself (report descriptor, report, and request handlers) is in
+// usb_hid_joystick.c in the HID library.
+
+#if HID_JOYSTICK_ENDPOINT == CDC_NOTIFICATION_ENDPOINT || HID_JOYSTICK_ENDPOINT == CDC_DATA_ENDPOINT
+#error "The joystick endpoint must not be one of the CDC ACM endpoints."
+#endif
+
+#if HID_JOYSTICK_INTERFACE_NUMBER == CDC_CONTROL_INTERFACE_NUMBER || HID_JOYSTICK_INTERFACE_NUMBER == CDC_DATA_INTERFACE_NUMBER
+#error "The joystick interface number must not be one of the CDC ACM interface numbers."
+#endif
+
+// Device class codes for a device with Interface Association Descriptors, from
+// the USB Interface Association Descriptor Device Class Code and Use Model.
+#define USB_CLASS_MISCELLANEOUS       0xEF
+#define USB_SUBCLASS_COMMON           2
+#define USB_PROTOCOL_IAD              1
+
+/* Composite USB Descriptors **************************************************/
+
+USB_DESCRIPTOR_DEVICE CODE usbDeviceDescriptor =
+{
+    sizeof(USB_DESCRIPTOR_DEVICE),
+    USB_DESCRIPTOR_TYPE_DEVICE,
+    0x0200,                 // USB Spec Release Number in BCD format
+    USB_CLASS_MISCELLANEOUS,// Class Code: Miscellaneous (required for IAD)
+    USB_SUBCLASS_COMMON,    // Subclass code: Common Class
+    USB_PROTOCOL_IAD,       // Protocol code: Interface Association Descriptor
+    USB_EP0_PACKET_SIZE,    // Max packet size for Endpoint 0
+    USB_VENDOR_ID_POLOLU,   // Vendor ID
+    0x2202,                 // Product ID (Wixel with a CDC ACM port and an HID joystick)
+    0x0000,                 // Device release number in BCD format
+    1,                      // Index of Manufacturer String Descriptor
+    2,                      // Index of Product String Descriptor
+    3,                      // Index of Serial Number String Descriptor
+    1                       // Number of possible configurations.
+};
+
+CODE struct CONFIG1 {
+    USB_DESCRIPTOR_CONFIGURATION configuration;
+
+    USB_DESCRIPTOR_INTERFACE_ASSOCIATION cdc_association;
+    USB_DESCRIPTOR_INTERFACE communication_interface;
+    uint8 class_specific[19];  // CDC-Specific Descriptors
+    USB_DESCRIPTOR_ENDPOINT notification_element;
+    USB_DESCRIPTOR_INTERFACE data_interface;
+    USB_DESCRIPTOR_ENDPOINT data_out;
+    USB_DESCRIPTOR_ENDPOINT data_in;
+
+    USB_DESCRIPTOR_INTERFACE joystick_interface;
+    uint8 joystick_hid[9]; // HID Descriptor
+    USB_DESCRIPTOR_ENDPOINT joystick_in;
+} usbConfigurationDescriptor
+=
+{
+    {                                                    // Configuration Descriptor
+        sizeof(USB_DESCRIPTOR_CONFIGURATION),
+        USB_DESCRIPTOR_TYPE_CONFIGURATION,
+        sizeof(struct CONFIG1),                          // wTotalLength
+        3,                                               // bNumInterfaces
+        1,                                               // bConfigurationValue
+        0,                                               // iConfiguration
+        0xC0,                                            // bmAttributes: self powered (but may use bus power)
+        50,                                              // bMaxPower
+    },
+    {                                                    // Interface Association Descriptor: the two CDC ACM interfaces are one function.
+        sizeof(USB_DESCRIPTOR_INTERFACE_ASSOCIATION),
+        USB_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION,
+        CDC_CONTROL_INTERFACE_NUMBER,                    // bFirstInterface
+        2,                                               // bInterfaceCount
+        CDC_CLASS,                                       // bFunctionClass
+        CDC_SUBCLASS_ACM,                                // bFunctionSubClass
+        CDC_PROTOCOL_V250,                               // bFunctionProtocol
+        0                                                // iFunction
+    },
+    {                                                    // Communications Interface: Used for device management.
+        sizeof(USB_DESCRIPTOR_INTERFACE),
+        USB_DESCRIPTOR_TYPE_INTERFACE,
+        CDC_CONTROL_INTERFACE_NUMBER,                    // bInterfaceNumber
+        0,                                               // bAlternateSetting
+        1,                                               // bNumEndpoints
+        CDC_CLASS,                                       // bInterfaceClass
+        CDC_SUBCLASS_ACM,                                // bInterfaceSubClass
+        CDC_PROTOCOL_V250,                               // bInterfaceProtocol
+        0                                                // iInterface
+    },
+    {                                                    // Functional Descriptors (the same as in usb_cdc_acm_device.c).
+
+        5,                                               // 5-byte General Descriptor: Header Functional Descriptor
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_HEADER,
+        0x20,0x01,                                       // bcdCDC.  We conform to CDC 1.20.
+
+        4,                                               // 4-byte PTSN-Specific Descriptor: Abstract Control Management Functional Descriptor.
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_ABSTRACT_CONTROL_MANAGEMENT,
+        2,                                               // bmCapabilities.  See USBPSTN1.2 Table 4.
+
+        5,                                               // 5-byte General Descriptor: Union Interface Functional Descriptor (CDC 1.20 Table 16).
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_UNION,
+        CDC_CONTROL_INTERFACE_NUMBER,                    // index of the control interface
+        CDC_DATA_INTERFACE_NUMBER,                       // index of the subordinate interface
+
+        5,                                               // 5-byte PTSN-Specific Descriptor
+        CDC_DESCRIPTOR_TYPE_CS_INTERFACE,
+        CDC_DESCRIPTOR_SUBTYPE_CALL_MANAGEMENT,
+        0x00,                                            // bmCapabilities.  Device does not handle call management.
+        CDC_DATA_INTERFACE_NUMBER                        // index of the data interface
+    },
+    {
+        sizeof(USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_IN | CDC_NOTIFICATION_ENDPOINT,  // bEndpointAddress
+        USB_TRANSFER_TYPE_INTERRUPT,                     // bmAttributes
+        10,                                              // wMaxPacketSize
+        1,                                               // bInterval
+    },
+    {
+        sizeof(USB_DESCRIPTOR_INTERFACE),                // Data Interface: used for RX and TX data.
+        USB_DESCRIPTOR_TYPE_INTERFACE,
+        CDC_DATA_INTERFACE_NUMBER,                       // bInterfaceNumber
+        0,                                               // bAlternateSetting
+        2,                                               // bNumEndpoints
+        CDC_DATA_INTERFACE_CLASS,                        // bInterfaceClass
+        0,                                               // bInterfaceSubClass
+        0,                                               // bInterfaceProtocol
+        0                                                // iInterface
+    },
+    {                                                    // OUT Endpoint: Sends data out to Wixel.
+        sizeof(USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_OUT | CDC_DATA_ENDPOINT,    // bEndpointAddress
+        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
+        CDC_OUT_PACKET_SIZE,                             // wMaxPacketSize
+        0,                                               // bInterval
+    },
+    {
+        sizeof(USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_IN | CDC_DATA_ENDPOINT,     // bEndpointAddress
+        USB_TRANSFER_TYPE_BULK,                          // bmAttributes
+        CDC_IN_PACKET_SIZE,                              // wMaxPacketSize
+        0,                                               // bInterval
+    },
+    {                                                    // Joystick Interface
+        sizeof(USB_DESCRIPTOR_INTERFACE),
+        USB_DESCRIPTOR_TYPE_INTERFACE,
+        HID_JOYSTICK_INTERFACE_NUMBER,                   // bInterfaceNumber
+        0,                                               // bAlternateSetting
+        1,                                               // bNumEndpoints
+        HID_CLASS,                                       // bInterfaceClass
+        0,                                               // bInterfaceSubClass
+        0,                                               // bInterfaceProtocol
+        4                                                // iInterface
+    },
+    {
+        sizeof(usbConfigurationDescriptor.joystick_hid), // 9-byte HID Descriptor for joystick (HID 1.11 Section 6.2.1)
+        HID_DESCRIPTOR_TYPE_HID,
+        0x11, 0x01,                                      // bcdHID.  We conform to HID 1.11.
+        HID_COUNTRY_NOT_LOCALIZED,                       // bCountryCode
+        1,                                               // bNumDescriptors
+        HID_DESCRIPTOR_TYPE_REPORT,                      // bDescriptorType
+        HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE, 0           // wDescriptorLength
+    },
+    {                                                    // Joystick IN Endpoint
+        sizeof(USB_DESCRIPTOR_ENDPOINT),
+        USB_DESCRIPTOR_TYPE_ENDPOINT,
+        USB_ENDPOINT_ADDRESS_IN | HID_JOYSTICK_ENDPOINT, // bEndpointAddress
+        USB_TRANSFER_TYPE_INTERRUPT,                     // bmAttributes
+        HID_IN_JOYSTICK_PACKET_SIZE,                     // wMaxPacketSize
+        1,                                               // bInterval: poll every frame for low latency
+    },
+};
+
+uint8 CODE usbStringDescriptorCount = 5;
+DEFINE_STRING_DESCRIPTOR(languages, 1, USB_LANGUAGE_EN_US)
+DEFINE_STRING_DESCRIPTOR(manufacturer, 18, 'P','o','l','o','l','u',' ','C','o','r','p','o','r','a','t','i','o','n')
+DEFINE_STRING_DESCRIPTOR(product, 5, 'W','i','x','e','l')
+uint16 CODE * CODE usbStringDescriptors[] = { languages, manufacturer, product, serialNumberStringDescriptor, usbHidJoystickStringDescriptor };
+
+/* Composite USB callbacks ****************************************************/
+// These functions are called by the low-level USB module (usb.c) when a USB
+// event happens that requires higher-level code to make a decision.  Requests
+// are sent to the function that owns the interface in wIndex; requests for
+// any other interface are stalled.
+
+void usbCallbackInitEndpoints(void)
+{
+    usbComInitEndpoints();
+    usbHidJoystickInitEndpoints();
+}
+
+void usbCallbackSetupHandler(void)
+{
+    if ((usbSetupPacket.bmRequestType & 0x1F) != USB_RECIPIENT_INTERFACE)
+        return;
+
+    switch ((uint8)usbSetupPacket.wIndex)
+    {
+    case CDC_CONTROL_INTERFACE_NUMBER:
+    case CDC_DATA_INTERFACE_NUMBER:
+        usbComSetupHandler();
+        return;
+
+    case HID_JOYSTICK_INTERFACE_NUMBER:
+        usbHidJoystickSetupHandler();
+        return;
+    }
+}
+
+void usbCallbackClassDescriptorHandler(void)
+{
+    // Require Direction==Device-to-Host, Type==Standard, and Recipient==Interface. (HID 1.11 Section 7.1.1)
+    if (usbSetupPacket.bmRequestType != 0x81)
+        return;
+
+    // Only the joystick interface has class descriptors.
+    if (usbSetupPacket.wIndex == HID_JOYSTICK_INTERFACE_NUMBER)
+    {
+        usbHidJoystickClassDescriptorHandler((uint8 XDATA *)&usbConfigurationDescriptor.joystick_hid);
+    }
+}
+
+void usbCallbackControlWriteHandler(void)
+{
+    // Only the CDC ACM interfaces use control writes (SET_LINE_CODING).
+    switch ((uint8)usbSetupPacket.wIndex)
+    {
+    case CDC_CONTROL_INTERFACE_NUMBER:
+    case CDC_DATA_INTERFACE_NUMBER:
+        usbComControlWriteHandler();
+        return;
+    }
+}
+
+/* Other Functions ************************************************************/
+
+void usbCdcHidService(void)
+{
+    usbComService();   // This calls usbPoll().
+
+    if (usbDeviceState != USB_STATE_CONFIGURED)
+    {
+        // We have not reached the Configured state yet, so we should not be touching the non-zero endpoints.
+        return;
+    }
+
+    usbHidJoystickService();
+}
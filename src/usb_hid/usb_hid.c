@@ -11,11 +11,9 @@
 
 #define HID_IN_KEYBOARD_PACKET_SIZE   8
 #define HID_IN_MOUSE_PACKET_SIZE      4
-#define HID_IN_JOYSTICK_PACKET_SIZE   20
 
 #define HID_KEYBOARD_INTERFACE_NUMBER 0
 #define HID_MOUSE_INTERFACE_NUMBER    1
-#define HID_JOYSTICK_INTERFACE_NUMBER 2
 
 #define HID_KEYBOARD_ENDPOINT         1
 #define HID_KEYBOARD_FIFO             USBF1   // This must match HID_KEYBOARD_ENDPOINT!
@@ -23,90 +21,8 @@
 #define HID_MOUSE_ENDPOINT            2
 #define HID_MOUSE_FIFO                USBF2   // This must match HID_MOUSE_ENDPOINT!
 
-#define HID_JOYSTICK_ENDPOINT         3
-#define HID_JOYSTICK_FIFO             USBF3   // This must match HID_JOYSTICK_ENDPOINT!
-
-/* HID Constants **************************************************************/
-
-// USB Class Code from HID 1.11 Section 4.1: The HID Class
-#define HID_CLASS    3
-
-// USB Subclass Code from HID 1.11 Section 4.2: Subclass
-#define HID_SUBCLASS_BOOT 1
-
-// USB Protocol Codes from HID 1.11 Section 4.3: Protocols
-#define HID_PROTOCOL_KEYBOARD 1
-#define HID_PROTOCOL_MOUSE    2
-
-// USB Descriptor types from HID 1.11 Section 7.1
-#define HID_DESCRIPTOR_TYPE_HID    0x21
-#define HID_DESCRIPTOR_TYPE_REPORT 0x22
-
-// Country Codes from HID 1.11 Section 6.2.1
-#define HID_COUNTRY_NOT_LOCALIZED 0
-
-// HID Report Items from HID 1.11 Section 6.2.2
-#define HID_USAGE_PAGE      0x05
-#define HID_USAGE           0x09
-#define HID_COLLECTION      0xA1
-#define HID_END_COLLECTION  0xC0
-#define HID_REPORT_COUNT    0x95
-#define HID_REPORT_SIZE     0x75
-#define HID_USAGE_MIN       0x19
-#define HID_USAGE_MAX       0x29
-#define HID_LOGICAL_MIN     0x15
-#define HID_LOGICAL_MIN_2   0x16 // 2-byte data
-#define HID_LOGICAL_MAX     0x25
-#define HID_LOGICAL_MAX_2   0x26 // 2-byte data
-#define HID_INPUT           0x81
-#define HID_OUTPUT          0x91
-
-// HID Report Usage Pages from HID Usage Tables 1.12 Section 3, Table 1
-#define HID_USAGE_PAGE_GENERIC_DESKTOP 0x01
-#define HID_USAGE_PAGE_KEY_CODES       0x07
-#define HID_USAGE_PAGE_LEDS            0x08
-#define HID_USAGE_PAGE_BUTTONS         0x09
-
-// HID Report Usages from HID Usage Tables 1.12 Section 4, Table 6
-#define HID_USAGE_POINTER  0x01
-#define HID_USAGE_MOUSE    0x02
-#define HID_USAGE_JOYSTICK 0x04
-#define HID_USAGE_KEYBOARD 0x06
-#define HID_USAGE_X        0x30
-#define HID_USAGE_Y        0x31
-#define HID_USAGE_Z        0x32
-#define HID_USAGE_RX       0x33
-#define HID_USAGE_RY       0x34
-#define HID_USAGE_RZ       0x35
-#define HID_USAGE_SLIDER   0x36
-#define HID_USAGE_DIAL     0x37
-#define HID_USAGE_WHEEL    0x38
-
-// HID Report Collection Types from HID 1.12 6.2.2.6
-#define HID_COLLECTION_PHYSICAL    0
-#define HID_COLLECTION_APPLICATION 1
-
-// HID Input/Output/Feature Item Data (attributes) from HID 1.11 6.2.2.5
-#define HID_ITEM_CONSTANT 0x1
-#define HID_ITEM_VARIABLE 0x2
-#define HID_ITEM_RELATIVE 0x4
-
-// Request Codes from HID 1.11 Section 7.2
-#define HID_REQUEST_GET_REPORT   0x1
-#define HID_REQUEST_GET_IDLE     0x2
-#define HID_REQUEST_GET_PROTOCOL 0x3
-#define HID_REQUEST_SET_REPORT   0x9
-#define HID_REQUEST_SET_IDLE     0xA
-#define HID_REQUEST_SET_PROTOCOL 0xB
-
-// Report Types from HID 1.11 Section 7.2.1
-#define HID_REPORT_TYPE_INPUT   1
-#define HID_REPORT_TYPE_OUTPUT  2
-#define HID_REPORT_TYPE_FEATURE 3
-
-// Protocols from HID 1.11 Section 7.2.5
-#define HID_PROTOCOL_BOOT   0
-#define HID_PROTOCOL_REPORT 1
+// The joystick's interface and endpoint (2 and 3) are defined in
+// usb_hid_constants.h because usb_cdc_hid.c uses them too.
 
 /* HID USB Descriptors ****************************************************/
 
@@ -207,46 +123,6 @@ uint8 CODE mouseReportDescriptor[]
     HID_END_COLLECTION,
 };
 
-// joystick report descriptor
-// HID 1.11 Section 6.2.2: Report Descriptor
-uint8 CODE joystickReportDescriptor[]
-=
-{
-    HID_USAGE_PAGE, HID_USAGE_PAGE_GENERIC_DESKTOP,
-    HID_USAGE, HID_USAGE_JOYSTICK,
-    HID_COLLECTION, HID_COLLECTION_APPLICATION,
-
-        HID_USAGE, HID_USAGE_POINTER,
-        HID_COLLECTION, HID_COLLECTION_PHYSICAL,
-
-            HID_REPORT_COUNT, 8, // 8 Axes (X, Y, Z, Rx, Ry, Rz, Slider, Dial)
-            HID_REPORT_SIZE, 16,
-            HID_USAGE, HID_USAGE_X,
-            HID_USAGE, HID_USAGE_Y,
-            HID_USAGE, HID_USAGE_Z,
-            HID_USAGE, HID_USAGE_RX,
-            HID_USAGE, HID_USAGE_RY,
-            HID_USAGE, HID_USAGE_RZ,
-            HID_USAGE, HID_USAGE_SLIDER,
-            HID_USAGE, HID_USAGE_DIAL,
-            HID_LOGICAL_MIN_2, 0x01, 0x80, // -32767
-            HID_LOGICAL_MAX_2, 0xFF, 0x7F, //  32767
-            HID_INPUT, HID_ITEM_VARIABLE,
-
-        HID_END_COLLECTION,
-
-        HID_REPORT_COUNT, 32, // 32 Joystick Buttons
-        HID_REPORT_SIZE, 1,
-        HID_USAGE_PAGE, HID_USAGE_PAGE_BUTTONS,
-        HID_USAGE_MIN, 1,
-        HID_USAGE_MAX, 32,
-        HID_LOGICAL_MIN, 0,
-        HID_LOGICAL_MAX, 1,
-        HID_INPUT, HID_ITEM_VARIABLE,
-
-    HID_END_COLLECTION,
-};
-
 CODE struct CONFIG1 {
     USB_DESCRIPTOR_CONFIGURATION configuration;
 
@@ -348,7 +224,7 @@ CODE struct CONFIG1 {
         HID_COUNTRY_NOT_LOCALIZED,                       // bCountryCode
         1,                                               // bNumDescriptors
         HID_DESCRIPTOR_TYPE_REPORT,                      // bDescriptorType
-        sizeof(joystickReportDescriptor), 0              // wDescriptorLength
+        HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE, 0           // wDescriptorLength
     },
     {                                                    // Joystick IN Endpoint
         sizeof(USB_DESCRIPTOR_ENDPOINT),
@@ -366,19 +242,16 @@ DEFINE_STRING_DESCRIPTOR(manufacturer, 18, 'P','o','l','o','l','u',' ','C','o','
 DEFINE_STRING_DESCRIPTOR(product, 5, 'W','i','x','e','l')
 DEFINE_STRING_DESCRIPTOR(keyboardName, 14, 'W','i','x','e','l',' ','K','e','y','b','o','a','r','d')
 DEFINE_STRING_DESCRIPTOR(mouseName, 11, 'W','i','x','e','l',' ','M','o','u','s','e')
-DEFINE_STRING_DESCRIPTOR(joystickName, 14, 'W','i','x','e','l',' ','J','o','y','s','t','i','c','k')
-uint16 CODE * CODE usbStringDescriptors[] = { languages, manufacturer, product, serialNumberStringDescriptor, keyboardName, mouseName, joystickName };
+uint16 CODE * CODE usbStringDescriptors[] = { languages, manufacturer, product, serialNumberStringDescriptor, keyboardName, mouseName, usbHidJoystickStringDescriptor };
 
 /* HID structs and global variables *******************************************/
 
 HID_KEYBOARD_OUT_REPORT XDATA usbHidKeyboardOutput = {0};
 HID_KEYBOARD_IN_REPORT XDATA usbHidKeyboardInput = {0, 0, {0}};
 HID_MOUSE_IN_REPORT XDATA usbHidMouseInput = {0, 0, 0, 0};
-HID_JOYSTICK_IN_REPORT XDATA usbHidJoystickInput = {0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 BIT usbHidKeyboardInputUpdated = 0;
 BIT usbHidMouseInputUpdated    = 0;
-BIT usbHidJoystickInputUpdated    = 0;
 
 uint16 XDATA hidKeyboardIdleDuration = 500; // 0 to 1020 ms
 
@@ -393,7 +266,7 @@ void usbCallbackInitEndpoints(void)
 {
     usbInitEndpointIn(HID_KEYBOARD_ENDPOINT, HID_IN_KEYBOARD_PACKET_SIZE);
     usbInitEndpointIn(HID_MOUSE_ENDPOINT, HID_IN_MOUSE_PACKET_SIZE);
-    usbInitEndpointIn(HID_JOYSTICK_ENDPOINT, HID_IN_JOYSTICK_PACKET_SIZE);
+    usbHidJoystickInitEndpoints();
 }
 
 // Implements all the control transfers that are required by Appendix G of HID 1.11.
@@ -404,6 +277,12 @@ void usbCallbackSetupHandler(void)
     if ((usbSetupPacket.bmRequestType & 0x7F) != 0x21)   // Require Type==Class and Recipient==Interface.
         return;
 
+    if (usbSetupPacket.wIndex == HID_JOYSTICK_INTERFACE_NUMBER)
+    {
+        usbHidJoystickSetupHandler();
+        return;
+    }
+
     switch(usbSetupPacket.bRequest)
     {
     // required
@@ -420,10 +299,6 @@ void usbCallbackSetupHandler(void)
         case HID_MOUSE_INTERFACE_NUMBER:
             usbControlRead(sizeof(usbHidMouseInput), (uint8 XDATA *)&usbHidMouseInput);
             return;
-
-        case HID_JOYSTICK_INTERFACE_NUMBER:
-            usbControlRead(sizeof(usbHidJoystickInput), (uint8 XDATA *)&usbHidJoystickInput);
-            return;
         }
         // unrecognized interface - stall
         return;
@@ -505,6 +380,12 @@ void usbCallbackClassDescriptorHandler(void)
         return;
     }
 
+    if (usbSetupPacket.wIndex == HID_JOYSTICK_INTERFACE_NUMBER)
+    {
+        usbHidJoystickClassDescriptorHandler((uint8 XDATA *)&usbConfigurationDescriptor.joystick_hid);
+        return;
+    }
+
     switch (usbSetupPacket.wValue >> 8)
     {
     case HID_DESCRIPTOR_TYPE_HID:
@@ -518,10 +399,6 @@ void usbCallbackClassDescriptorHandler(void)
         case HID_MOUSE_INTERFACE_NUMBER:
             usbControlRead(sizeof(usbConfigurationDescriptor.mouse_hid), (uint8 XDATA *)&usbConfigurationDescriptor.mouse_hid);
             return;
-
-        case HID_JOYSTICK_INTERFACE_NUMBER:
-            usbControlRead(sizeof(usbConfigurationDescriptor.joystick_hid), (uint8 XDATA *)&usbConfigurationDescriptor.joystick_hid);
-            return;
         }
         return;
 
@@ -536,10 +413,6 @@ void usbCallbackClassDescriptorHandler(void)
         case HID_MOUSE_INTERFACE_NUMBER:
             usbControlRead(sizeof(mouseReportDescriptor), (uint8 XDATA *)&mouseReportDescriptor);
             return;
-
-        case HID_JOYSTICK_INTERFACE_NUMBER:
-            usbControlRead(sizeof(joystickReportDescriptor), (uint8 XDATA *)&joystickReportDescriptor);
-            return;
         }
         return;
     }
@@ -582,13 +455,7 @@ void usbHidService(void)
         usbHidMouseInputUpdated = 0; // reset updated flag
     }
 
-    USBINDEX = HID_JOYSTICK_ENDPOINT;
-    // Check if joystick input has been updated.
-    if (usbHidJoystickInputUpdated && !(USBCSIL & USBCSIL_INPKT_RDY)) {
-        usbWriteFifo(HID_JOYSTICK_ENDPOINT, sizeof(usbHidJoystickInput), (uint8 XDATA *)&usbHidJoystickInput);
-        USBCSIL |= USBCSIL_INPKT_RDY;
-        usbHidJoystickInputUpdated = 0; // reset updated flag
-    }
+    usbHidJoystickService();
 }
 
 // Look-up table stored in code memory that we use to convert from ASCII
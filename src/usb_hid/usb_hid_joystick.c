@@ -0,0 +1,124 @@
+/* usb_hid_joystick.c:
+ *  The HID joystick function: its report descriptor, string descriptor,
+ *  report, and request handlers.  The USB descriptors and callbacks that
+ *  use these are in usb_hid.c (keyboard, mouse, and joystick) and
+ *  usb_cdc_hid.c (virtual COM port and joystick).
+ *
+ *  These are in a separate file so that usb_cdc_hid.lib can use the joystick
+ *  without linking in the rest of the HID library.
+ */
+
+#include <cc2511_map.h>
+#include <cc2511_types.h>
+#include <usb.h>
+#include <usb_hid.h>
+
+/* HID Joystick Descriptors ***************************************************/
+
+// joystick report descriptor
+// HID 1.11 Section 6.2.2: Report Descriptor
+uint8 CODE usbHidJoystickReportDescriptor[]
+=
+{
+    HID_USAGE_PAGE, HID_USAGE_PAGE_GENERIC_DESKTOP,
+    HID_USAGE, HID_USAGE_JOYSTICK,
+    HID_COLLECTION, HID_COLLECTION_APPLICATION,
+
+        HID_USAGE, HID_USAGE_POINTER,
+        HID_COLLECTION, HID_COLLECTION_PHYSICAL,
+
+            HID_REPORT_COUNT, 8, // 8 Axes (X, Y, Z, Rx, Ry, Rz, Slider, Dial)
+            HID_REPORT_SIZE, 16,
+            HID_USAGE, HID_USAGE_X,
+            HID_USAGE, HID_USAGE_Y,
+            HID_USAGE, HID_USAGE_Z,
+            HID_USAGE, HID_USAGE_RX,
+            HID_USAGE, HID_USAGE_RY,
+            HID_USAGE, HID_USAGE_RZ,
+            HID_USAGE, HID_USAGE_SLIDER,
+            HID_USAGE, HID_USAGE_DIAL,
+            HID_LOGICAL_MIN_2, 0x01, 0x80, // -32767
+            HID_LOGICAL_MAX_2, 0xFF, 0x7F, //  32767
+            HID_INPUT, HID_ITEM_VARIABLE,
+
+        HID_END_COLLECTION,
+
+        HID_REPORT_COUNT, 32, // 32 Joystick Buttons
+        HID_REPORT_SIZE, 1,
+        HID_USAGE_PAGE, HID_USAGE_PAGE_BUTTONS,
+        HID_USAGE_MIN, 1,
+        HID_USAGE_MAX, 32,
+        HID_LOGICAL_MIN, 0,
+        HID_LOGICAL_MAX, 1,
+        HID_INPUT, HID_ITEM_VARIABLE,
+
+    HID_END_COLLECTION,
+};
+
+// The HID descriptors in usb_hid.c and usb_cdc_hid.c use
+// HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE, so this fails to compile if that is wrong.
+typedef char joystickReportDescriptorSizeCheck[(sizeof(usbHidJoystickReportDescriptor) == HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE) ? 1 : -1];
+
+uint16 CODE usbHidJoystickStringDescriptor[] = { (2*(14+1)) | (USB_DESCRIPTOR_TYPE_STRING<<8),
+    'W','i','x','e','l',' ','J','o','y','s','t','i','c','k' };
+
+/* HID Joystick Variables *****************************************************/
+
+HID_JOYSTICK_IN_REPORT XDATA usbHidJoystickInput = {0, 0, 0, 0, 0, 0, 0, 0, 0};
+
+BIT usbHidJoystickInputUpdated = 0;
+
+/* HID Joystick Functions *****************************************************/
+
+void usbHidJoystickInitEndpoints(void)
+{
+    usbInitEndpointIn(HID_JOYSTICK_ENDPOINT, HID_IN_JOYSTICK_PACKET_SIZE);
+}
+
+// Implements the control transfers that are required by Appendix G of HID 1.11
+// for the joystick interface.
+void usbHidJoystickSetupHandler(void)
+{
+    if ((usbSetupPacket.bmRequestType & 0x7F) != 0x21)   // Require Type==Class and Recipient==Interface.
+        return;
+
+    switch(usbSetupPacket.bRequest)
+    {
+    case HID_REQUEST_GET_REPORT:
+        if ((usbSetupPacket.wValue >> 8) == HID_REPORT_TYPE_INPUT)
+        {
+            usbControlRead(sizeof(usbHidJoystickInput), (uint8 XDATA *)&usbHidJoystickInput);
+        }
+        return;
+
+    default:
+        // unrecognized request - stall
+        return;
+    }
+}
+
+void usbHidJoystickClassDescriptorHandler(uint8 XDATA * hidDescriptor)
+{
+    switch (usbSetupPacket.wValue >> 8)
+    {
+    case HID_DESCRIPTOR_TYPE_HID:
+        usbControlRead(9, hidDescriptor);
+        return;
+
+    case HID_DESCRIPTOR_TYPE_REPORT:
+        usbControlRead(sizeof(usbHidJoystickReportDescriptor), (uint8 XDATA *)&usbHidJoystickReportDescriptor);
+        return;
+    }
+}
+
+void usbHidJoystickService(void)
+{
+    USBINDEX = HID_JOYSTICK_ENDPOINT;
+    // Check if joystick input has been updated.
+    if (usbHidJoystickInputUpdated && !(USBCSIL & USBCSIL_INPKT_RDY))
+    {
+        usbWriteFifo(HID_JOYSTICK_ENDPOINT, sizeof(usbHidJoystickInput), (uint8 XDATA *)&usbHidJoystickInput);
+        USBCSIL |= USBCSIL_INPKT_RDY;
+        usbHidJoystickInputUpdated = 0; // reset updated flag
+    }
+}
@@ -59,6 +59,9 @@ void boardClockInit()
     //    This is required for using the Forward Error Correction radio feature (which we don't use anymore).
     CLKCON = 0x80;
 
+    // Keep Timer 4 overflowing every millisecond at the new tick speed.
+    timeUpdateTickSpeed();
+
     // Power down the HS RCOSC (the one that is not currently selected by
     // CLKCON.OSC).
     SLEEP |= 0x04;
@@ -6,6 +6,71 @@
 
 #include <sleep.h>
 #include <board.h>
+#include <time.h>
+
+// The millisecond counter maintained by the T4 ISR in time.c.  Timer 4 is
+// stopped in PM1, PM2 and PM3, so the functions below measure the time spent
+// in PM1 and PM2 with the Sleep Timer and add it.
+extern PDATA volatile uint32 timeMs;
+
+// sleepUntil() only uses PM1 or PM2 if there is enough time left for the
+// mode to be worth it, and it wakes up a little early to allow for the time
+// it takes to start the crystal oscillator and for the inaccuracy of the
+// 32 kHz RC oscillator.  The rest of the time is spent in PM0.
+#define PM1_MIN_MS      4
+#define PM1_WAKE_MS     1
+#define PM2_MIN_MS      20
+#define PM2_WAKE_MS     2
+
+// The longest time sleepTimed() can sleep: 0xFFFF units of EVENT0 at the
+// coarsest resolution (2^15 periods of the 32 kHz clock, 1 s), about 18 h.
+// Longer times would also overflow the conversion to 32 kHz periods.
+#define MAX_SLEEP_MS    65535000UL
+
+// MARCSTATE values in which the radio is not doing anything.
+#define MARCSTATE_SLEEP 0x00
+#define MARCSTATE_IDLE  0x01
+
+uint8 sleepMaxPowerMode = 2;
+
+uint8 sleepFastWake = 0;
+
+// Statistics about the time spent awake between sleeps (see sleepWakeCount()).
+// wakeState is 0 before the first sleep, 1 while running on the HS RCOSC
+// after waking up, and 2 once sleepCrystalStart() has started the crystal.
+static uint8 XDATA wakeState = 0;
+static uint32 XDATA wakeTime;
+static uint32 XDATA crystalStartTime;
+static uint32 XDATA crystalReadyTime;
+static uint32 XDATA wakeCount = 0;
+static uint32 XDATA wakeRcUs = 0;
+static uint32 XDATA wakeCrystalStartUs = 0;
+static uint32 XDATA wakeCrystalUs = 0;
+
+// Residency statistics (see sleepResidencyMs()), indexed by SLEEP_STATE_*.
+// The active time is not stored; it is whatever is left over.  The time in
+// PM0 is not stored in residencyMs either: sleepIdle() runs very often, so
+// it adds to a 40-bit number of microseconds instead, which needs no
+// division (like the residency statistics in radio_mac.c).
+static uint32 XDATA residencyMs[SLEEP_STATE_COUNT];
+static uint32 XDATA residencyCount[SLEEP_STATE_COUNT];
+static uint32 XDATA residencyStartMs = 0;
+static uint32 XDATA idleUs = 0;
+static uint8 XDATA idleUsHigh = 0;
+
+static void addResidency(uint8 state, uint32 ms)
+{
+   residencyMs[state] += ms;
+   residencyCount[state]++;
+}
+
+// Set by the ST ISR so we can tell whether we woke up because of EVENT0 or
+// because of some other interrupt.
+static volatile BIT sleepTimerEventFlag;
+
+// The fraction of a millisecond that has been slept but not yet added to
+// timeMs, in units of 1/4096 ms.
+static uint16 sleepFraction = 0;
 
 // Initialization of source buffers and DMA descriptor for the DMA transfer
 unsigned char XDATA PM2_BUF[7] = {0x06,0x06,0x06,0x06,0x06,0x06,0x04};
@@ -26,6 +91,8 @@ ISR(ST, 1)
    WORIRQ &= 0xFE;
    
    SLEEP &= 0xFC; // Not required when resuming from PM0; Clear SLEEP.MODE[1:0]
+
+   sleepTimerEventFlag = 1;
 }
 
 void switchToRCOSC(void)
@@ -43,26 +110,143 @@ void switchToRCOSC(void)
    SLEEP |= 0x04;
 }
 
-void sleepMode1(uint16 seconds)
+// Called just before going to sleep.  Adds the time since the last wake-up
+// to the statistics.
+static void wakeEnd(void)
+{
+   uint32 now = getUs();
+
+   if (wakeState == 1)
+   {
+      wakeRcUs += now - wakeTime;
+   }
+   else if (wakeState == 2)
+   {
+      wakeRcUs += crystalStartTime - wakeTime;
+      wakeCrystalStartUs += crystalReadyTime - crystalStartTime;
+      wakeCrystalUs += now - crystalReadyTime;
+   }
+
+   if (wakeState)
+   {
+      wakeCount++;
+   }
+   wakeState = 0;
+}
+
+// Called right after waking up.  The processor wakes up running on the
+// HS RCOSC; make it run at full speed (12 MHz) and slow the timer ticks down
+// to match, so that Timer 4 keeps counting milliseconds.
+static void wakeClock(void)
+{
+   // OSC32K=1, OSC=1 (HS RCOSC), TICKSPD=001 (12 MHz), CLKSPD=001 (12 MHz)
+   CLKCON = 0xC9;
+   while(!(CLKCON & 0x40));
+   timeUpdateTickSpeed();
+
+   // Enable pre-fetching of instructions from flash again.
+   MEMCTR = 0;
+}
+
+// Called after waking up once the time slept has been added to timeMs.
+static void wakeStart(void)
+{
+   wakeTime = getUs();
+   wakeState = 1;
+
+   if (!sleepFastWake)
+   {
+      sleepCrystalStart();
+   }
+}
+
+void sleepCrystalStart(void)
+{
+   uint32 start;
+
+   if (!(CLKCON & 0x40))
+   {
+      return;  // Already running on the crystal.
+   }
+
+   start = getUs();
+   boardClockInit();
+
+   if (wakeState == 1)
+   {
+      crystalStartTime = start;
+      crystalReadyTime = getUs();
+      wakeState = 2;
+   }
+}
+
+// Sets the Sleep Timer resolution (WOR_RES, 0-3), resets the timer, and sets
+// EVENT0.  One unit of EVENT0 is 2^(5*WOR_RES) periods of the 32 kHz clock.
+static void startSleepTimer(uint8 resolution, uint16 event0)
 {
    unsigned char temp;
-   unsigned short desired_event0;
 
-   desired_event0 = seconds;
+   WORCTRL = (WORCTRL & ~0x03) | resolution; // WOR_RES[1:0]
 
-   // set Sleep Timer to the lowest resolution (1 second)      
-   WORCTRL |= 0x03; // WOR_RES[1:0]
-   // make sure interrupts aren't completely disabled
-   // and enable sleep timer interrupt
-   IEN0 |= 0xA0; // Set EA and STIE bits
-       
    WORCTRL |= 0x04; // Reset Sleep Timer; WOR_RESET
    temp = WORTIME0;
    while(temp == WORTIME0); // Wait until a positive 32 kHz edge
    temp = WORTIME0;
    while(temp == WORTIME0); // Wait until a positive 32 kHz edge
-   WOREVT1 = desired_event0 >> 8; // Set EVENT0, high byte
-   WOREVT0 = desired_event0; // Set EVENT0, low byte
+   WOREVT1 = event0 >> 8; // Set EVENT0, high byte
+   WOREVT0 = event0; // Set EVENT0, low byte
+
+   sleepTimerEventFlag = 0;
+}
+
+// Returns the number of periods of the 32 kHz clock since startSleepTimer().
+// The timer starts again from 0 when it reaches EVENT0, so if the EVENT0
+// interrupt happened we add EVENT0.
+static uint32 sleepTimerElapsed(uint8 resolution, uint16 event0)
+{
+   uint16 time = WORTIME0;            // Reading WORTIME0 latches WORTIME1.
+   uint32 units;
+
+   time |= (uint16)WORTIME1 << 8;
+   units = time;
+   if (sleepTimerEventFlag)
+   {
+      units += event0;
+   }
+   return units << (5 * resolution);
+}
+
+// Adds the specified number of 32 kHz periods to timeMs, keeping track of
+// the fractions of a millisecond so that no time is lost over many sleeps.
+// 1 period = 1000/32768 ms = 125/4096 ms.
+static uint32 addSleepTime(uint32 periods)
+{
+   uint32 fraction = (uint32)((uint16)periods & 0x7FFF) * 125 + sleepFraction;
+   uint32 ms = (periods >> 15) * 1000 + (fraction >> 12);
+   BIT oldT4IE = T4IE;
+
+   sleepFraction = (uint16)fraction & 0x0FFF;
+
+   T4IE = 0;
+   timeMs += ms;
+   T4IE = oldT4IE;
+
+   return ms;
+}
+
+static void sleepPm1(uint8 resolution, uint16 event0)
+{
+   wakeEnd();
+
+   // The crystal oscillator stops in PM1; run from the HS RCOSC so that
+   // the processor starts right away when it wakes up.
+   switchToRCOSC();
+
+   startSleepTimer(resolution, event0);
+
+   // make sure interrupts aren't completely disabled
+   // and enable sleep timer interrupt
+   IEN0 |= 0xA0; // Set EA and STIE bits
   
    // Set SLEEP.MODE according to PM1
    SLEEP = (SLEEP & 0xFC) | 0x01; // SLEEP.MODE[1:0]
@@ -94,23 +278,17 @@ void sleepMode1(uint16 seconds)
       __asm nop __endasm;    
    }
    
-   // Switch back to high speed      
-   boardClockInit(); 
+   wakeClock();
 }
 
-void sleepMode2(uint16 seconds)
+static void sleepPm2(uint8 resolution, uint16 event0)
 {
-   unsigned char temp;
-   unsigned short desired_event0;
-   
    unsigned char storedDescHigh, storedDescLow;
-   BIT	storedDma0Armed;
+   unsigned char storedDmaArmed;
    unsigned char storedIEN0, storedIEN1, storedIEN2;
    
-   desired_event0 = seconds;
-   
-   // set Sleep Timer to the lowest resolution (1 second)      
-   WORCTRL |= 0x03; 
+   wakeEnd();
+
    // must be using RC OSC before going to PM2
    switchToRCOSC();
    
@@ -120,18 +298,19 @@ void sleepMode2(uint16 seconds)
    // processor from waking up correctly (appears to hang)
    
    // Store current DMA channel 0 descriptor and abort any ongoing transfers,
-   // if the channel is in use.
+   // if the channel is in use.  Also store which of the other channels are
+   // armed, so they can all be armed again after waking up.
    storedDescHigh = DMA0CFGH;
    storedDescLow = DMA0CFGL;
-   storedDma0Armed = DMAARM & 0x01;
-   DMAARM |= 0x81; // Abort transfers on DMA Channel 0; Set ABORT and DMAARM0
+   storedDmaArmed = DMAARM & 0x1F;
+   DMAARM = 0x81; // Abort transfers on DMA Channel 0; Set ABORT and DMAARM0
    // Update descriptor with correct source.
    dmaDesc[0] = ((unsigned int)& PM2_BUF) >> 8;
    dmaDesc[1] = (unsigned int)& PM2_BUF;
    // Associate the descriptor with DMA channel 0 and arm the DMA channel
    DMA0CFGH = ((unsigned int)&dmaDesc) >> 8;
    DMA0CFGL = (unsigned int)&dmaDesc;
-   DMAARM = 0x01; // Arm Channel 0; DMAARM0
+   DMAARM |= 0x01; // Arm Channel 0; DMAARM0
    
    // save enabled interrupts
    storedIEN0 = IEN0;
@@ -147,13 +326,7 @@ void sleepMode2(uint16 seconds)
    IEN1 &= ~0x3F;
    IEN2 &= ~0x3F;
           
-   WORCTRL |= 0x04; // Reset Sleep Timer
-   temp = WORTIME0;
-   while(temp == WORTIME0); // Wait until a positive 32 kHz edge
-   temp = WORTIME0;
-   while(temp == WORTIME0); // Wait until a positive 32 kHz edge
-   WOREVT1 = desired_event0 >> 8; // Set EVENT0, high byte
-   WOREVT0 = desired_event0; // Set EVENT0, low byte
+   startSleepTimer(resolution, event0);
   
    MEMCTR |= 0x02;  // Flash cache must be disabled.
    SLEEP = 0x06; // PM2, disable USB, power down other oscillators
@@ -178,19 +351,19 @@ void sleepMode2(uint16 seconds)
    // restore DMA descriptor
    DMA0CFGH = storedDescHigh;
    DMA0CFGL = storedDescLow;
-   if (storedDma0Armed)
-	   DMAARM |= 0x01; // Set DMA0ARM
+   DMAARM = storedDmaArmed; // Arm the channels that were armed before
    
-   // Switch back to high speed
-   boardClockInit();   
+   wakeClock();
 }
 
 
 void sleepMode3(void)
 {  
    unsigned char storedDescHigh, storedDescLow;
-   BIT	storedDma0Armed;
+   unsigned char storedDmaArmed;
    
+   wakeEnd();
+
    // set Sleep Timer to the lowest resolution (1 second)      
    WORCTRL |= 0x03; 
    // must be using RC OSC before going to PM3
@@ -202,18 +375,19 @@ void sleepMode3(void)
    // processor from waking up correctly (appears to hang)
    
    // Store current DMA channel 0 descriptor and abort any ongoing transfers,
-   // if the channel is in use.
+   // if the channel is in use.  Also store which of the other channels are
+   // armed, so they can all be armed again after waking up.
    storedDescHigh = DMA0CFGH;
    storedDescLow = DMA0CFGL;
-   storedDma0Armed = DMAARM & 0x01;
-   DMAARM |= 0x81; // Abort transfers on DMA Channel 0; Set ABORT and DMAARM0
+   storedDmaArmed = DMAARM & 0x1F;
+   DMAARM = 0x81; // Abort transfers on DMA Channel 0; Set ABORT and DMAARM0
    // Update descriptor with correct source.
    dmaDesc[0] = ((unsigned int)& PM3_BUF) >> 8;
    dmaDesc[1] = (unsigned int)& PM3_BUF;
    // Associate the descriptor with DMA channel 0 and arm the DMA channel
    DMA0CFGH = ((unsigned int)&dmaDesc) >> 8;
    DMA0CFGL = (unsigned int)&dmaDesc;
-   DMAARM = 0x01; // Arm Channel 0; DMAARM0
+   DMAARM |= 0x01; // Arm Channel 0; DMAARM0
    
    // make sure interrupts aren't completely disabled
    IEN0 |= (1<<7);
@@ -236,10 +410,307 @@ void sleepMode3(void)
    // restore DMA descriptor
    DMA0CFGH = storedDescHigh;
    DMA0CFGL = storedDescLow;
-   if (storedDma0Armed)
-	   DMAARM |= 0x01; // Set DMA0ARM
+   DMAARM = storedDmaArmed; // Arm the channels that were armed before
+
+   wakeClock();
+
+   // The Sleep Timer does not run in PM3, so we can only count how many
+   // times we were there.
+   addResidency(SLEEP_STATE_PM3, 0);
+   wakeStart();
+}
+
+// Sleeps in PM1 or PM2 for at most the specified number of milliseconds,
+// choosing the finest Sleep Timer resolution that can represent it, and
+// adds the time actually slept to timeMs.  If an interrupt wakes the
+// processor up early, the time is still right to within one unit of EVENT0,
+// which is less than 1 ms for sleeps shorter than 64 seconds.
+// Returns 1 if it slept.  The processor is still running on the HS RCOSC
+// then, and the caller must call wakeStart() once it is done sleeping.
+static BIT sleepTimed(uint8 mode, uint32 ms)
+{
+   uint32 periods;
+   uint8 resolution;
+
+   // Convert to 32 kHz periods, rounding down: ms * 32768 / 1000.
+   if (ms > MAX_SLEEP_MS)
+   {
+      ms = MAX_SLEEP_MS;
+   }
+   periods = (ms / 125) * 4096 + (ms % 125) * 4096 / 125;
+
+   // WOR_RES = 0, 1, 2, 3 gives units of 1, 32, 1024, 32768 periods, so
+   // EVENT0 (16 bits) covers up to 2 s, 64 s, 34 min, or 18 h.
+   for (resolution = 0; resolution < 3 && (periods >> (5 * resolution)) > 0xFFFF; resolution++){}
+   periods >>= 5 * resolution;
+   if (periods > 0xFFFF)
+   {
+      periods = 0xFFFF;
+   }
+   if (periods == 0)
+   {
+      return 0;
+   }
 
-   // Switch back to high speed
-   boardClockInit();    
+   if (mode == 2)
+   {
+      sleepPm2(resolution, (uint16)periods);
+   }
+   else
+   {
+      sleepPm1(resolution, (uint16)periods);
+   }
+
+   addResidency(mode == 2 ? SLEEP_STATE_PM2 : SLEEP_STATE_PM1,
+      addSleepTime(sleepTimerElapsed(resolution, (uint16)periods)));
+   return 1;
+}
+
+void sleepMode1(uint16 seconds)
+{
+   if (sleepTimed(1, (uint32)seconds * 1000))
+   {
+      wakeStart();
+   }
+}
+
+void sleepMode2(uint16 seconds)
+{
+   if (sleepTimed(2, (uint32)seconds * 1000))
+   {
+      wakeStart();
+   }
+}
+
+// Returns the deepest power mode that sleepUntil() can use right now: the
+// smaller of sleepMaxPowerMode and what the hardware allows.  PM1 and PM2
+// stop the crystal oscillator and the clocks of the peripherals, so they are
+// not used while USB power is present (the USB module would stop), while the
+// radio is doing anything (e.g. radio_mac keeping it in RX), while a DMA
+// channel is armed (e.g. adc_stream or a radio transfer), or while a UART
+// is receiving or transmitting.
+static uint8 sleepAllowedPowerMode(void)
+{
+   if (sleepMaxPowerMode == 0 || usbPowerPresent())
+   {
+      return 0;
+   }
+
+   if ((MARCSTATE != MARCSTATE_IDLE && MARCSTATE != MARCSTATE_SLEEP)
+      || (DMAARM & 0x1F))
+   {
+      return 0;
+   }
+
+   // UxCSR: MODE (bit 7) = 1 for UART, RE (bit 6) = receiver enabled,
+   // ACTIVE (bit 0) = a byte is being received or transmitted.
+   if ((U0CSR & 0xC0) == 0xC0 || (U0CSR & 0x01)
+      || (U1CSR & 0xC0) == 0xC0 || (U1CSR & 0x01))
+   {
+      return 0;
+   }
+
+   return sleepMaxPowerMode;
+}
+
+void sleepUntil(uint32 deadlineMs)
+{
+   int32 remaining;
+   uint8 mode;
+   BIT slept = 0;
+
+   if (deadlineMs == SLEEP_NO_DEADLINE)
+   {
+      mode = sleepAllowedPowerMode();
+      if (mode == 0)
+      {
+         return;
+      }
+      if (mode >= 3)
+      {
+         // Only an external interrupt can wake us up from PM3.
+         sleepMode3();
+      }
+      else
+      {
+         // Sleep as long as the Sleep Timer allows (about 18 hours).
+         if (sleepTimed(mode, MAX_SLEEP_MS))
+         {
+            wakeStart();
+         }
+      }
+      return;
+   }
+
+   // The processor wakes up on the HS RCOSC after each PM1 or PM2 part of
+   // the wait and stays on it (Timer 4 still counts correctly) between the
+   // parts.  The crystal is only started, and the wake-up only counted, once
+   // the deepest mode left is PM0, which is where PM1_WAKE_MS and
+   // PM2_WAKE_MS leave time for the crystal to start.
+
+   while(1)
+   {
+      remaining = (int32)(deadlineMs - getMs());
+      if (remaining <= 0)
+      {
+         if (slept)
+         {
+            wakeStart();
+         }
+         return;
+      }
+
+      mode = (remaining >= PM1_MIN_MS) ? sleepAllowedPowerMode() : 0;
+      if (mode >= 2 && remaining >= PM2_MIN_MS)
+      {
+         // Wake up a little early; the rest is done in PM1 or PM0.
+         slept |= sleepTimed(2, remaining - PM2_WAKE_MS);
+      }
+      else if (mode >= 1)
+      {
+         slept |= sleepTimed(1, remaining - PM1_WAKE_MS);
+      }
+      else
+      {
+         if (slept)
+         {
+            wakeStart();
+            slept = 0;
+         }
+
+         if (T4IE)
+         {
+            // PM0: Timer 4 keeps running and wakes us every millisecond.
+            sleepIdle();
+         }
+      }
+   }
+}
+
+uint32 sleepWakeCount(void)
+{
+   return wakeCount;
+}
+
+uint32 sleepWakeRcUs(void)
+{
+   return wakeRcUs;
+}
+
+uint32 sleepWakeCrystalStartUs(void)
+{
+   return wakeCrystalStartUs;
+}
+
+uint32 sleepWakeCrystalUs(void)
+{
+   return wakeCrystalUs;
+}
+
+uint32 sleepWakeChargeNc(void)
+{
+   if (wakeCount == 0)
+   {
+      return 0;
+   }
+
+   // uA * us = pC
+   return ((wakeRcUs / wakeCount) * SLEEP_CURRENT_RC_UA
+      + (wakeCrystalStartUs / wakeCount) * SLEEP_CURRENT_CRYSTAL_START_UA
+      + (wakeCrystalUs / wakeCount) * SLEEP_CURRENT_CRYSTAL_UA) / 1000;
+}
+
+void sleepClearWakeStatistics(void)
+{
+   wakeCount = 0;
+   wakeRcUs = 0;
+   wakeCrystalStartUs = 0;
+   wakeCrystalUs = 0;
 }
 
+uint32 sleepIdle(void)
+{
+   uint32 start = getUs();
+   uint32 elapsed;
+
+   // The instruction after the one that sets EA always runs before any
+   // interrupt is serviced, so if the caller disabled interrupts to check for
+   // work, an interrupt that is already pending still wakes the CPU.
+   EA = 1;
+   PCON |= 0x01;    // PCON.IDLE = 1
+   __asm nop __endasm;
+
+   elapsed = getUs() - start;
+   idleUs += elapsed;
+   if (idleUs < elapsed)
+   {
+      idleUsHigh++;
+   }
+   residencyCount[SLEEP_STATE_PM0]++;
+   return elapsed;
+}
+
+// Returns the time spent in PM0, in milliseconds.
+static uint32 idleMs(void)
+{
+   // (high * 2^32 + us) / 1000, where 2^32 = 4294967 * 1000 + 296
+   return idleUsHigh * (uint32)4294967 + idleUs / 1000 + ((uint32)idleUsHigh * 296 + idleUs % 1000) / 1000;
+}
+
+uint32 sleepResidencyMs(uint8 state)
+{
+   uint32 total;
+   uint8 i;
+
+   if (state == SLEEP_STATE_PM0)
+   {
+      return idleMs();
+   }
+
+   if (state != SLEEP_STATE_ACTIVE)
+   {
+      return residencyMs[state];
+   }
+
+   total = getMs() - residencyStartMs - idleMs();
+   for (i = SLEEP_STATE_PM1; i < SLEEP_STATE_COUNT; i++)
+   {
+      total -= residencyMs[i];
+   }
+   return total;
+}
+
+uint32 sleepResidencyCount(uint8 state)
+{
+   return residencyCount[state];
+}
+
+void sleepClearResidency(void)
+{
+   uint8 i;
+   for (i = 0; i < SLEEP_STATE_COUNT; i++)
+   {
+      residencyMs[i] = 0;
+      residencyCount[i] = 0;
+   }
+   idleUs = 0;
+   idleUsHigh = 0;
+   residencyStartMs = getMs();
+}
+
+// Returns the charge in microcoulombs for the given time and current:
+// ms * uA / 1000, without overflowing.
+static uint32 charge(uint32 ms, uint16 microamps)
+{
+   return (ms / 1000) * microamps + (ms % 1000) * microamps / 1000;
+}
+
+uint32 sleepEstimateChargeUc(uint32 radioRxMs, uint32 radioTxMs)
+{
+   return charge(sleepResidencyMs(SLEEP_STATE_ACTIVE), SLEEP_CURRENT_CRYSTAL_UA)
+      + charge(idleMs(), SLEEP_CURRENT_PM0_UA)
+      + charge(residencyMs[SLEEP_STATE_PM1], SLEEP_CURRENT_PM1_UA)
+      + charge(residencyMs[SLEEP_STATE_PM2] / 1000, SLEEP_CURRENT_PM2_NA)
+      + charge(radioRxMs, SLEEP_CURRENT_RADIO_RX_UA)
+      + charge(radioTxMs, SLEEP_CURRENT_RADIO_TX_UA);
+}
@@ -7,28 +7,101 @@
 #include <cc2511_map.h>
 #include <cc2511_types.h>
 #include <time.h>
+#include <sleep.h>
 
 PDATA volatile uint32 timeMs;
 
+void (*timeMsHook)(void) = 0;
+
+// 1 if the timer ticks are 12 MHz instead of 24 MHz (see timeUpdateTickSpeed()).
+static BIT halfSpeedTicks;
+
+// The call to timeMsHook makes SDCC save all the registers in this ISR, even
+// when the hook is 0.  See the cost documented for timeMsHook in time.h.
 ISR(T4, 0)
 {
     timeMs++;
+    if (timeMsHook)
+    {
+        timeMsHook();
+    }
     // T4CC0 ^= 1; // If we do this, then on average the interrupts will occur precisely 1.000 ms apart.
 }
 
 uint32 getMs()
 {
-    uint8 oldT4IE = T4IE;   // store state of timer 4 interrupt (active/inactive?)
     uint32 time;
-    T4IE = 0;               // disable timer 4 interrupt
-    time = timeMs;          // copy millisecond timer count into a safe variable
-    T4IE = oldT4IE;         // restore timer 4 interrupt to its original state
-    return time;            // return timer count copy
+
+    // Read the time twice and try again if it changed.  The T4 ISR can
+    // interrupt us in the middle of reading the four bytes, but if it does,
+    // the two copies will be different (unless the bytes we had already read
+    // did not change, in which case the first copy is correct anyway).
+    // Unlike disabling the interrupt, this does not delay the other ISRs.
+    do
+    {
+        time = timeMs;
+    }
+    while(time != timeMs);
+
+    return time;
+}
+
+uint32 getUs() __reentrant
+{
+    uint32 ms;
+    uint8 ticks;
+    uint8 overflowPending;
+
+    do
+    {
+        ms = timeMs;
+        ticks = T4CNT;
+        overflowPending = T4IF;
+    }
+    while(ms != timeMs);
+
+    // With 12 MHz timer ticks, Timer 4 only counts to 93, so scale it up.
+    if (halfSpeedTicks)
+    {
+        ticks <<= 1;
+    }
+
+    // If Timer 4 overflowed but its ISR has not run yet (because we are in
+    // an ISR ourselves, or interrupts are disabled), count that millisecond
+    // now.  A small tick count means the overflow happened before we read
+    // the counter.
+    if (overflowPending && ticks < 94)
+    {
+        ms++;
+    }
+
+    // Timer 4 counts from 0 to 187 in each millisecond, so a tick is about
+    // 5.32 us.  Multiply with shifts instead of a multiplication so that this
+    // function is safe to call from an ISR:
+    //   ms * 1000 = ms * (1024 - 16 - 8)
+    //   ticks * 85 / 16 = ticks * 5.3125  (0 to 993)
+    return (ms << 10) - (ms << 4) - (ms << 3)
+        + ((((uint16)ticks << 6) + ((uint16)ticks << 4) + ((uint16)ticks << 2) + ticks) >> 4);
+}
+
+void timeUpdateTickSpeed()
+{
+    // CLKCON.TICKSPD (bits 5:3) is 000 for 24 MHz timer ticks, 001 for 12 MHz.
+    if (CLKCON & 0x38)
+    {
+        T4CC0 = 93;
+        halfSpeedTicks = 1;
+    }
+    else
+    {
+        T4CC0 = 187;
+        halfSpeedTicks = 0;
+    }
 }
 
 void timeInit()
 {
-    T4CC0 = 187;
+    timeUpdateTickSpeed();
     T4IE = 1;     // Enable Timer 4 interrupt.  (IEN1.T4IE=1)
 
     // DIV=111: 1:128 prescaler
@@ -54,3 +127,28 @@ void delayMs(uint16 milliseconds)
         delayMicroseconds(249); // there's some overhead, so only delay by 249 here
     }
 }
+
+void delayMsIdle(uint16 milliseconds)
+{
+    uint32 end;
+
+    if (!T4IE)
+    {
+        // Nothing would wake us up from idle.
+        delayMs(milliseconds);
+        return;
+    }
+
+    end = getUs() + (uint32)milliseconds * 1000;
+
+    // Idle the CPU (PM0) while there is more than one Timer 4 period left.
+    // The Timer 4 interrupt wakes it at least once per period (1003 us), so
+    // this can never overshoot the end.  Other interrupts just wake it early.
+    while((int32)(end - getUs()) > 1010)
+    {
+        sleepIdle();
+    }
+
+    // Wait out the rest of the delay precisely.
+    while((int32)(end - getUs()) > 0){}
+}
@@ -0,0 +1,64 @@
+/* Host test for the division-free millivolt conversion in the ADC library
+ * (src/adc/millivolts.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -D__CDT_PARSER__ -D__sbit= -D__sfr16= -Isource \
+ *       tests/host/millivolts_test.c -o millivolts_test && ./millivolts_test
+ *
+ * It checks divideBy2047 against true division for every value in the range
+ * where it is documented to be exact, and checks adcConvertToMillivolts
+ * against the formula it replaces for every ADC result and every
+ * calibration from 0 to 5000 mV. */
+
+#include "../../src/adc/millivolts.c"
+
+#include <stdio.h>
+
+// millivolts.c calls this; the conversions tested here do not.
+uint16 adcRead(uint8 channel)
+{
+    (void)channel;
+    return 0;
+}
+
+int main(void)
+{
+    unsigned long failures = 0;
+    uint32 n;
+    uint16 calibration;
+    int16 result;
+
+    for (n = 0; n < 0x3FFFFFUL; n++)
+    {
+        if (divideBy2047(n) != n / 2047)
+        {
+            if (failures++ < 10)
+            {
+                printf("FAIL: divideBy2047(%lu) = %u, expected %lu\n",
+                    (unsigned long)n, divideBy2047(n), (unsigned long)(n / 2047));
+            }
+        }
+    }
+
+    for (calibration = 0; calibration <= 5000; calibration++)
+    {
+        adcSetMillivoltCalibration(calibration);
+        for (result = -2048; result <= 2047; result++)
+        {
+            int16 expected = (int16)(((int32)result * calibration + 1023) / 2047);
+            int16 actual = adcConvertToMillivolts(result);
+            if (actual != expected)
+            {
+                if (failures++ < 20)
+                {
+                    printf("FAIL: adcConvertToMillivolts(%d) with %u mV = %d, expected %d\n",
+                        result, calibration, actual, expected);
+                }
+            }
+        }
+    }
+
+    printf("%lu failures\n", failures);
+    return failures ? 1 : 0;
+}
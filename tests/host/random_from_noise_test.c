@@ -0,0 +1,241 @@
+/* Host test for the noise collection in the random library
+ * (src/random/random_from_noise.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -D__CDT_PARSER__ -D__sbit= -D__sfr16= -Isource \
+ *       tests/host/random_from_noise_test.c -o random_from_noise_test && \
+ *       ./random_from_noise_test
+ *
+ * With __CDT_PARSER__ defined, the special function registers are plain
+ * variables, so the test can play the part of the radio and check what the
+ * library writes to it.  The functions from random.c and time.c are replaced
+ * by the stubs below, which record how they were called.
+ *
+ * The test checks that:
+ * - each byte passed to randomAddEntropy() is made of exactly 4
+ *   measurements, 2 bits each, folded from all 8 bits of the measurement;
+ * - the bytes are uniformly distributed (chi-squared test) when the only
+ *   noise in the measurements is in a single bit, wherever that bit is.
+ *   The measurements are made up by rand(), so this checks the folding and
+ *   packing, not how much noise the real RSSI and ADC readings have;
+ * - the radio is never strobed unless the caller owns it, and is put back
+ *   in IDLE when it was strobed;
+ * - a generator stuck in a bad state is reseeded from the software
+ *   generator, not from a constant. */
+
+#include "../../src/random/random_from_noise.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long failures = 0;
+
+#define CHECK(condition, what) \
+    if (!(condition)) { if (failures++ < 20) { printf("FAIL: %s\n", what); } }
+
+static uint8 entropy[1024];
+static unsigned int entropyCount;
+
+void randomAddEntropy(uint8 byte)
+{
+    if (entropyCount < sizeof(entropy)) { entropy[entropyCount] = byte; }
+    entropyCount++;
+}
+
+static unsigned int seedCount;
+static uint8 seedMsb, seedLsb;
+
+void randomSeed(uint8 seed_msb, uint8 seed_lsb)
+{
+    seedCount++;
+    seedMsb = seed_msb;
+    seedLsb = seed_lsb;
+}
+
+static uint8 fastValue;
+
+uint8 randomFast(void)
+{
+    return fastValue++;
+}
+
+void randomPoolService(void)
+{
+}
+
+// Plays the part of the radio: it enters RX a few hundred microseconds
+// after the SRX strobe, and the RSSI changes randomly.
+static unsigned int delayCount;
+
+void delayMicroseconds(uint8 microseconds)
+{
+    (void)microseconds;
+    delayCount++;
+    if (RFST == SRX && delayCount > 3)
+    {
+        MARCSTATE = MARCSTATE_RX;
+    }
+    RSSI = (uint8)rand();
+}
+
+static void reset(void)
+{
+    collected = 0;
+    collectedBits = 0;
+    entropyCount = 0;
+    delayCount = 0;
+}
+
+static uint8 fold(uint8 x)
+{
+    uint8 i, bits = 0;
+    for (i = 0; i < 8; i++)
+    {
+        bits ^= (x >> i) & 1;
+    }
+    return bits;
+}
+
+static void testPacking(void)
+{
+    unsigned int i;
+    uint8 k;
+    uint8 m[4];
+
+    reset();
+    for (i = 0; i < 200; i++)
+    {
+        uint8 expected = 0;
+
+        for (k = 0; k < 4; k++)
+        {
+            CHECK(entropyCount == i, "a byte was passed on before 4 measurements");
+            m[k] = (uint8)rand();
+            collect(m[k]);
+        }
+        CHECK(entropyCount == i + 1, "no byte was passed on after 4 measurements");
+
+        // Each 2-bit piece must be the XOR of the odd bits and the XOR of
+        // the even bits of one measurement, oldest measurement first.
+        for (k = 0; k < 4; k++)
+        {
+            expected = (expected << 2) | (fold(m[k] & 0xAA) << 1) | fold(m[k] & 0x55);
+        }
+        CHECK(entropy[i] == expected, "a byte does not match its 4 measurements");
+    }
+}
+
+static void testUniform(void)
+{
+    uint8 bit;
+
+    for (bit = 0; bit < 8; bit++)
+    {
+        static unsigned long counts[256];
+        unsigned long samples = 256UL * 64;
+        double chiSquared = 0;
+        unsigned int i;
+        char message[80];
+
+        memset(counts, 0, sizeof(counts));
+        reset();
+
+        // The measurements are a constant with noise in just one bit.  That
+        // gives 1 bit of noise per measurement, so pair them up to get
+        // the 2 bits that are credited: one changes only the noisy bit, the
+        // other a neighbouring one.
+        for (i = 0; i < samples * 4; i++)
+        {
+            uint8 other = (bit & 1) ? bit - 1 : bit + 1;
+            uint8 x = 0x5A;
+            if (rand() & 1) { x ^= 1 << bit; }
+            if (rand() & 1) { x ^= 1 << other; }
+            collect(x);
+            if (entropyCount)
+            {
+                counts[entropy[0]]++;
+                entropyCount = 0;
+            }
+        }
+
+        for (i = 0; i < 256; i++)
+        {
+            double d = counts[i] - samples / 256.0;
+            chiSquared += d * d / (samples / 256.0);
+        }
+
+        // 255 degrees of freedom: the 99.9th percentile is about 330.
+        sprintf(message, "bytes are not uniform with noise in bits %u and %u (chi-squared %.0f)",
+            bit, (bit & 1) ? bit - 1 : bit + 1, chiSquared);
+        CHECK(chiSquared < 330, message);
+    }
+}
+
+static void testRadio(void)
+{
+    // Radio idle and owned by someone else: it must not be touched.
+    reset();
+    MARCSTATE = MARCSTATE_IDLE;
+    RFST = 0xEE;
+    CHECK(rssiCollect(0) == 0, "RSSI was used while the radio was idle and not owned");
+    CHECK(RFST == 0xEE, "the radio was strobed without being owned");
+    CHECK(entropyCount == 0, "entropy was collected from an idle radio");
+
+    // Radio in RX because of another library: read the RSSI, do not strobe.
+    reset();
+    MARCSTATE = MARCSTATE_RX;
+    RFST = 0xEE;
+    CHECK(rssiCollect(0) == 1, "RSSI was not used while the radio was in RX");
+    CHECK(RFST == 0xEE, "the radio was strobed while another library had it in RX");
+    CHECK(entropyCount == RSSI_SAMPLES / 4, "wrong number of bytes from the RSSI");
+
+    // Radio idle and owned: put it in RX and back in IDLE.
+    reset();
+    MARCSTATE = MARCSTATE_IDLE;
+    RFST = 0xEE;
+    CHECK(rssiCollect(1) == 1, "RSSI was not used when the radio was owned");
+    CHECK(RFST == SIDLE, "the radio was not put back in IDLE");
+    CHECK(entropyCount == RSSI_SAMPLES / 4, "wrong number of bytes from the RSSI");
+
+    // Radio in some other state (e.g. TX): never touched.
+    reset();
+    MARCSTATE = 0x13;
+    RFST = 0xEE;
+    CHECK(rssiCollect(1) == 0, "RSSI was used while the radio was busy");
+    CHECK(RFST == 0xEE, "the radio was strobed while it was busy");
+}
+
+static void testRescue(void)
+{
+    seedCount = 0;
+    ADCCON1 = 0;
+    RNDH = 0x12;
+    RNDL = 0x34;
+    rescueGenerator();
+    CHECK(seedCount == 0, "a good generator state was reseeded");
+
+    RNDH = 0;
+    RNDL = 0;
+    fastValue = 0x9C;
+    rescueGenerator();
+    CHECK(seedCount == 1, "a generator stuck at 0x0000 was not reseeded");
+    CHECK(seedMsb == 0x9C && seedLsb == 0x9D, "the generator was not reseeded from randomFast()");
+
+    RNDH = 0x80;
+    RNDL = 0x03;
+    rescueGenerator();
+    CHECK(seedCount == 2, "a generator stuck at 0x8003 was not reseeded");
+}
+
+int main(void)
+{
+    srand(1);
+    testPacking();
+    testUniform();
+    testRadio();
+    testRescue();
+
+    printf("%lu failures\n", failures);
+    return failures ? 1 : 0;
+}
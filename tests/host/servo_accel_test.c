@@ -0,0 +1,176 @@
+/* Host test for the trapezoidal motion profile of the servo library
+ * (accelerateServo in src/servo/servo.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -D__CDT_PARSER__ -D__sbit= -D__sfr16= -Isource \
+ *       tests/host/servo_accel_test.c -lm -o servo_accel_test && ./servo_accel_test
+ *
+ * The __CDT_PARSER__ definitions make the SDCC-specific keywords and special
+ * function registers compile as plain C, so the library source can be
+ * included directly and its static functions tested.
+ *
+ * For each combination of start position, target, speed limit and
+ * acceleration limit, the servo is moved until it stops, and the test checks
+ * that:
+ * - it arrives exactly at the target and stays there,
+ * - it never passes the target,
+ * - the step per servo period never exceeds the speed limit,
+ * - the step changes by at most the acceleration per servo period,
+ * - the steps go up, stay level, and go down (a trapezoid or a triangle),
+ * - the move does not take much longer than the ideal profile.
+ *
+ * The ideal profile uses the cruising speed documented in servo.h: the
+ * largest multiple of the acceleration limit that does not exceed the speed
+ * limit. */
+
+#include "../../src/servo/servo.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+static unsigned long failures = 0;
+static unsigned long moves = 0;
+
+static void fail(const char * what, uint16 start, uint16 target, uint16 speed, uint16 accel, unsigned long period)
+{
+    if (failures < 20)
+    {
+        printf("FAIL: %s (start %u, target %u, speed %u, accel %u, period %lu)\n",
+            what, start, target, speed, accel, period);
+    }
+    failures++;
+}
+
+// Returns the number of servo periods that an ideal trapezoid with integer
+// velocities takes to cover the distance, plus some slack for the rounding
+// that the library does near the end of a move.
+static unsigned long idealPeriods(uint32 distance, uint16 speed, uint16 accel)
+{
+    double cap = speed ? speed : 65535.0;
+    double a = accel > cap ? cap : accel;
+    double rampPeriods = floor(cap / a);
+    double rampDistance = a * rampPeriods * (rampPeriods + 1);
+
+    cap = rampPeriods * a;
+    double periods;
+
+    if (distance <= rampDistance)
+    {
+        periods = 2 * sqrt(distance / a);
+    }
+    else
+    {
+        periods = 2 * rampPeriods + (distance - rampDistance) / cap;
+    }
+    return (unsigned long)periods + 4;
+}
+
+static void testMove(uint16 start, uint16 target, uint16 speed, uint16 accel)
+{
+    struct SERVO_DATA d;
+    uint16 pos = start;
+    uint16 previousStep = 0;
+    uint32 distance = start > target ? start - target : target - start;
+    unsigned long limit = idealPeriods(distance, speed, accel);
+    unsigned long period;
+    uint16 cap = speed ? speed : 0xFFFF;
+    uint16 a = accel > cap ? cap : accel;
+    BIT slowing = 0;
+
+    memset(&d, 0, sizeof(d));
+    d.target = target;
+    d.position = start;
+    d.speed = d.speedLimit = speed;
+    d.acceleration = accel;
+
+    moves++;
+
+    for (period = 0; pos != target || d.velocity != 0; period++)
+    {
+        uint16 next;
+        uint16 step;
+
+        if (period > limit)
+        {
+            fail("too slow", start, target, speed, accel, period);
+            return;
+        }
+
+        next = accelerateServo(&d, pos);
+
+        if (target > start ? (next < pos || next > target) : (next > pos || next < target))
+        {
+            fail("moved the wrong way or passed the target", start, target, speed, accel, period);
+            return;
+        }
+
+        step = next > pos ? next - pos : pos - next;
+        if (step > cap)
+        {
+            fail("speed limit exceeded", start, target, speed, accel, period);
+        }
+        if (step > previousStep + a || previousStep > step + a)
+        {
+            fail("acceleration limit exceeded", start, target, speed, accel, period);
+        }
+        if (step < previousStep)
+        {
+            slowing = 1;
+        }
+        else if (step > previousStep && slowing)
+        {
+            fail("sped up again after slowing down", start, target, speed, accel, period);
+        }
+
+        previousStep = step;
+        pos = next;
+    }
+
+    for (period = 0; period < 3; period++)
+    {
+        pos = accelerateServo(&d, pos);
+        if (pos != target || d.velocity != 0 || d.brakeDistance != 0)
+        {
+            fail("did not stay at the target", start, target, speed, accel, period);
+            return;
+        }
+    }
+}
+
+int main(void)
+{
+    static const uint16 positions[] = { 1, 24000, 24001, 36000, 36017, 48000, 65535 };
+    static const uint16 speeds[] = { 0, 1, 7, 100, 480, 4000 };
+    static const uint16 accels[] = { 1, 2, 3, 10, 77, 480, 5000 };
+    uint8 i, j, k, m;
+    uint16 offset;
+
+    for (i = 0; i < sizeof(positions) / sizeof(positions[0]); i++)
+    {
+        for (j = 0; j < sizeof(positions) / sizeof(positions[0]); j++)
+        {
+            for (k = 0; k < sizeof(speeds) / sizeof(speeds[0]); k++)
+            {
+                for (m = 0; m < sizeof(accels) / sizeof(accels[0]); m++)
+                {
+                    testMove(positions[i], positions[j], speeds[k], accels[m]);
+                }
+            }
+        }
+    }
+
+    // Short moves, around one acceleration step.
+    for (offset = 0; offset < 300; offset++)
+    {
+        for (m = 0; m < sizeof(accels) / sizeof(accels[0]); m++)
+        {
+            testMove(36000, 36000 + offset, 0, accels[m]);
+            testMove(36000, 36000 - offset, 100, accels[m]);
+        }
+    }
+
+    printf("%lu moves, %lu failures\n", moves, failures);
+    return failures ? 1 : 0;
+}
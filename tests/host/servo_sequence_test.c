@@ -0,0 +1,249 @@
+/* Host test for the keyframe sequence player of the servo library
+ * (applyKeyframe, advanceSequence, and servoSequencePause in
+ * src/servo/servo.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -D__CDT_PARSER__ -D__sbit= -D__sfr16= -Isource \
+ *       tests/host/servo_sequence_test.c -o servo_sequence_test && ./servo_sequence_test
+ *
+ * The servo periods are simulated by calling advanceSequence() and then
+ * moving each servo the way ISR(T1) does: by at most its speed, or with
+ * accelerateServo() if it has an acceleration limit.
+ *
+ * The test checks that:
+ * - divideRoundUp() matches the C division operator,
+ * - for many keyframe times, servo periods, and distances, a servo arrives
+ *   at its target by the last servo period of the keyframe, and exactly in
+ *   that period when the distance is large enough for the rounding of the
+ *   speed not to matter (at least the number of periods squared),
+ * - a keyframe shorter than two servo periods makes the servos jump,
+ * - when a sequence is paused, a servo with an acceleration limit slows down
+ *   by at most its acceleration per period, stops at its braking point
+ *   without turning back, and goes on to its target after it is resumed. */
+
+#include "../../src/servo/servo.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static unsigned long failures = 0;
+static unsigned long checks = 0;
+
+#define CHECK(condition, what) \
+    if (checks++, !(condition)) { if (failures++ < 20) { printf("FAIL: %s (line %d)\n", what, __LINE__); } }
+
+static uint16 keyframes[2 * 3];
+static SERVO_SEQUENCE sequence = { keyframes, 2, 2, 0 };
+
+// Simulates one servo period: the sequence player, then the moves.
+static void runPeriod(void)
+{
+    uint8 i;
+
+    if (sequenceCurrent && !sequencePaused)
+    {
+        advanceSequence();
+    }
+
+    for (i = 0; i < servoCount; i++)
+    {
+        volatile struct SERVO_DATA XDATA * d = servoData + i;
+        uint16 pos = d->position;
+
+        if (d->acceleration && pos && d->target)
+        {
+            pos = accelerateServo(d, pos);
+        }
+        else if (d->speed && pos)
+        {
+            if (d->target > pos)
+            {
+                pos = (d->target - pos < d->speed) ? d->target : pos + d->speed;
+            }
+            else
+            {
+                pos = (pos - d->target < d->speed) ? d->target : pos - d->speed;
+            }
+        }
+        else
+        {
+            pos = d->target;
+        }
+        d->position = pos;
+    }
+}
+
+static void setUp(uint16 periodMsQ8)
+{
+    uint8 i;
+
+    servoCount = 2;
+    servoPeriodMsQ8 = periodMsQ8;
+    for (i = 0; i < SERVO_MAX_COUNT; i++)
+    {
+        servoAssignment[i] = i;
+    }
+    for (i = 0; i < MAX_SERVOS; i++)
+    {
+        servoData[i].target = servoData[i].position = 0;
+        servoData[i].speed = servoData[i].speedLimit = 0;
+        servoData[i].acceleration = servoData[i].velocity = servoData[i].brakeDistance = 0;
+    }
+}
+
+static void testDivide(void)
+{
+    unsigned long i;
+
+    for (i = 0; i < 1000000; i++)
+    {
+        uint32 n = ((uint32)rand() << 8 ^ rand()) & 0xFFFFFF;
+        uint16 d = rand() % 4000 + 1;
+        uint32 expected = (n + d - 1) / d;
+
+        CHECK(divideRoundUp(n, d) == (expected > 0xFFFF ? 0xFFFF : expected), "divideRoundUp");
+    }
+    CHECK(divideRoundUp(0, 7) == 0, "divideRoundUp(0)");
+    CHECK(divideRoundUp(0xFFFFFF, 1) == 0xFFFF, "divideRoundUp overflow");
+}
+
+// Plays a keyframe of the given time from start to target (in microseconds)
+// and checks when servo 0 arrives.
+static void testKeyframe(uint16 periodMsQ8, uint16 time, uint16 start, uint16 target)
+{
+    // The 0 ms keyframe before this one runs over by one period, which is
+    // taken off this keyframe.
+    uint32 remaining = ((uint32)time << 8 > periodMsQ8) ? ((uint32)time << 8) - periodMsQ8 : 0;
+    uint16 periods = (remaining + periodMsQ8 - 1) / periodMsQ8;
+    uint32 distance = 24 * (uint32)((target > start) ? (target - start) : (start - target));
+    uint16 n;
+    uint16 arrived = 0;
+
+    setUp(periodMsQ8);
+    servoData[0].target = servoData[0].position = start * 24;
+
+    // Keyframe 0 is 0 ms long, so keyframe 1 starts in the next period.
+    keyframes[0] = 0;     keyframes[1] = SERVO_KEYFRAME_UNCHANGED; keyframes[2] = 1500;
+    keyframes[3] = time;  keyframes[4] = target;                   keyframes[5] = SERVO_KEYFRAME_UNCHANGED;
+    servoSequencePlay(&sequence);
+    CHECK(servoData[1].position == 1500 * 24, "a 0 ms keyframe makes the servos jump");
+
+    runPeriod();
+    CHECK(sequenceKeyframeIndex == 1, "the 0 ms keyframe lasts one period");
+
+    for (n = 1; n <= periods + 2 && !arrived; n++)
+    {
+        if (servoData[0].position == target * 24)
+        {
+            arrived = n;
+            break;
+        }
+        runPeriod();
+    }
+
+    // The first move happened in the period that started the keyframe, so
+    // "arrived" is the number of moves it took, and the keyframe has room
+    // for "periods" moves.
+    if (periods < 2)
+    {
+        CHECK(arrived == 1, "a keyframe shorter than two periods makes the servos jump");
+    }
+    else if (distance == 0)
+    {
+        CHECK(arrived == 1, "a servo that does not move stays");
+    }
+    else
+    {
+        CHECK(arrived != 0 && arrived <= periods, "servo arrives by the end of the keyframe");
+        if (distance >= (uint32)periods * periods)
+        {
+            CHECK(arrived == periods, "servo arrives in the last period of the keyframe");
+        }
+    }
+}
+
+static void testPause(uint16 start, uint16 target, uint16 acceleration, uint16 pauseAfter)
+{
+    uint16 previousStep = 0;
+    uint16 brakingPoint;
+    uint16 n;
+    BIT forwards = target > start;
+
+    setUp(5120);   // 20 ms
+    servoData[0].target = servoData[0].position = start * 24;
+    servoData[0].acceleration = acceleration;
+
+    keyframes[0] = 0;     keyframes[1] = SERVO_KEYFRAME_UNCHANGED; keyframes[2] = SERVO_KEYFRAME_UNCHANGED;
+    keyframes[3] = 4000;  keyframes[4] = target;                   keyframes[5] = SERVO_KEYFRAME_UNCHANGED;
+    servoSequencePlay(&sequence);
+
+    for (n = 0; n < pauseAfter + 1; n++)
+    {
+        uint16 before = servoData[0].position;
+        runPeriod();
+        previousStep = (servoData[0].position > before) ? servoData[0].position - before : before - servoData[0].position;
+    }
+
+    servoSequencePause();
+    brakingPoint = servoData[0].target;
+    CHECK(forwards ? (brakingPoint >= servoData[0].position) : (brakingPoint <= servoData[0].position),
+        "braking point is ahead of the servo");
+
+    for (n = 0; n < 1000 && servoData[0].position != brakingPoint; n++)
+    {
+        uint16 before = servoData[0].position;
+        uint16 step;
+
+        runPeriod();
+        CHECK(forwards ? (servoData[0].position >= before) : (servoData[0].position <= before),
+            "paused servo does not turn back");
+        step = (servoData[0].position > before) ? servoData[0].position - before : before - servoData[0].position;
+        CHECK(step <= previousStep && previousStep - step <= acceleration, "paused servo decelerates");
+        previousStep = step;
+    }
+    CHECK(servoData[0].position == brakingPoint, "paused servo reaches its braking point");
+
+    // The velocity gets to 0 in the period after that.
+    runPeriod();
+    CHECK(servoData[0].position == brakingPoint && servoData[0].velocity == 0, "paused servo stops at its braking point");
+
+    servoSequenceResume();
+    for (n = 0; n < 2000 && servoData[0].position != target * 24; n++)
+    {
+        runPeriod();
+    }
+    CHECK(servoData[0].position == target * 24, "resumed servo reaches its target");
+}
+
+int main(void)
+{
+    uint16 periodMsQ8;
+    uint16 time;
+    uint16 distance;
+    uint16 n;
+
+    testDivide();
+
+    for (periodMsQ8 = 955; periodMsQ8 <= 7680; periodMsQ8 += 211)
+    {
+        for (time = 0; time <= 3000; time += 37)
+        {
+            for (distance = 0; distance <= 1500; distance += (distance < 20) ? 1 : 97)
+            {
+                testKeyframe(periodMsQ8, time, 1000, 1000 + distance);
+                testKeyframe(periodMsQ8, time, 2500, 2500 - distance);
+            }
+        }
+    }
+
+    for (n = 1; n < 60; n += 3)
+    {
+        testPause(1000, 2000, 40, n);
+        testPause(2000, 1000, 7, n);
+        testPause(1500, 1510, 100, n);
+    }
+
+    printf("%lu checks, %lu failures\n", checks, failures);
+    return failures ? 1 : 0;
+}
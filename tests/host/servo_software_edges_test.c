@@ -0,0 +1,256 @@
+/* Host test for the timing of the software servo channels
+ * (servoServiceSoftwareEdges in src/servo/servo.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -D__CDT_PARSER__ -D__sbit= -D__sfr16= -Isource \
+ *       tests/host/servo_software_edges_test.c -o servo_software_edges_test && \
+ *       ./servo_software_edges_test
+ *
+ * T1CNTL, T1CNTH, P0, and P1 are replaced by functions that simulate them:
+ * every read of T1CNTL advances the simulated Timer 1 by 6 ticks (a quarter
+ * of a microsecond, about the length of the polling loop), and every access
+ * to P0 or P1 records the time at which pins changed.  The Timer 3 alarm is
+ * simulated by advancing the time by T3CC0 * 128 ticks and calling
+ * servoServiceSoftwareEdges() again, like ISR(T3) does.
+ *
+ * For pulse widths from 1000 to 2500 microseconds, in groups of one to four
+ * software channels, the test checks that:
+ * - the ISRs never spin for more than SOFTWARE_LEAD_TICKS waiting for an
+ *   edge (before, a pulse longer than about 1365 microseconds was treated as
+ *   late and the ISR spun for the whole pulse),
+ * - every pulse starts at SOFTWARE_PULSE_START and ends at the right tick
+ *   (or up to SOFTWARE_MERGE_TICKS away from it if it was merged with
+ *   another),
+ * - when the alarm is serviced late, the late edges are ended right away.
+ *
+ * It also checks that servosStart() rejects pins that are not on Port 0 or
+ * Port 1, and pins that need a software channel unless software channels
+ * were enabled by servo_software.c. */
+
+#include <cc2511_map.h>
+
+static unsigned char * simT1CNTL(void);
+static unsigned char * simT1CNTH(void);
+static unsigned char * simP0(void);
+static unsigned char * simP1(void);
+
+#define T1CNTL (*simT1CNTL())
+#define T1CNTH (*simT1CNTH())
+#define P0     (*simP0())
+#define P1     (*simP1())
+
+#include "../../src/servo/servo.c"
+
+#include <stdio.h>
+
+// The allowed error, in ticks, caused by the simulated polling loop.
+#define SLACK 24
+
+static unsigned long failures = 0;
+static unsigned long pulses = 0;
+
+#define CHECK(condition, what, width) \
+    if (!(condition)) { if (failures++ < 20) { printf("FAIL: %s (width %u us)\n", what, width); } }
+
+/* Simulated hardware *********************************************************/
+
+static unsigned long simTicks;
+static unsigned char simTimerLow, simTimerHigh;
+
+static unsigned char simPort[2];
+static unsigned char simPortLast[2];
+static unsigned long simPortAccessTime[2];
+
+// The times at which each pin (0-7 on P0, 8-15 on P1) went high and low.
+static unsigned long riseTime[16], fallTime[16];
+
+// The time of the last port access or ISR entry, and the longest time
+// between two of them within one ISR call: the longest spin.
+static unsigned long lastEventTime;
+static unsigned long longestSpin;
+
+static void simEvent(void)
+{
+    if (simTicks - lastEventTime > longestSpin)
+    {
+        longestSpin = simTicks - lastEventTime;
+    }
+    lastEventTime = simTicks;
+}
+
+static unsigned char * simT1CNTL(void)
+{
+    simTicks += 6;
+    simTimerLow = (unsigned char)simTicks;
+    simTimerHigh = (unsigned char)(simTicks >> 8);   // Reading T1CNTL latches T1CNTH.
+    return &simTimerLow;
+}
+
+static unsigned char * simT1CNTH(void)
+{
+    return &simTimerHigh;
+}
+
+// Records the changes made by the previous access to a port.  The write of
+// a read-modify-write like "P0 &= ~mask" happens after the function returns,
+// so it is only seen at the next access.
+static void simPortUpdate(uint8 port)
+{
+    uint8 bit;
+    for (bit = 0; bit < 8; bit++)
+    {
+        uint8 mask = 1 << bit;
+        if ((simPort[port] & mask) && !(simPortLast[port] & mask))
+        {
+            riseTime[port * 8 + bit] = simPortAccessTime[port];
+        }
+        if (!(simPort[port] & mask) && (simPortLast[port] & mask))
+        {
+            fallTime[port * 8 + bit] = simPortAccessTime[port];
+        }
+    }
+    simPortLast[port] = simPort[port];
+    simPortAccessTime[port] = simTicks;
+}
+
+static unsigned char * simP0(void)
+{
+    simEvent();
+    simPortUpdate(0);
+    return &simPort[0];
+}
+
+static unsigned char * simP1(void)
+{
+    simEvent();
+    simPortUpdate(1);
+    return &simPort[1];
+}
+
+/* Tests **********************************************************************/
+
+// Generates the pulses of software group 0, which contains the channels 0, 4,
+// 8, and 12.  Channel s drives pin s (P0_0, P0_4, P1_0, P1_4).  The Timer 3
+// alarm is serviced latency ticks after it fires.
+static void runGroup(uint16 * widths, uint8 count, unsigned long latency)
+{
+    uint8 i;
+    unsigned int alarms = 0;
+
+    softwareServoCount = 1 + (count - 1) * SOFTWARE_GROUP_COUNT;
+    for (i = 0; i < MAX_SOFTWARE_SERVOS; i++)
+    {
+        softwarePort0Mask[i] = (i < 8) ? (1 << i) : 0;
+        softwarePort1Mask[i] = (i >= 8) ? (1 << (i - 8)) : 0;
+        servoData[FIRST_SOFTWARE_CHANNEL + i].position = 0;
+    }
+    for (i = 0; i < count; i++)
+    {
+        servoData[FIRST_SOFTWARE_CHANNEL + i * SOFTWARE_GROUP_COUNT].position = widths[i] * 24;
+    }
+    buildSoftwareSchedule();
+
+    for (i = 0; i < 16; i++)
+    {
+        riseTime[i] = fallTime[i] = 0;
+    }
+    simPort[0] = simPort[1] = simPortLast[0] = simPortLast[1] = 0;
+
+    // The Timer 1 ISR runs right after the overflow.
+    simTicks = lastEventTime = longestSpin = 0;
+    T3CTL = 0;
+    startSoftwareGroup(0);
+    simEvent();
+
+    while (T3CTL == T3CTL_ALARM && alarms++ < 1000)
+    {
+        simTicks += ((unsigned long)T3CC0 << TIMER3_SHIFT) + latency;
+        lastEventTime = simTicks;
+        servoServiceSoftwareEdges();
+        simEvent();
+    }
+    simPortUpdate(0);
+    simPortUpdate(1);
+
+    CHECK(T3CTL == 0, "Timer 3 is stopped when the group is done", widths[0]);
+    CHECK(longestSpin <= SOFTWARE_LEAD_TICKS + SLACK, "an ISR spins longer than SOFTWARE_LEAD_TICKS", widths[0]);
+
+    for (i = 0; i < count; i++)
+    {
+        uint8 pin = i * SOFTWARE_GROUP_COUNT;
+        unsigned long end = SOFTWARE_PULSE_START + (unsigned long)widths[i] * 24;
+
+        pulses++;
+        CHECK(riseTime[pin] >= SOFTWARE_PULSE_START && riseTime[pin] <= SOFTWARE_PULSE_START + SLACK,
+            "pulse starts at SOFTWARE_PULSE_START", widths[i]);
+        CHECK(fallTime[pin] != 0, "pulse ends", widths[i]);
+
+        if (latency == 0)
+        {
+            CHECK(fallTime[pin] + SOFTWARE_MERGE_TICKS >= end && fallTime[pin] <= end + SOFTWARE_MERGE_TICKS + SLACK,
+                "pulse ends at the right time", widths[i]);
+        }
+        else
+        {
+            // The alarm fires at most SOFTWARE_LEAD_TICKS before the edge, so
+            // with this much latency the edge is ended late, but right away.
+            CHECK(fallTime[pin] + SOFTWARE_MERGE_TICKS >= end && fallTime[pin] <= end + SOFTWARE_MERGE_TICKS + latency + SLACK,
+                "late pulse ends right away", widths[i]);
+        }
+    }
+}
+
+static void checkPins(void)
+{
+    static uint8 XDATA hardwarePins[] = { 2, 3, 4, 10, 11, 12 };
+    static uint8 XDATA softwarePins[] = { 2, 5, 17 };
+    static uint8 XDATA duplicatePins[] = { 2, 2 };
+    static uint8 XDATA port0Pin6[] = { 2, 6 };
+    static uint8 XDATA port2Pin[] = { 2, 20 };
+
+    softwareChannelsEnabled = 0;
+    CHECK(servosStart(hardwarePins, sizeof(hardwarePins)), "Timer 1 pins are accepted", 0);
+    CHECK(!servosStart(softwarePins, sizeof(softwarePins)), "software pins are rejected without ISR(T3)", 0);
+    CHECK(!servosStart(duplicatePins, sizeof(duplicatePins)), "a repeated Timer 1 pin is rejected without ISR(T3)", 0);
+    CHECK(servoCount == sizeof(hardwarePins) && softwareServoCount == 0, "a rejected call changes nothing", 0);
+
+    // servosStop() waits for the ISR, which does not run here.
+    servosStartedFlag = 0;
+
+    servoEnableSoftwareChannels();
+    CHECK(servosStart(softwarePins, sizeof(softwarePins)), "software pins are accepted with ISR(T3)", 0);
+    CHECK(softwareServoCount == 2 && softwarePort0Mask[0] == (1<<5) && softwarePort1Mask[1] == (1<<7),
+        "software pins get the right port masks", 0);
+    CHECK(!servosStart(port0Pin6, sizeof(port0Pin6)), "pin 6 is rejected", 0);
+    CHECK(!servosStart(port2Pin, sizeof(port2Pin)), "pin 20 is rejected", 0);
+    CHECK(softwareServoCount == 2, "a rejected call changes nothing", 0);
+
+    servosStartedFlag = 0;
+}
+
+int main(void)
+{
+    uint16 w;
+    uint16 widths[4];
+    uint8 count;
+
+    for (w = 1000; w <= 2500; w++)
+    {
+        widths[0] = w;
+        widths[1] = 3500 - w;
+        widths[2] = (w + 1 <= 2500) ? w + 1 : w - 1;   // Close enough to be merged.
+        widths[3] = (w + 37 <= 2500) ? w + 37 : 1000 + (w - 2463);
+
+        for (count = 1; count <= 4; count++)
+        {
+            runGroup(widths, count, 0);
+            runGroup(widths, count, SOFTWARE_LEAD_TICKS + 200);
+        }
+    }
+
+    checkPins();
+
+    printf("%lu pulses, %lu failures\n", pulses, failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,208 @@
+/* Host test for the USB descriptors of the composite CDC ACM and HID joystick
+ * device (src/usb_cdc_hid/usb_cdc_hid.c and src/usb_hid/usb_hid_joystick.c).
+ *
+ * Build and run it on a PC from the root of the SDK:
+ *
+ *   gcc -std=gnu89 -w -fpack-struct -D__CDT_PARSER__ -D__sbit= -D__sfr16= \
+ *       -Isource tests/host/usb_cdc_hid_descriptor_test.c \
+ *       -o usb_cdc_hid_descriptor_test && ./usb_cdc_hid_descriptor_test
+ *
+ * -fpack-struct is needed so that the descriptor structs have the same
+ * layout as on the CC2511, where SDCC never adds padding.  The functions
+ * from usb.c and usb_cdc_acm.c are replaced by the stubs below.
+ *
+ * The test walks the configuration descriptor the way a USB host does and
+ * checks that:
+ * - the descriptor lengths add up to wTotalLength, and bNumInterfaces
+ *   matches the interface descriptors;
+ * - the device descriptor has the class codes required for an Interface
+ *   Association Descriptor, and the IAD groups the two CDC ACM interfaces;
+ * - the endpoints have the expected addresses, types, and packet sizes,
+ *   and no endpoint is used twice;
+ * - the joystick's HID descriptor gives the real length of its report
+ *   descriptor, and the class descriptor handler returns both of them. */
+
+#include "../../src/usb_cdc_hid/usb_cdc_hid.c"
+#include "../../src/usb_hid/usb_hid_joystick.c"
+
+#include <stdio.h>
+
+static unsigned long failures = 0;
+
+#define CHECK(condition, what) \
+    if (!(condition)) { if (failures++ < 20) { printf("FAIL: %s\n", what); } }
+
+/* Stubs **********************************************************************/
+
+USB_SETUP_PACKET XDATA usbSetupPacket;
+enum USB_DEVICE_STATES XDATA usbDeviceState;
+uint16 CODE serialNumberStringDescriptor[] = { (2*(1+1)) | (USB_DESCRIPTOR_TYPE_STRING<<8), '0' };
+
+static uint16 controlReadCount;
+static uint8 XDATA * controlReadSource;
+
+void usbControlRead(uint16 bytesCount, uint8 XDATA * source)
+{
+    controlReadCount = bytesCount;
+    controlReadSource = source;
+}
+
+void usbInitEndpointIn(uint8 endpointNumber, uint8 maxPacketSize) { }
+void usbWriteFifo(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer) { }
+void usbComInitEndpoints(void) { }
+void usbComSetupHandler(void) { }
+void usbComControlWriteHandler(void) { }
+void usbComService(void) { }
+
+/* Tests **********************************************************************/
+
+static uint16 read16(const uint8 * p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void checkConfiguration(void)
+{
+    const uint8 * config = (const uint8 *)&usbConfigurationDescriptor;
+    uint16 totalLength = read16(config + 2);
+    uint16 offset = 0;
+    uint8 interfaces = 0;
+    uint8 associations = 0;
+    uint8 endpoints = 0;
+    uint8 endpointSeen[256] = {0};
+
+    CHECK(totalLength == sizeof(usbConfigurationDescriptor), "wTotalLength is the size of the configuration descriptor");
+
+    while (offset < totalLength)
+    {
+        const uint8 * d = config + offset;
+        CHECK(d[0] >= 2, "descriptor length is at least 2");
+        if (d[0] < 2) { return; }
+
+        switch (d[1])
+        {
+        case USB_DESCRIPTOR_TYPE_CONFIGURATION:
+            CHECK(offset == 0 && d[0] == 9, "configuration descriptor comes first and is 9 bytes");
+            break;
+
+        case USB_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION:
+            associations++;
+            CHECK(d[0] == 8, "IAD is 8 bytes");
+            CHECK(d[2] == CDC_CONTROL_INTERFACE_NUMBER && d[2] == 0, "IAD bFirstInterface is 0");
+            CHECK(d[3] == 2, "IAD bInterfaceCount is 2");
+            CHECK(d[4] == CDC_CLASS && d[5] == CDC_SUBCLASS_ACM, "IAD function is CDC ACM");
+            CHECK(offset + d[0] < totalLength && config[offset + d[0] + 1] == USB_DESCRIPTOR_TYPE_INTERFACE
+                && config[offset + d[0] + 2] == d[2], "IAD comes right before its first interface");
+            break;
+
+        case USB_DESCRIPTOR_TYPE_INTERFACE:
+            CHECK(d[0] == 9, "interface descriptor is 9 bytes");
+            CHECK(d[2] == interfaces, "interfaces are numbered in order");
+            interfaces++;
+            break;
+
+        case USB_DESCRIPTOR_TYPE_ENDPOINT:
+            CHECK(d[0] == 7, "endpoint descriptor is 7 bytes");
+            CHECK(!endpointSeen[d[2]], "each endpoint address is used once");
+            endpointSeen[d[2]] = 1;
+            endpoints++;
+
+            switch (d[2])
+            {
+            case USB_ENDPOINT_ADDRESS_IN | CDC_NOTIFICATION_ENDPOINT:
+                CHECK(d[3] == USB_TRANSFER_TYPE_INTERRUPT && read16(d + 4) == 10, "CDC notification endpoint");
+                break;
+            case USB_ENDPOINT_ADDRESS_OUT | CDC_DATA_ENDPOINT:
+                CHECK(d[3] == USB_TRANSFER_TYPE_BULK && read16(d + 4) == CDC_OUT_PACKET_SIZE, "CDC data OUT endpoint");
+                break;
+            case USB_ENDPOINT_ADDRESS_IN | CDC_DATA_ENDPOINT:
+                CHECK(d[3] == USB_TRANSFER_TYPE_BULK && read16(d + 4) == CDC_IN_PACKET_SIZE, "CDC data IN endpoint");
+                break;
+            case USB_ENDPOINT_ADDRESS_IN | HID_JOYSTICK_ENDPOINT:
+                CHECK(d[3] == USB_TRANSFER_TYPE_INTERRUPT && read16(d + 4) == HID_IN_JOYSTICK_PACKET_SIZE && d[6] == 1,
+                    "joystick IN endpoint");
+                break;
+            default:
+                CHECK(0, "unexpected endpoint address");
+                break;
+            }
+            break;
+
+        case HID_DESCRIPTOR_TYPE_HID:
+            CHECK(d[0] == 9, "HID descriptor is 9 bytes");
+            CHECK(d == usbConfigurationDescriptor.joystick_hid, "HID descriptor is the joystick's");
+            CHECK(d[6] == HID_DESCRIPTOR_TYPE_REPORT && read16(d + 7) == sizeof(usbHidJoystickReportDescriptor),
+                "HID descriptor gives the report descriptor length");
+            break;
+        }
+
+        offset += d[0];
+    }
+
+    CHECK(offset == totalLength, "descriptor lengths add up to wTotalLength");
+    CHECK(interfaces == config[4] && interfaces == 3, "bNumInterfaces matches the interface descriptors");
+    CHECK(associations == 1, "there is one IAD");
+    CHECK(endpoints == 4, "there are 4 endpoints");
+}
+
+static void checkDevice(void)
+{
+    CHECK(sizeof(usbDeviceDescriptor) == 18 && usbDeviceDescriptor.bLength == 18, "device descriptor is 18 bytes");
+    CHECK(usbDeviceDescriptor.bDeviceClass == 0xEF && usbDeviceDescriptor.bDeviceSubClass == 2
+        && usbDeviceDescriptor.bDeviceProtocol == 1, "device class is Miscellaneous/Common/IAD");
+}
+
+static void checkStrings(void)
+{
+    uint8 i;
+    CHECK(usbStringDescriptorCount == sizeof(usbStringDescriptors) / sizeof(usbStringDescriptors[0]),
+        "usbStringDescriptorCount matches usbStringDescriptors");
+    CHECK(usbConfigurationDescriptor.joystick_interface.iInterface < usbStringDescriptorCount
+        && usbStringDescriptors[usbConfigurationDescriptor.joystick_interface.iInterface] == usbHidJoystickStringDescriptor,
+        "joystick interface string is the joystick name");
+    CHECK((uint8)usbHidJoystickStringDescriptor[0] == sizeof(usbHidJoystickStringDescriptor)
+        && (usbHidJoystickStringDescriptor[0] >> 8) == USB_DESCRIPTOR_TYPE_STRING, "joystick string descriptor length");
+    for (i = 0; i < usbStringDescriptorCount; i++)
+    {
+        CHECK((usbStringDescriptors[i][0] >> 8) == USB_DESCRIPTOR_TYPE_STRING, "string descriptor type");
+    }
+}
+
+static void checkClassDescriptorHandler(void)
+{
+    usbSetupPacket.bmRequestType = 0x81;
+    usbSetupPacket.wIndex = HID_JOYSTICK_INTERFACE_NUMBER;
+
+    controlReadCount = 0;
+    usbSetupPacket.wValue = HID_DESCRIPTOR_TYPE_HID << 8;
+    usbCallbackClassDescriptorHandler();
+    CHECK(controlReadCount == 9 && controlReadSource == (uint8 XDATA *)&usbConfigurationDescriptor.joystick_hid,
+        "GET_DESCRIPTOR(HID) returns the joystick's HID descriptor");
+
+    controlReadCount = 0;
+    usbSetupPacket.wValue = HID_DESCRIPTOR_TYPE_REPORT << 8;
+    usbCallbackClassDescriptorHandler();
+    CHECK(controlReadCount == HID_JOYSTICK_REPORT_DESCRIPTOR_SIZE && controlReadSource == usbHidJoystickReportDescriptor,
+        "GET_DESCRIPTOR(Report) returns the joystick's report descriptor");
+
+    controlReadCount = 0;
+    usbSetupPacket.wIndex = CDC_CONTROL_INTERFACE_NUMBER;
+    usbCallbackClassDescriptorHandler();
+    CHECK(controlReadCount == 0, "class descriptors of the CDC interfaces are not answered");
+}
+
+int main(void)
+{
+    checkDevice();
+    checkConfiguration();
+    checkStrings();
+    checkClassDescriptorHandler();
+
+    if (failures)
+    {
+        printf("%lu failures\n", failures);
+        return 1;
+    }
+    printf("usb_cdc_hid descriptors: all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+/* On-target benchmark for the USB FIFO copy routines (src/usb/usb_fifo.s and
+ * the DMA variants in src/usb/usb.c).
+ *
+ * This is a Wixel app, not a host test.  To run it, copy this file into a new
+ * app directory of the SDK (for example apps/usb_fifo_benchmark/), build it
+ * with make, load it onto a Wixel, open its virtual COM port, and send any
+ * character.  The Wixel answers with one line per method, in this form:
+ *
+ *   usbWriteFifo: 16000 bytes in <time> us, <speed> bytes/s
+ *
+ * Each line is the result of copying 250 packets of 64 bytes to or from the
+ * FIFO of Endpoint 5, which the CDC ACM library does not use, timed with
+ * getUs().  The "byte loop" lines use a copy of the C loops that
+ * usbReadFifo() and usbWriteFifo() used to contain, for comparison.  The
+ * time includes the loop overhead and the Timer 4 interrupt (about 3 us per
+ * ms), so the numbers are a little lower than what the copy loops alone can
+ * do. */
+
+#include <wixel.h>
+#include <usb.h>
+#include <usb_com.h>
+#include <stdio.h>
+
+#define BENCH_ENDPOINT      5
+#define BENCH_PACKET_SIZE   64
+#define BENCH_PACKETS       250
+#define BENCH_BYTES         ((uint16)BENCH_PACKET_SIZE * BENCH_PACKETS)
+
+#define USBCSIL_FLUSH_PACKET 0x08
+
+#define METHOD_WRITE_BYTE_LOOP  0
+#define METHOD_WRITE_FIFO       1
+#define METHOD_WRITE_FIFO_DMA   2
+#define METHOD_READ_BYTE_LOOP   3
+#define METHOD_READ_FIFO        4
+#define METHOD_READ_FIFO_DMA    5
+#define METHOD_COUNT            6
+
+static const char CODE * CODE methodNames[METHOD_COUNT] =
+{
+    "byte loop write",
+    "usbWriteFifo",
+    "usbWriteFifoDma",
+    "byte loop read",
+    "usbReadFifo",
+    "usbReadFifoDma",
+};
+
+static uint8 XDATA packet[BENCH_PACKET_SIZE];
+static uint8 XDATA report[64];
+
+// The next method to report, or METHOD_COUNT if no benchmark is running.
+static uint8 method = METHOD_COUNT;
+
+// The C loops that usbWriteFifo() and usbReadFifo() used before usb_fifo.s.
+static void byteLoopWriteFifo(uint8 endpointNumber, uint8 count, const uint8 XDATA * buffer)
+{
+    XDATA uint8 * fifo = (XDATA uint8 *)(0xDE20 + (uint8)(endpointNumber<<1));
+    while(count > 0)
+    {
+        count--;
+        *fifo = *(buffer++);
+    }
+}
+
+static void byteLoopReadFifo(uint8 endpointNumber, uint8 count, uint8 XDATA * buffer)
+{
+    XDATA uint8 * fifo = (XDATA uint8 *)(0xDE20 + (uint8)(endpointNumber<<1));
+    while(count > 0)
+    {
+        count--;
+        *(buffer++) = *fifo;
+    }
+}
+
+// Copies BENCH_PACKETS packets with the given method and returns the time it
+// took in microseconds.
+static uint32 runMethod(uint8 m)
+{
+    uint32 start;
+    uint8 p;
+
+    USBINDEX = BENCH_ENDPOINT;
+    USBCSIL = USBCSIL_FLUSH_PACKET;
+
+    start = getUs();
+    for (p = 0; p < BENCH_PACKETS; p++)
+    {
+        switch (m)
+        {
+        case METHOD_WRITE_BYTE_LOOP:
+            byteLoopWriteFifo(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+
+        case METHOD_WRITE_FIFO:
+            usbWriteFifo(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+
+        case METHOD_WRITE_FIFO_DMA:
+            usbWriteFifoDma(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+
+        case METHOD_READ_BYTE_LOOP:
+            byteLoopReadFifo(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+
+        case METHOD_READ_FIFO:
+            usbReadFifo(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+
+        case METHOD_READ_FIFO_DMA:
+            usbReadFifoDma(BENCH_ENDPOINT, BENCH_PACKET_SIZE, packet);
+            break;
+        }
+
+        // Throw the written packet away so the FIFO never fills up.  This
+        // is done for every method so they all pay the same small cost.
+        USBCSIL = USBCSIL_FLUSH_PACKET;
+    }
+    return getUs() - start;
+}
+
+// Runs one method per call, so that usbComService() is still called often
+// enough while the benchmark is running.
+static void benchmarkService(void)
+{
+    uint32 us;
+    uint8 length;
+
+    if (method >= METHOD_COUNT || usbComTxAvailable() < sizeof(report))
+    {
+        return;
+    }
+
+    us = runMethod(method);
+
+    // BENCH_BYTES * 1000000 does not fit in 32 bits, so the factor of
+    // 1000000 is split into 62500 * 16.
+    length = sprintf((char XDATA *)report, "%s: %u bytes in %lu us, %lu bytes/s\r\n",
+        methodNames[method], BENCH_BYTES, us,
+        (uint32)BENCH_BYTES * 62500 / us * 16);
+    usbComTxSend(report, length);
+
+    method++;
+}
+
+void main()
+{
+    uint8 i;
+
+    systemInit();
+    usbInit();
+
+    for (i = 0; i < BENCH_PACKET_SIZE; i++)
+    {
+        packet[i] = i;
+    }
+
+    while(1)
+    {
+        boardService();
+        usbShowStatusWithGreenLed();
+        usbComService();
+
+        if (usbComRxAvailable())
+        {
+            usbComRxReceiveByte();
+            if (method >= METHOD_COUNT)
+            {
+                method = 0;
+            }
+        }
+
+        benchmarkService();
+    }
+}